@@ -0,0 +1,328 @@
+#include <zvfs>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures lookup throughput of one shared vfs with a growing number of reader threads
+// Compares the built in reader/writer mode against wrapping the whole vfs in a single mutex
+// Afterwards measures how mounting separate archives into one shared vfs scales with the number of writers
+// and how fast tar archives holding every path are indexed, as one archive and split into many mounted in parallel.
+// Finally compares scanning a host directory tree with mount_directory against a recursive iterator and vfs::add
+//
+namespace
+{
+	constexpr size_t g_lookups_per_thread = 1000000;
+
+	std::vector<std::string> make_paths(size_t count)
+	{
+		std::vector<std::string> paths;
+		paths.reserve(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			paths.push_back("content/pack" + std::to_string(i % 64) + "/group" + std::to_string(i % 1024) +
+				"/asset_" + std::to_string(i) + ".bin");
+		}
+
+		return paths;
+	}
+
+	template<typename Lookup>
+	double measure(size_t thread_count, const std::vector<std::string>& paths, Lookup&& lookup)
+	{
+		std::atomic<bool> start = false;
+		std::atomic<size_t> found = 0;
+		std::vector<std::thread> threads;
+
+		for (size_t i = 0; i < thread_count; i++)
+		{
+			threads.emplace_back([&, i]()
+			{
+				std::mt19937_64 random(i);
+				std::uniform_int_distribution<size_t> distribution(0, paths.size() - 1);
+
+				while (!start)
+					std::this_thread::yield();
+
+				size_t hits = 0;
+				for (size_t lookup_index = 0; lookup_index < g_lookups_per_thread; lookup_index++)
+					hits += lookup(paths[distribution(random)]) ? 1 : 0;
+
+				found += hits;
+			});
+		}
+
+		auto begin = std::chrono::steady_clock::now();
+		start = true;
+
+		for (std::thread& it : threads)
+			it.join();
+
+		auto end = std::chrono::steady_clock::now();
+
+		if (found != thread_count * g_lookups_per_thread)
+			std::cerr << "lookup failed" << std::endl;
+
+		double seconds = std::chrono::duration<double>(end - begin).count();
+		return static_cast<double>(thread_count * g_lookups_per_thread) / seconds / 1e6;
+	}
+
+	double measure_mount(size_t thread_count, const std::vector<std::string>& paths)
+	{
+		zvfs::vfs_settings settings(true, true, 255, false, false, true);
+		zvfs::vfs shared_vfs(settings);
+
+		// Every writer mounts its own archive below a common root, like loader threads do
+		//
+		std::vector<std::vector<std::string>> archives(thread_count);
+		for (size_t i = 0; i < thread_count; i++)
+		{
+			for (const std::string& it : paths)
+				archives[i].push_back("archive" + std::to_string(i) + "/" + it);
+		}
+
+		std::vector<std::thread> threads;
+		auto begin = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < thread_count; i++)
+		{
+			threads.emplace_back([&shared_vfs, &archives, i]()
+			{
+				std::vector<std::string_view> views(archives[i].begin(), archives[i].end());
+				std::vector<zvfs::node_data**> slots;
+				if (shared_vfs.add_bulk(views, slots) != views.size())
+					std::cerr << "mount failed" << std::endl;
+			});
+		}
+
+		for (std::thread& it : threads)
+			it.join();
+
+		auto end = std::chrono::steady_clock::now();
+
+		double seconds = std::chrono::duration<double>(end - begin).count();
+		return static_cast<double>(thread_count * paths.size()) / seconds / 1e6;
+	}
+
+	// Every entry carries one block of data, so the headers are spread like in a real archive
+	//
+	void write_tar(const std::filesystem::path& archive_path, const std::vector<std::string>& paths, size_t first, size_t last)
+	{
+		std::ofstream stream(archive_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		char block[512] = {};
+
+		for (size_t i = first; i < last; i++)
+		{
+			char header[512] = {};
+			std::memcpy(header, paths[i].data(), std::min<size_t>(paths[i].size(), 100));
+			std::snprintf(header + 124, 12, "%011o", 512u);
+			header[156] = '0';
+			std::memcpy(header + 257, "ustar\0" "00", 8);
+			std::memset(header + 148, ' ', 8);
+
+			unsigned sum = 0;
+			for (char byte : header)
+				sum += static_cast<unsigned char>(byte);
+
+			std::snprintf(header + 148, 8, "%06o", sum);
+			stream.write(header, sizeof(header));
+			stream.write(block, sizeof(block));
+		}
+
+		stream.write(block, sizeof(block));
+		stream.write(block, sizeof(block));
+	}
+
+	double measure_tar(const std::vector<std::string>& paths)
+	{
+		std::filesystem::path archive_path = std::filesystem::temp_directory_path() / "zvfs_bench.tar";
+		write_tar(archive_path, paths, 0, paths.size());
+
+		zvfs::mapped_source* archive = zvfs::mapped_source::open(archive_path, zvfs::mapped_file::g_sequential);
+		zvfs::vfs target;
+
+		auto begin = std::chrono::steady_clock::now();
+		size_t mounted = zvfs::mount_tar(target, *archive);
+		auto end = std::chrono::steady_clock::now();
+
+		if (mounted != paths.size())
+			std::cerr << "tar mount failed" << std::endl;
+
+		archive->release();
+		std::filesystem::remove(archive_path);
+
+		double seconds = std::chrono::duration<double>(end - begin).count();
+		return static_cast<double>(paths.size()) / seconds / 1e6;
+	}
+
+	// The paths are split into many archives like shipped content, all of them are mounted at once
+	//
+	double measure_mount_many(size_t thread_count, const std::vector<std::filesystem::path>& archive_paths, size_t entry_count)
+	{
+		std::vector<zvfs::source*> sources;
+		for (const std::filesystem::path& it : archive_paths)
+			sources.push_back(zvfs::mapped_source::open(it, zvfs::mapped_file::g_sequential));
+
+		zvfs::vfs target;
+
+		auto begin = std::chrono::steady_clock::now();
+		if (target.mount_many(sources, thread_count) == static_cast<size_t>(-1))
+			std::cerr << "mount_many failed" << std::endl;
+
+		auto end = std::chrono::steady_clock::now();
+
+		for (zvfs::source* it : sources)
+			it->release();
+
+		double seconds = std::chrono::duration<double>(end - begin).count();
+		return static_cast<double>(entry_count) / seconds / 1e6;
+	}
+
+	// The baseline walks the tree like applications did before mount_directory existed
+	//
+	double measure_directory(size_t thread_count, const std::filesystem::path& root, size_t entry_count)
+	{
+		zvfs::vfs target;
+
+		auto begin = std::chrono::steady_clock::now();
+		if (thread_count)
+		{
+			if (zvfs::mount_directory(target, root, thread_count) != entry_count)
+				std::cerr << "mount_directory failed" << std::endl;
+		}
+		else
+		{
+			for (const std::filesystem::directory_entry& it : std::filesystem::recursive_directory_iterator(root))
+			{
+				std::string path = it.path().lexically_relative(root).generic_string();
+				if (it.is_directory())
+					path += '/';
+
+				if (!target.add(path))
+					std::cerr << "failed to add " << path << std::endl;
+			}
+		}
+
+		auto end = std::chrono::steady_clock::now();
+
+		double seconds = std::chrono::duration<double>(end - begin).count();
+		return static_cast<double>(entry_count) / seconds / 1e6;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t node_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+	size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+	std::vector<std::string> paths = make_paths(node_count);
+
+	zvfs::vfs_settings shared_settings(true, true, 255, false, false, true);
+	zvfs::vfs shared_vfs(shared_settings);
+
+	zvfs::vfs_settings plain_settings(true, true, 255, false, false, false);
+	zvfs::vfs plain_vfs(plain_settings);
+	std::mutex plain_mutex;
+
+	for (const std::string& it : paths)
+	{
+		if (!shared_vfs.add(it) || !plain_vfs.add(it))
+		{
+			std::cerr << "failed to add " << it << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << "nodes: " << shared_vfs.size() << ", lookups per thread: " << g_lookups_per_thread << std::endl;
+	std::cout << std::setw(8) << "threads" << std::setw(20) << "rw mode Mlookup/s" << std::setw(24) << "global mutex Mlookup/s" << std::endl;
+
+	for (size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		double shared_rate = measure(threads, paths, [&shared_vfs](const std::string& path)
+		{
+			return shared_vfs.get(std::string_view(path)) != nullptr;
+		});
+
+		double locked_rate = measure(threads, paths, [&plain_vfs, &plain_mutex](const std::string& path)
+		{
+			std::lock_guard<std::mutex> lock(plain_mutex);
+			return plain_vfs.get(std::string_view(path)) != nullptr;
+		});
+
+		std::cout << std::setw(8) << threads << std::setw(20) << std::fixed << std::setprecision(2) << shared_rate
+			<< std::setw(24) << locked_rate << std::endl;
+	}
+
+	std::cout << std::endl << std::setw(8) << "threads" << std::setw(20) << "mount Mnode/s" << std::endl;
+
+	for (size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		std::cout << std::setw(8) << threads << std::setw(20) << std::fixed << std::setprecision(2)
+			<< measure_mount(threads, paths) << std::endl;
+	}
+
+	std::cout << std::endl << "tar mount Mentry/s: " << std::fixed << std::setprecision(2) << measure_tar(paths) << std::endl;
+
+	constexpr size_t archive_count = 64;
+	std::vector<std::filesystem::path> archive_paths;
+	for (size_t i = 0; i < archive_count; i++)
+	{
+		archive_paths.push_back(std::filesystem::temp_directory_path() / ("zvfs_bench_" + std::to_string(i) + ".tar"));
+		write_tar(archive_paths.back(), paths, paths.size() * i / archive_count, paths.size() * (i + 1) / archive_count);
+	}
+
+	std::cout << std::endl << std::setw(8) << "threads" << std::setw(20) << "mount_many Mentry/s" << std::endl;
+
+	for (size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		std::cout << std::setw(8) << threads << std::setw(20) << std::fixed << std::setprecision(2)
+			<< measure_mount_many(threads, archive_paths, paths.size()) << std::endl;
+	}
+
+	for (const std::filesystem::path& it : archive_paths)
+		std::filesystem::remove(it);
+
+	// Creating files is slow, the tree holds a slice of the paths
+	//
+	std::filesystem::path tree_root = std::filesystem::temp_directory_path() / "zvfs_bench_tree";
+	std::filesystem::remove_all(tree_root);
+
+	size_t file_count = std::min<size_t>(paths.size(), 20000);
+	zvfs::vfs tree_vfs;
+	for (size_t i = 0; i < file_count; i++)
+	{
+		std::filesystem::path file_path = tree_root / paths[i];
+		std::filesystem::create_directories(file_path.parent_path());
+		std::ofstream(file_path).put('x');
+
+		if (!tree_vfs.add(paths[i]))
+			std::cerr << "failed to add " << paths[i] << std::endl;
+	}
+
+	size_t tree_entry_count = tree_vfs.size() - 1;
+
+	std::cout << std::endl << std::setw(8) << "threads" << std::setw(24) << "directory Mentry/s" << std::endl;
+	std::cout << std::setw(8) << "iterator" << std::setw(24) << std::fixed << std::setprecision(2)
+		<< measure_directory(0, tree_root, tree_entry_count) << std::endl;
+
+	for (size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		std::cout << std::setw(8) << threads << std::setw(24) << std::fixed << std::setprecision(2)
+			<< measure_directory(threads, tree_root, tree_entry_count) << std::endl;
+	}
+
+	std::filesystem::remove_all(tree_root);
+
+	return 0;
+}
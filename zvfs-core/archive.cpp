@@ -0,0 +1,27 @@
+#include "archive.hpp"
+
+namespace zvfs
+{
+	/**
+	* Drops leading slashes and "./" components from the name of an archive member, archive members are relative
+	*
+	* @param[in] name		The name as stored in the archive
+	*
+	* @returns				The relative part of name, empty if nothing is left
+	* @exceptsafe no-throw
+	*/
+	std::string_view strip_leading(std::string_view name)
+	{
+		while (true)
+		{
+			if (name.starts_with('/'))
+				name.remove_prefix(1);
+			else if (name.starts_with("./"))
+				name.remove_prefix(2);
+			else if (name == ".")
+				name = {};
+			else
+				return name;
+		}
+	}
+}
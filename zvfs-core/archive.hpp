@@ -0,0 +1,59 @@
+#pragma once
+#include "vfs.hpp"
+#include "node.hpp"
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Drops leading slashes and "./" components from the name of an archive member, archive members are relative
+	*
+	* @param[in] name		The name as stored in the archive
+	*
+	* @returns				The relative part of name, empty if nothing is left
+	* @exceptsafe no-throw
+	*/
+	[[nodiscard]] extern std::string_view strip_leading(std::string_view name);
+
+	/**
+	* Registers the entries collected by an archive backend through vfs::add_bulk and creates the data of their files
+	* Entries describe their path as a range of paths and whether they are files with m_path_offset, m_path_size
+	* and m_is_file. Walking the entries backwards lets the last entry of a path win without ever replacing data
+	*
+	* @param[in] target		The vfs receiving the entries
+	* @param[in] entries	The entries in archive order
+	* @param[in] paths		Storage of all entry paths
+	* @param[in] create		Invoked as create(const Entry&) for every file that ends up with data, returns the new zvfs::file
+	*
+	* @returns				The result of vfs::add_bulk, the number of registered entries or -1 if the vfs couldn't be modified
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the entries could not be allocated. Nodes added up to this point remain valid
+	* @throws ...			Rethrows exceptions thrown by create
+	*/
+	template<typename Entry, typename Function>
+	size_t add_entries(vfs& target, std::span<const Entry> entries, std::string_view paths, Function&& create)
+	{
+		std::vector<std::string_view> views;
+		views.reserve(entries.size());
+		for (const Entry& it : entries)
+			views.push_back(paths.substr(it.m_path_offset, it.m_path_size));
+
+		std::vector<node_data**> slots;
+		size_t added = target.add_bulk(views, slots);
+		if (added == static_cast<size_t>(-1))
+			return added;
+
+		for (size_t i = entries.size(); i-- > 0;)
+		{
+			if (!entries[i].m_is_file || !slots[i] || *slots[i])
+				continue;
+
+			*slots[i] = create(entries[i]);
+		}
+
+		return added;
+	}
+}
@@ -0,0 +1,245 @@
+#include "epoch.hpp"
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace zvfs
+{
+	namespace
+	{
+		constexpr size_t g_slots_per_page = 64;
+		constexpr size_t g_max_pages = 64;
+
+		// Every live thread owns a small index that selects its reader slot in every domain
+		// Indices of finished threads are handed out again, so slots stay dense
+		//
+		std::mutex g_thread_index_mutex;
+		std::vector<uint32_t> g_free_thread_indices;
+		uint32_t g_next_thread_index = 0;
+
+		struct thread_index
+		{
+			thread_index()
+			{
+				std::lock_guard<std::mutex> lock(g_thread_index_mutex);
+				if (g_free_thread_indices.empty())
+				{
+					this->m_value = g_next_thread_index++;
+				}
+				else
+				{
+					this->m_value = g_free_thread_indices.back();
+					g_free_thread_indices.pop_back();
+				}
+			}
+
+			~thread_index()
+			{
+				std::lock_guard<std::mutex> lock(g_thread_index_mutex);
+				g_free_thread_indices.push_back(this->m_value);
+			}
+
+			uint32_t m_value;
+		};
+
+		thread_local thread_index t_thread_index;
+	}
+
+	epoch_domain::guard::guard(guard&& other) noexcept
+		: m_slot(other.m_slot)
+	{
+		other.m_slot = nullptr;
+	}
+
+	epoch_domain::guard& epoch_domain::guard::operator=(guard&& other) noexcept
+	{
+		if (this != &other)
+		{
+			guard released(std::move(*this));
+			this->m_slot = other.m_slot;
+			other.m_slot = nullptr;
+		}
+
+		return *this;
+	}
+
+	epoch_domain::guard::~guard()
+	{
+		if (this->m_slot && --this->m_slot->m_depth == 0)
+			this->m_slot->m_epoch.store(0, std::memory_order_release);
+	}
+
+	epoch_domain::guard::guard(reader_slot* slot)
+		: m_slot(slot)
+	{
+	}
+
+	/**
+	* Creates a domain without any readers or retired objects
+	*
+	* @exceptsafe no-throw
+	*/
+	epoch_domain::epoch_domain()
+		: m_epoch(1)
+	{
+		for (std::atomic<slot_page*>& it : this->m_pages)
+			it.store(nullptr, std::memory_order_relaxed);
+	}
+
+	/**
+	* Frees all retired objects, no reader may be pinned anymore
+	*
+	* @exceptsafe no-throw
+	*/
+	epoch_domain::~epoch_domain()
+	{
+		this->flush();
+
+		for (std::atomic<slot_page*>& it : this->m_pages)
+			delete it.load(std::memory_order_relaxed);
+	}
+
+	/**
+	* Pins the current epoch for the calling thread, guards may be nested
+	*
+	* @returns				A guard that unpins once the outermost guard of the thread is destroyed
+	* @exceptsafe strong
+	* @throws std::bad_alloc		Thrown if the reader slot of a new thread could not be allocated
+	* @throws std::runtime_error	Thrown if more threads than supported are pinned at the same time
+	*/
+	epoch_domain::guard epoch_domain::pin()
+	{
+		reader_slot& slot = this->local_slot();
+
+		if (slot.m_depth++ == 0)
+		{
+			// The announcement has to be visible before any shared pointer is loaded,
+			// that ordering needs a full fence but no read-modify-write
+			//
+			slot.m_epoch.store(this->m_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+
+		return guard(&slot);
+	}
+
+	/**
+	* Hands an object that readers can't reach anymore over to the domain
+	*
+	* @param[in] pointer	The unlinked object
+	* @param[in] function	Invoked as function(context, pointer) once the object can be freed
+	* @param[in] context	Passed through to function
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the object could not be queued, it is not retired in that case
+	*/
+	void epoch_domain::retire(void* pointer, deleter function, void* context)
+	{
+		std::lock_guard<std::mutex> lock(this->m_retired_mutex);
+		this->m_retired.push_back({ this->m_epoch.load(std::memory_order_relaxed), pointer, function, context });
+	}
+
+	/**
+	* Advances the epoch and frees every retired object no pinned reader can observe anymore
+	*
+	* @returns				Number of freed objects
+	* @exceptsafe no-throw
+	*/
+	size_t epoch_domain::reclaim()
+	{
+		std::lock_guard<std::mutex> lock(this->m_retired_mutex);
+		if (this->m_retired.empty())
+			return 0;
+
+		// Readers that pin after the fence load the new epoch and can't see anything unlinked before it
+		//
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint64_t epoch = this->m_epoch.load(std::memory_order_relaxed) + 1;
+		this->m_epoch.store(epoch, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		uint64_t oldest = epoch;
+		for (std::atomic<slot_page*>& page : this->m_pages)
+		{
+			slot_page* current = page.load(std::memory_order_acquire);
+			if (!current)
+				continue;
+
+			for (reader_slot& it : current->m_slots)
+			{
+				uint64_t pinned = it.m_epoch.load(std::memory_order_acquire);
+				if (pinned)
+					oldest = std::min(oldest, pinned);
+			}
+		}
+
+		// Objects retired in an epoch older than every pinned reader are unreachable
+		//
+		auto reachable = std::partition(this->m_retired.begin(), this->m_retired.end(), [oldest](const retired_object& it)
+		{
+			return it.m_epoch >= oldest;
+		});
+
+		size_t freed = static_cast<size_t>(this->m_retired.end() - reachable);
+		for (auto it = reachable; it != this->m_retired.end(); ++it)
+			it->m_deleter(it->m_context, it->m_pointer);
+
+		this->m_retired.erase(reachable, this->m_retired.end());
+		return freed;
+	}
+
+	/**
+	* Frees every retired object regardless of pinned readers
+	* Only valid if no reader can access the retired objects anymore
+	*
+	* @exceptsafe no-throw
+	*/
+	void epoch_domain::flush()
+	{
+		std::lock_guard<std::mutex> lock(this->m_retired_mutex);
+		for (const retired_object& it : this->m_retired)
+			it.m_deleter(it.m_context, it.m_pointer);
+
+		this->m_retired.clear();
+	}
+
+	/**
+	* Retrieves the number of objects waiting to be freed
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t epoch_domain::pending() const
+	{
+		std::lock_guard<std::mutex> lock(this->m_retired_mutex);
+		return this->m_retired.size();
+	}
+
+	epoch_domain::reader_slot& epoch_domain::local_slot()
+	{
+		uint32_t index = t_thread_index.m_value;
+		if (index >= g_max_pages * g_slots_per_page)
+			throw std::runtime_error("Too many threads use the epoch domain at the same time");
+
+		std::atomic<slot_page*>& page = this->m_pages[index / g_slots_per_page];
+		slot_page* current = page.load(std::memory_order_acquire);
+
+		// Pages are installed once and live as long as the domain
+		//
+		if (!current)
+		{
+			slot_page* created = new slot_page();
+			for (reader_slot& it : created->m_slots)
+			{
+				it.m_epoch.store(0, std::memory_order_relaxed);
+				it.m_depth = 0;
+			}
+
+			if (page.compare_exchange_strong(current, created, std::memory_order_acq_rel, std::memory_order_acquire))
+				current = created;
+			else
+				delete created;
+		}
+
+		return current->m_slots[index % g_slots_per_page];
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Epoch based reclamation for data structures with lock-free readers
+	*
+	* Readers pin the current epoch while they access shared objects. Pinning only stores into a slot owned by
+	* the calling thread, it never performs a read-modify-write. Writers unlink objects first and retire them
+	* afterwards, a retired object is freed once no reader is pinned to an epoch that could still observe it.
+	* Several writers may retire and reclaim at the same time, those calls share one mutex
+	*/
+	class epoch_domain
+	{
+	private:
+		struct alignas(64) reader_slot
+		{
+			// Pinned epoch, 0 while the owning thread is not pinned
+			//
+			std::atomic<uint64_t> m_epoch;
+
+			// Nesting depth of guards, only touched by the owning thread
+			//
+			uint32_t m_depth;
+		};
+
+		struct slot_page
+		{
+			std::array<reader_slot, 64> m_slots;
+		};
+
+		struct retired_object
+		{
+			uint64_t m_epoch;
+			void* m_pointer;
+			void (*m_deleter)(void* context, void* pointer);
+			void* m_context;
+		};
+
+	public:
+		using deleter = void (*)(void* context, void* pointer);
+
+		/**
+		* Keeps the epoch pinned while it lives
+		* Objects reachable while the guard was created are not freed before it is destroyed
+		*
+		*/
+		class guard
+		{
+			friend class epoch_domain;
+
+		public:
+			guard(guard&& other) noexcept;
+			guard& operator=(guard&& other) noexcept;
+			guard(const guard&) = delete;
+			guard& operator=(const guard&) = delete;
+			~guard();
+
+		private:
+			explicit guard(reader_slot* slot);
+
+			reader_slot* m_slot;
+		};
+
+		/**
+		* Creates a domain without any readers or retired objects
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] epoch_domain();
+
+		/**
+		* Frees all retired objects, no reader may be pinned anymore
+		*
+		* @exceptsafe no-throw
+		*/
+		~epoch_domain();
+
+		epoch_domain(const epoch_domain&) = delete;
+		epoch_domain& operator=(const epoch_domain&) = delete;
+
+		/**
+		* Pins the current epoch for the calling thread, guards may be nested
+		*
+		* @returns				A guard that unpins once the outermost guard of the thread is destroyed
+		* @exceptsafe strong
+		* @throws std::bad_alloc		Thrown if the reader slot of a new thread could not be allocated
+		* @throws std::runtime_error	Thrown if more threads than supported are pinned at the same time
+		*/
+		[[nodiscard]] guard pin();
+
+		/**
+		* Hands an object that readers can't reach anymore over to the domain
+		*
+		* @param[in] pointer	The unlinked object
+		* @param[in] function	Invoked as function(context, pointer) once the object can be freed
+		* @param[in] context	Passed through to function
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the object could not be queued, it is not retired in that case
+		*/
+		void retire(void* pointer, deleter function, void* context);
+
+		/**
+		* Advances the epoch and frees every retired object no pinned reader can observe anymore
+		*
+		* @returns				Number of freed objects
+		* @exceptsafe no-throw
+		*/
+		size_t reclaim();
+
+		/**
+		* Frees every retired object regardless of pinned readers
+		* Only valid if no reader can access the retired objects anymore
+		*
+		* @exceptsafe no-throw
+		*/
+		void flush();
+
+		/**
+		* Retrieves the number of objects waiting to be freed
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t pending() const;
+
+	private:
+		reader_slot& local_slot();
+
+	private:
+		std::array<std::atomic<slot_page*>, 64> m_pages;
+		std::atomic<uint64_t> m_epoch;
+		mutable std::mutex m_retired_mutex;
+		std::vector<retired_object> m_retired;
+	};
+}
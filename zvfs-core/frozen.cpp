@@ -0,0 +1,580 @@
+#include "frozen.hpp"
+#include "hash.hpp"
+#include "path.hpp"
+#include "perfect_hash.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+namespace zvfs
+{
+	namespace
+	{
+		// Colliding path hashes can't be separated by any displacement, those snapshots are rehashed with another seed
+		//
+		constexpr uint64_t g_max_seeds = 16;
+
+		size_t align_up(size_t offset)
+		{
+			return (offset + 7) & ~size_t(7);
+		}
+
+		// Checks that a section of an untrusted image ends before end, without overflowing
+		//
+		bool section_fits(uint64_t offset, uint64_t size, uint64_t end)
+		{
+			return !(offset & 7) && offset <= end && size <= end - offset;
+		}
+	}
+
+	/**
+	* Creates an entry that refers to no node
+	*
+	* @exceptsafe no-throw
+	*/
+	frozen_entry::frozen_entry()
+		: m_owner(nullptr)
+		, m_index(0)
+	{
+	}
+
+	/**
+	* Checks if the entry refers to a node
+	*
+	* @exceptsafe no-throw
+	*/
+	frozen_entry::operator bool() const
+	{
+		return this->m_owner != nullptr;
+	}
+
+	/**
+	* Retrieves the full path of the node, a view into the snapshot
+	*
+	* @exceptsafe no-throw
+	*/
+	std::string_view frozen_entry::path() const
+	{
+		const frozen_vfs::record& current = this->m_owner->records()[this->m_index];
+		if (!this->m_owner->valid_path(current))
+			return {};
+
+		return std::string_view(this->m_owner->strings() + current.m_path_offset, current.m_path_size);
+	}
+
+	/**
+	* Retrieves the last component of the nodes path
+	* Directory names keep their trailing slash
+	*
+	* @exceptsafe no-throw
+	*/
+	std::string_view frozen_entry::name() const
+	{
+		const frozen_vfs::record& current = this->m_owner->records()[this->m_index];
+		if (!this->m_owner->valid_path(current))
+			return {};
+
+		return std::string_view(this->m_owner->strings() + current.m_path_offset + current.m_path_size - current.m_name_size, current.m_name_size);
+	}
+
+	/**
+	* Retrieves the hash the snapshot stores for the node path
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t frozen_entry::hash() const
+	{
+		return static_cast<size_t>(this->m_owner->records()[this->m_index].m_hash);
+	}
+
+	/**
+	* Checks if the node is a file
+	*
+	* @exceptsafe no-throw
+	*/
+	bool frozen_entry::is_file() const
+	{
+		// Directory paths end in a slash, only the root has an empty path
+		//
+		std::string_view path = this->path();
+		return !path.empty() && path.back() != '/';
+	}
+
+	/**
+	* Retrieves the parent directory, the root node has no parent
+	*
+	* @exceptsafe no-throw
+	*/
+	frozen_entry frozen_entry::parent() const
+	{
+		// Covers the root as well, its parent is g_no_parent
+		//
+		uint32_t parent = this->m_owner->records()[this->m_index].m_parent;
+		if (parent >= this->m_owner->header()->m_node_count)
+			return {};
+
+		return frozen_entry(this->m_owner, parent);
+	}
+
+	/**
+	* Retrieves the number of direct children of a directory
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t frozen_entry::child_count() const
+	{
+		// A child range reaching past the records of a damaged image reads as no children
+		//
+		const frozen_vfs::record& current = this->m_owner->records()[this->m_index];
+		uint32_t node_count = this->m_owner->header()->m_node_count;
+		if (current.m_first_child > node_count || current.m_child_count > node_count - current.m_first_child)
+			return 0;
+
+		return current.m_child_count;
+	}
+
+	/**
+	* Retrieves a direct child of a directory. Children are sorted by name
+	*
+	* @param[in] index		Position of the child
+	*
+	* @returns				The child, an entry that refers to no node if index is not below child_count()
+	* @exceptsafe no-throw
+	*/
+	frozen_entry frozen_entry::child(size_t index) const
+	{
+		if (index >= this->child_count())
+			return {};
+
+		return frozen_entry(this->m_owner, this->m_owner->records()[this->m_index].m_first_child + static_cast<uint32_t>(index));
+	}
+
+	/**
+	* Retrieves the file data the node had when the snapshot was taken
+	* The file objects stay owned by the vfs that was frozen
+	*
+	* @returns				The file data or a nullptr for directories and files without data.
+	*						Mapped snapshots have no file objects, see descriptor()
+	* @exceptsafe no-throw
+	*/
+	file* frozen_entry::data() const
+	{
+		if (this->m_index >= this->m_owner->m_files.size())
+			return nullptr;
+
+		return this->m_owner->m_files[this->m_index];
+	}
+
+	/**
+	* Retrieves the descriptor the payload writer of vfs::freeze produced for the node, a view into the snapshot
+	*
+	* @returns				The descriptor, empty for directories or if the snapshot was taken without a writer
+	* @exceptsafe no-throw
+	*/
+	std::span<const std::byte> frozen_entry::descriptor() const
+	{
+		const frozen_vfs::image_header* header = this->m_owner->header();
+		if (!header->m_descriptors_offset)
+			return {};
+
+		// Descriptors of mapped images are not validated up front, a damaged one reads as empty
+		//
+		const frozen_vfs::descriptor_entry& current = this->m_owner->descriptors()[this->m_index];
+		if (current.m_offset > header->m_payload_size || current.m_size > header->m_payload_size - current.m_offset)
+			return {};
+
+		return std::span<const std::byte>(this->m_owner->m_image + header->m_payload_offset + current.m_offset, static_cast<size_t>(current.m_size));
+	}
+
+	/**
+	* Retrieves the position of the node inside the snapshot, see frozen_vfs::at
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t frozen_entry::index() const
+	{
+		return this->m_index;
+	}
+
+	frozen_entry::frozen_entry(const frozen_vfs* owner, uint32_t index)
+		: m_owner(owner)
+		, m_index(index)
+	{
+	}
+
+	/**
+	* Creates an empty snapshot without any nodes
+	*
+	* @exceptsafe no-throw
+	*/
+	frozen_vfs::frozen_vfs()
+		: m_image(nullptr)
+	{
+	}
+
+	frozen_vfs::frozen_vfs(frozen_vfs&& other) noexcept
+		: m_storage(std::move(other.m_storage))
+		, m_mapping(std::move(other.m_mapping))
+		, m_image(std::exchange(other.m_image, nullptr))
+		, m_files(std::move(other.m_files))
+	{
+	}
+
+	frozen_vfs& frozen_vfs::operator=(frozen_vfs&& other) noexcept
+	{
+		if (this != &other)
+		{
+			this->m_storage = std::move(other.m_storage);
+			this->m_mapping = std::move(other.m_mapping);
+			this->m_image = std::exchange(other.m_image, nullptr);
+			this->m_files = std::move(other.m_files);
+		}
+
+		return *this;
+	}
+
+	/**
+	* Retrieves a node from the snapshot. Expects complete paths
+	*
+	* @param[in] path		Complete path to the node
+	*						Example: folder1/folder2/file.png
+	*
+	* @returns				The requested node, an entry that refers to no node if the path is not present
+	* @exceptsafe no-throw
+	*/
+	frozen_entry frozen_vfs::get(std::string_view path) const
+	{
+		if (!this->m_image)
+			return {};
+
+		const image_header* header = this->header();
+		bool ignore_case = header->m_flags & g_fold_case_flag;
+
+		size_t hash = path_hasher::hash(path, ignore_case, header->m_flags & g_ascii_only_flag, header->m_seed);
+		if (hash == static_cast<size_t>(-1))
+			return {};
+
+		// The perfect hash maps every stored path to its own slot, anything else lands on some
+		// other path and is rejected by the compare
+		//
+		uint32_t displacement = this->displacements()[perfect_hash::bucket(hash, header->m_bucket_count)];
+		size_t slot = perfect_hash::slot(hash, displacement, header->m_node_count);
+		if (slot >= header->m_node_count)
+			return {};
+
+		// Mapped images are only validated down to their sections, so the probe checks every offset it follows
+		//
+		uint32_t index = this->slots()[slot];
+		if (index >= header->m_node_count)
+			return {};
+
+		const record& current = this->records()[index];
+		if (!this->valid_path(current))
+			return {};
+
+		if (current.m_hash != hash || !path::equals(std::string_view(this->strings() + current.m_path_offset, current.m_path_size), path, ignore_case))
+			return {};
+
+		return frozen_entry(this, index);
+	}
+
+	/**
+	* Retrieves the root node
+	*
+	* @returns				The root node, an entry that refers to no node if the snapshot is empty
+	* @exceptsafe no-throw
+	*/
+	frozen_entry frozen_vfs::root() const
+	{
+		if (!this->m_image)
+			return {};
+
+		return frozen_entry(this, 0);
+	}
+
+	/**
+	* Retrieves a node by its position, positions follow the breadth first order of the snapshot
+	*
+	* @param[in] index		Position of the node, has to be below size()
+	*
+	* @exceptsafe no-throw
+	*/
+	frozen_entry frozen_vfs::at(size_t index) const
+	{
+		return frozen_entry(this, static_cast<uint32_t>(index));
+	}
+
+	/**
+	* Retrieves the number of nodes in the snapshot
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t frozen_vfs::size() const
+	{
+		return this->m_image ? this->header()->m_node_count : 0;
+	}
+
+	/**
+	* Retrieves the number of bytes the image of the snapshot occupies
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t frozen_vfs::image_size() const
+	{
+		return this->m_image ? static_cast<size_t>(this->header()->m_image_size) : 0;
+	}
+
+	/**
+	* Writes the image of the snapshot into a file that frozen_vfs::map can use in place
+	* Images are stored in host byte order, they can only be mapped on machines of the same endianness
+	*
+	* @param[in] path		Path of the written file, an existing file is replaced
+	*
+	* @returns				Returns true if the file was written completely, false for an empty snapshot
+	* @exceptsafe no-throw
+	*/
+	bool frozen_vfs::save(const std::filesystem::path& path) const
+	{
+		if (!this->m_image)
+			return false;
+
+		try
+		{
+			std::ofstream stream(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+			if (!stream.is_open())
+				return false;
+
+			stream.write(reinterpret_cast<const char*>(this->m_image), static_cast<std::streamsize>(this->header()->m_image_size));
+			stream.close();
+
+			return !stream.fail();
+		}
+		catch (...)
+		{
+			return false;
+		}
+	}
+
+	/**
+	* Replaces the snapshot by a memory mapping of an image written by frozen_vfs::save
+	* Nothing is read or copied, only the header is checked. Records and paths are used straight from the mapping
+	* and are paged in when a lookup first touches them, so opening takes the same time for any number of nodes.
+	* The image keeps the case and character set settings of the frozen vfs, lookups behave the same way.
+	* Mapped snapshots have no file objects, file data has to be recovered from the descriptors.
+	* Records are not validated up front either, lookups and entries check every offset and index they follow.
+	* Damaged records read as empty paths, missing parents or directories without children
+	*
+	* @param[in] path		Path of the image
+	*
+	* @returns				Returns true if the image was mapped. Returns false and leaves the snapshot empty
+	*						if the file is no image or is truncated
+	* @exceptsafe no-throw
+	*/
+	bool frozen_vfs::map(const std::filesystem::path& path)
+	{
+		this->m_storage = std::vector<uint64_t>();
+		this->m_files = std::vector<file*>();
+		this->m_image = nullptr;
+
+		if (!this->m_mapping.open(path))
+			return false;
+
+		// Mappings are page aligned, every section offset only has to be checked against the size
+		//
+		image_header header;
+		if (this->m_mapping.size() < sizeof(header))
+		{
+			this->m_mapping.close();
+			return false;
+		}
+
+		std::memcpy(&header, this->m_mapping.data(), sizeof(header));
+		if (!valid_header(header, this->m_mapping.size()))
+		{
+			this->m_mapping.close();
+			return false;
+		}
+
+		this->m_image = this->m_mapping.data();
+		return true;
+	}
+
+	frozen_vfs frozen_vfs::build(std::span<node* const> order, std::span<const uint32_t> child_counts, bool fold_case, bool ascii_only, const payload_writer& writer)
+	{
+		if (order.size() >= g_no_parent)
+			throw std::runtime_error("Too many nodes for a snapshot");
+
+		size_t node_count = order.size();
+		size_t bucket_count = perfect_hash::bucket_count(node_count);
+
+		size_t strings_size = 0;
+		for (node* it : order)
+			strings_size += it->m_path_size;
+
+		if (strings_size > UINT32_MAX)
+			throw std::runtime_error("Too much path data for a snapshot");
+
+		// Descriptors are collected first, their total size decides the image size
+		//
+		std::vector<descriptor_entry> descriptors;
+		std::vector<std::byte> payload;
+		if (writer)
+		{
+			descriptors.assign(node_count, descriptor_entry{});
+
+			std::vector<std::byte> descriptor;
+			for (size_t i = 0; i < node_count; i++)
+			{
+				if (!order[i]->m_is_file)
+					continue;
+
+				descriptor.clear();
+				writer(order[i], descriptor);
+
+				descriptors[i].m_offset = payload.size();
+				descriptors[i].m_size = descriptor.size();
+				payload.insert(payload.end(), descriptor.begin(), descriptor.end());
+			}
+		}
+
+		// Header, records, displacements, slots, paths, descriptors and their payload, each section starts 8 byte aligned
+		//
+		image_header layout = {};
+		layout.m_magic = g_magic;
+		layout.m_version = g_version;
+		layout.m_flags = (fold_case ? g_fold_case_flag : 0) | (ascii_only ? g_ascii_only_flag : 0);
+		layout.m_node_count = static_cast<uint32_t>(node_count);
+		layout.m_bucket_count = bucket_count;
+		layout.m_records_offset = align_up(sizeof(image_header));
+		layout.m_displacements_offset = align_up(layout.m_records_offset + node_count * sizeof(record));
+		layout.m_slots_offset = align_up(layout.m_displacements_offset + bucket_count * sizeof(uint32_t));
+		layout.m_strings_offset = align_up(layout.m_slots_offset + node_count * sizeof(uint32_t));
+		layout.m_strings_size = strings_size;
+		layout.m_image_size = align_up(layout.m_strings_offset + strings_size);
+
+		if (writer)
+		{
+			layout.m_descriptors_offset = layout.m_image_size;
+			layout.m_payload_offset = align_up(layout.m_descriptors_offset + node_count * sizeof(descriptor_entry));
+			layout.m_payload_size = payload.size();
+			layout.m_image_size = align_up(layout.m_payload_offset + payload.size());
+		}
+
+		frozen_vfs result;
+		result.m_storage.assign(layout.m_image_size / sizeof(uint64_t), 0);
+		result.m_files.assign(node_count, nullptr);
+
+		std::byte* image = reinterpret_cast<std::byte*>(result.m_storage.data());
+		record* records = reinterpret_cast<record*>(image + layout.m_records_offset);
+		char* strings = reinterpret_cast<char*>(image + layout.m_strings_offset);
+
+		// Breadth first order stores the children of every directory as one block right after the blocks of
+		// the directories before it, so a running cursor hands out the child ranges
+		//
+		uint32_t path_offset = 0;
+		uint32_t next_child = 1;
+		std::vector<uint64_t> keys(node_count);
+
+		for (size_t i = 0; i < node_count; i++)
+		{
+			node* current = order[i];
+			record& target = records[i];
+
+			target.m_hash = current->m_hash;
+			target.m_path_offset = path_offset;
+			target.m_path_size = current->m_path_size;
+			target.m_name_size = current->m_name_size;
+			target.m_first_child = next_child;
+			target.m_child_count = child_counts[i];
+
+			if (i == 0)
+				target.m_parent = g_no_parent;
+
+			for (uint32_t child = next_child; child < next_child + child_counts[i]; child++)
+				records[child].m_parent = static_cast<uint32_t>(i);
+
+			next_child += child_counts[i];
+
+			current->write_path(strings + path_offset);
+			path_offset += current->m_path_size;
+
+			keys[i] = current->m_hash;
+			if (current->m_is_file)
+				result.m_files[i] = current->m_file;
+		}
+
+		// Node hashes are unseeded, only snapshots with colliding paths pay for rehashing
+		//
+		std::vector<uint32_t> displacements;
+		std::vector<uint32_t> key_slots;
+		uint64_t seed = 0;
+		while (!perfect_hash::build(keys, displacements, key_slots))
+		{
+			if (++seed == g_max_seeds)
+				throw std::runtime_error("Failed to build the perfect hash of a snapshot");
+
+			for (size_t i = 0; i < node_count; i++)
+			{
+				std::string_view path(strings + records[i].m_path_offset, records[i].m_path_size);
+				keys[i] = path_hasher::hash(path, fold_case, ascii_only, seed);
+				records[i].m_hash = keys[i];
+			}
+		}
+
+		layout.m_seed = seed;
+
+		uint32_t* slots = reinterpret_cast<uint32_t*>(image + layout.m_slots_offset);
+		for (size_t i = 0; i < node_count; i++)
+			slots[key_slots[i]] = static_cast<uint32_t>(i);
+
+		std::memcpy(image + layout.m_displacements_offset, displacements.data(), bucket_count * sizeof(uint32_t));
+		std::memcpy(image, &layout, sizeof(image_header));
+
+		if (writer)
+		{
+			std::memcpy(image + layout.m_descriptors_offset, descriptors.data(), node_count * sizeof(descriptor_entry));
+			std::memcpy(image + layout.m_payload_offset, payload.data(), payload.size());
+		}
+
+		result.m_image = image;
+		return result;
+	}
+
+	bool frozen_vfs::valid_header(const image_header& header, size_t size)
+	{
+		if (header.m_magic != g_magic || header.m_version != g_version || header.m_image_size != size)
+			return false;
+
+		if (header.m_flags & ~(g_fold_case_flag | g_ascii_only_flag))
+			return false;
+
+		// Every image holds at least the root, and the bucket count follows from the node count
+		//
+		if (!header.m_node_count || header.m_node_count == g_no_parent || header.m_bucket_count != perfect_hash::bucket_count(header.m_node_count))
+			return false;
+
+		uint64_t node_count = header.m_node_count;
+		if (!section_fits(header.m_records_offset, node_count * sizeof(record), header.m_displacements_offset) || header.m_records_offset < sizeof(image_header))
+			return false;
+
+		if (!section_fits(header.m_displacements_offset, header.m_bucket_count * sizeof(uint32_t), header.m_slots_offset))
+			return false;
+
+		if (!section_fits(header.m_slots_offset, node_count * sizeof(uint32_t), header.m_strings_offset))
+			return false;
+
+		if (!header.m_descriptors_offset)
+			return header.m_payload_size == 0 && section_fits(header.m_strings_offset, header.m_strings_size, size);
+
+		return section_fits(header.m_strings_offset, header.m_strings_size, header.m_descriptors_offset)
+			&& section_fits(header.m_descriptors_offset, node_count * sizeof(descriptor_entry), header.m_payload_offset)
+			&& section_fits(header.m_payload_offset, header.m_payload_size, size);
+	}
+
+	bool frozen_vfs::valid_path(const record& current) const
+	{
+		uint64_t strings_size = this->header()->m_strings_size;
+		return current.m_path_offset <= strings_size && current.m_path_size <= strings_size - current.m_path_offset && current.m_name_size <= current.m_path_size;
+	}
+}
@@ -0,0 +1,320 @@
+#pragma once
+#include "node.hpp"
+#include "mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace zvfs
+{
+	class frozen_vfs;
+
+	/**
+	* Read-only view of one node of a zvfs::frozen_vfs
+	* Small enough to be passed by value, stays valid as long as the snapshot it was retrieved from
+	*
+	*/
+	class frozen_entry
+	{
+		friend class frozen_vfs;
+
+	public:
+		/**
+		* Creates an entry that refers to no node
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] frozen_entry();
+
+		/**
+		* Checks if the entry refers to a node
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] explicit operator bool() const;
+
+		/**
+		* Retrieves the full path of the node, a view into the snapshot
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] std::string_view path() const;
+
+		/**
+		* Retrieves the last component of the nodes path
+		* Directory names keep their trailing slash
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] std::string_view name() const;
+
+		/**
+		* Retrieves the hash the snapshot stores for the node path
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t hash() const;
+
+		/**
+		* Checks if the node is a file
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool is_file() const;
+
+		/**
+		* Retrieves the parent directory, the root node has no parent
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] frozen_entry parent() const;
+
+		/**
+		* Retrieves the number of direct children of a directory
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t child_count() const;
+
+		/**
+		* Retrieves a direct child of a directory. Children are sorted by name
+		*
+		* @param[in] index		Position of the child
+		*
+		* @returns				The child, an entry that refers to no node if index is not below child_count()
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] frozen_entry child(size_t index) const;
+
+		/**
+		* Retrieves the file data the node had when the snapshot was taken
+		* The file objects stay owned by the vfs that was frozen
+		*
+		* @returns				The file data or a nullptr for directories and files without data.
+		*						Mapped snapshots have no file objects, see descriptor()
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] file* data() const;
+
+		/**
+		* Retrieves the descriptor the payload writer of vfs::freeze produced for the node, a view into the snapshot
+		*
+		* @returns				The descriptor, empty for directories or if the snapshot was taken without a writer
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] std::span<const std::byte> descriptor() const;
+
+		/**
+		* Retrieves the position of the node inside the snapshot, see frozen_vfs::at
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t index() const;
+
+	private:
+		frozen_entry(const frozen_vfs* owner, uint32_t index);
+
+	private:
+		const frozen_vfs* m_owner;
+		uint32_t m_index;
+	};
+
+	/**
+	* Immutable snapshot of a vfs, created by vfs::freeze
+	*
+	* All nodes live in one contiguous image: fixed size records in breadth first order with the children of every
+	* directory stored next to each other and sorted by name, followed by all paths. Paths are looked up through
+	* a minimal perfect hash, which takes one probe and one path compare. Nothing is ever modified,
+	* so any number of threads may use a snapshot without synchronization
+	*
+	* The image only contains offsets, never pointers. A saved image can be mapped and used in place,
+	* see frozen_vfs::map
+	*/
+	class frozen_vfs
+	{
+		friend class vfs;
+		friend class frozen_entry;
+
+	public:
+		/**
+		* Creates an empty snapshot without any nodes
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] frozen_vfs();
+
+		frozen_vfs(frozen_vfs&& other) noexcept;
+		frozen_vfs& operator=(frozen_vfs&& other) noexcept;
+		frozen_vfs(const frozen_vfs&) = delete;
+		frozen_vfs& operator=(const frozen_vfs&) = delete;
+
+		/**
+		* Retrieves a node from the snapshot. Expects complete paths
+		*
+		* @param[in] path		Complete path to the node
+		*						Example: folder1/folder2/file.png
+		*
+		* @returns				The requested node, an entry that refers to no node if the path is not present
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] frozen_entry get(std::string_view path) const;
+
+		/**
+		* Retrieves the root node
+		*
+		* @returns				The root node, an entry that refers to no node if the snapshot is empty
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] frozen_entry root() const;
+
+		/**
+		* Retrieves a node by its position, positions follow the breadth first order of the snapshot
+		*
+		* @param[in] index		Position of the node, has to be below size()
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] frozen_entry at(size_t index) const;
+
+		/**
+		* Retrieves the number of nodes in the snapshot
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t size() const;
+
+		/**
+		* Retrieves the number of bytes the image of the snapshot occupies
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t image_size() const;
+
+		/**
+		* Writes the image of the snapshot into a file that frozen_vfs::map can use in place
+		* Images are stored in host byte order, they can only be mapped on machines of the same endianness
+		*
+		* @param[in] path		Path of the written file, an existing file is replaced
+		*
+		* @returns				Returns true if the file was written completely, false for an empty snapshot
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool save(const std::filesystem::path& path) const;
+
+		/**
+		* Replaces the snapshot by a memory mapping of an image written by frozen_vfs::save
+		* Nothing is read or copied, only the header is checked. Records and paths are used straight from the mapping
+		* and are paged in when a lookup first touches them, so opening takes the same time for any number of nodes.
+		* The image keeps the case and character set settings of the frozen vfs, lookups behave the same way.
+		* Mapped snapshots have no file objects, file data has to be recovered from the descriptors.
+		* Records are not validated up front either, lookups and entries check every offset and index they follow.
+		* Damaged records read as empty paths, missing parents or directories without children
+		*
+		* @param[in] path		Path of the image
+		*
+		* @returns				Returns true if the image was mapped. Returns false and leaves the snapshot empty
+		*						if the file is no image or is truncated
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool map(const std::filesystem::path& path);
+
+	private:
+		static constexpr uint32_t g_magic = 0x4653565A;
+		static constexpr uint32_t g_version = 1;
+		static constexpr uint32_t g_no_parent = 0xFFFFFFFFu;
+
+		static constexpr uint32_t g_fold_case_flag = 1;
+		static constexpr uint32_t g_ascii_only_flag = 2;
+
+		struct image_header
+		{
+			uint32_t m_magic;
+			uint32_t m_version;
+			uint32_t m_flags;
+			uint32_t m_node_count;
+			uint64_t m_seed;
+			uint64_t m_bucket_count;
+			uint64_t m_image_size;
+			uint64_t m_records_offset;
+			uint64_t m_displacements_offset;
+			uint64_t m_slots_offset;
+			uint64_t m_strings_offset;
+			uint64_t m_strings_size;
+			uint64_t m_descriptors_offset;
+			uint64_t m_payload_offset;
+			uint64_t m_payload_size;
+		};
+
+		// Paths are stored in full, the name is the tail of the path
+		//
+		struct record
+		{
+			uint64_t m_hash;
+			uint32_t m_path_offset;
+			uint32_t m_path_size;
+			uint32_t m_name_size;
+			uint32_t m_parent;
+			uint32_t m_first_child;
+			uint32_t m_child_count;
+		};
+
+		// Snapshots taken with a payload writer have one descriptor per node, directories have empty ones
+		//
+		struct descriptor_entry
+		{
+			uint64_t m_offset;
+			uint64_t m_size;
+		};
+
+		using payload_writer = std::function<void(node* entry, std::vector<std::byte>& out_descriptor)>;
+
+		[[nodiscard]] static frozen_vfs build(std::span<node* const> order, std::span<const uint32_t> child_counts, bool fold_case, bool ascii_only, const payload_writer& writer);
+
+		[[nodiscard]] static bool valid_header(const image_header& header, size_t size);
+
+		[[nodiscard]] bool valid_path(const record& current) const;
+
+		[[nodiscard]] const image_header* header() const
+		{
+			return reinterpret_cast<const image_header*>(this->m_image);
+		}
+
+		[[nodiscard]] const record* records() const
+		{
+			return reinterpret_cast<const record*>(this->m_image + this->header()->m_records_offset);
+		}
+
+		[[nodiscard]] const uint32_t* displacements() const
+		{
+			return reinterpret_cast<const uint32_t*>(this->m_image + this->header()->m_displacements_offset);
+		}
+
+		[[nodiscard]] const uint32_t* slots() const
+		{
+			return reinterpret_cast<const uint32_t*>(this->m_image + this->header()->m_slots_offset);
+		}
+
+		[[nodiscard]] const char* strings() const
+		{
+			return reinterpret_cast<const char*>(this->m_image + this->header()->m_strings_offset);
+		}
+
+		[[nodiscard]] const descriptor_entry* descriptors() const
+		{
+			return reinterpret_cast<const descriptor_entry*>(this->m_image + this->header()->m_descriptors_offset);
+		}
+
+	private:
+		// The image starts 8 byte aligned, storage is kept in 64 bit words for that reason.
+		// Mapped snapshots leave the storage empty and point into the mapping instead
+		//
+		std::vector<uint64_t> m_storage;
+		mapped_file m_mapping;
+		const std::byte* m_image;
+		std::vector<file*> m_files;
+	};
+}
@@ -0,0 +1,525 @@
+#include "glob.hpp"
+#include <algorithm>
+
+namespace zvfs
+{
+	namespace
+	{
+		// Brace expansion grows multiplicatively, refuse patterns that explode
+		//
+		constexpr size_t g_max_alternatives = 1024;
+
+		size_t skip_class(std::string_view text, size_t open)
+		{
+			size_t position = open + 1;
+			if (position < text.size() && (text[position] == '!' || text[position] == '^'))
+				position++;
+
+			// A closing bracket right after the opening one is a member of the class
+			//
+			if (position < text.size() && text[position] == ']')
+				position++;
+
+			while (position < text.size() && text[position] != ']')
+				position++;
+
+			return position;
+		}
+
+		bool expand_braces(std::string_view text, std::vector<std::string>& out_patterns)
+		{
+			size_t open = std::string_view::npos;
+			for (size_t i = 0; i < text.size(); i++)
+			{
+				if (text[i] == '[')
+				{
+					i = skip_class(text, i);
+					continue;
+				}
+
+				if (text[i] == '}')
+					return false;
+
+				if (text[i] == '{')
+				{
+					open = i;
+					break;
+				}
+			}
+
+			if (open == std::string_view::npos)
+			{
+				if (out_patterns.size() == g_max_alternatives)
+					return false;
+
+				out_patterns.emplace_back(text);
+				return true;
+			}
+
+			// Collect the top level options of the first brace, nested braces are expanded by the recursion
+			//
+			std::vector<std::string_view> options;
+			size_t depth = 0;
+			size_t option_start = open + 1;
+			size_t close = std::string_view::npos;
+
+			for (size_t i = open; i < text.size() && close == std::string_view::npos; i++)
+			{
+				switch (text[i])
+				{
+				case '[':
+					i = skip_class(text, i);
+					break;
+				case '{':
+					depth++;
+					break;
+				case '}':
+					if (--depth == 0)
+					{
+						options.push_back(text.substr(option_start, i - option_start));
+						close = i;
+					}
+					break;
+				case ',':
+					if (depth == 1)
+					{
+						options.push_back(text.substr(option_start, i - option_start));
+						option_start = i + 1;
+					}
+					break;
+				default:
+					break;
+				}
+			}
+
+			if (close == std::string_view::npos)
+				return false;
+
+			std::string_view prefix = text.substr(0, open);
+			std::string_view suffix = text.substr(close + 1);
+
+			std::string expanded;
+			for (std::string_view option : options)
+			{
+				expanded.assign(prefix);
+				expanded.append(option);
+				expanded.append(suffix);
+
+				if (!expand_braces(expanded, out_patterns))
+					return false;
+			}
+
+			return true;
+		}
+	}
+
+	/**
+	* Compiles a glob pattern
+	*
+	* @param[in] pattern		The pattern, for example "lod?/rock_*.{png,dds}"
+	* @param[in] ignore_case	Compare A-Z and a-z as equal
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the compiled pattern could not be allocated
+	*/
+	glob_pattern::glob_pattern(std::string_view pattern, bool ignore_case)
+		: m_ignore_case(ignore_case)
+		, m_valid(false)
+	{
+		this->m_valid = this->compile(pattern);
+
+		if (!this->m_valid)
+		{
+			this->m_alternatives.clear();
+			this->m_segments.clear();
+			this->m_tokens.clear();
+			this->m_classes.clear();
+		}
+	}
+
+	/**
+	* Checks if the pattern could be compiled
+	* Empty patterns, unbalanced braces, unclosed classes and patterns expanding to too many alternatives are invalid
+	*
+	* @exceptsafe no-throw
+	*/
+	bool glob_pattern::valid() const
+	{
+		return this->m_valid;
+	}
+
+	/**
+	* Matches a complete node path against the pattern
+	*
+	* @param[in] path		Complete node path, directories end in a slash
+	*						Example: "assets/lod0/rock.png"
+	*
+	* @returns				Returns true if the path matches
+	* @exceptsafe basic
+	*/
+	bool glob_pattern::match(std::string_view path) const
+	{
+		if (!this->m_valid || path.empty())
+			return false;
+
+		std::vector<state> states;
+		std::vector<state> next_states;
+		this->initial_states(states);
+
+		bool is_dir = path.back() == '/';
+		if (is_dir)
+			path.remove_suffix(1);
+
+		while (!states.empty())
+		{
+			size_t separator = path.find('/');
+			std::string_view name = path.substr(0, separator);
+			bool last = separator == std::string_view::npos;
+
+			this->step(states, name, is_dir || !last, next_states);
+			states.swap(next_states);
+
+			if (last)
+				return this->accepts(states, is_dir);
+
+			path.remove_prefix(separator + 1);
+		}
+
+		return false;
+	}
+
+	/**
+	* Retrieves the case mode the pattern was compiled with
+	*
+	* @exceptsafe no-throw
+	*/
+	bool glob_pattern::ignore_case() const
+	{
+		return this->m_ignore_case;
+	}
+
+	bool glob_pattern::compile(std::string_view pattern)
+	{
+		if (pattern.empty())
+			return false;
+
+		std::vector<std::string> expanded;
+		if (!expand_braces(pattern, expanded))
+			return false;
+
+		for (const std::string& it : expanded)
+		{
+			std::string_view text = it;
+
+			alternative entry = { static_cast<uint32_t>(this->m_segments.size()), 0, false };
+			if (!text.empty() && text.back() == '/')
+				entry.m_dirs_only = true;
+
+			// Empty components from leading, trailing or repeated slashes carry no meaning
+			//
+			while (!text.empty())
+			{
+				size_t separator = text.find('/');
+				std::string_view component = text.substr(0, separator);
+				text = separator == std::string_view::npos ? std::string_view() : text.substr(separator + 1);
+
+				if (component.empty())
+					continue;
+
+				// Consecutive globstars are equivalent to a single one
+				//
+				if (component == "**" && entry.m_segment_count && this->m_segments.back().m_kind == segment_kind::globstar)
+					continue;
+
+				segment compiled;
+				if (!this->compile_segment(component, compiled))
+					return false;
+
+				this->m_segments.push_back(std::move(compiled));
+				entry.m_segment_count++;
+			}
+
+			if (!entry.m_segment_count)
+				return false;
+
+			this->m_alternatives.push_back(entry);
+		}
+
+		return true;
+	}
+
+	bool glob_pattern::compile_segment(std::string_view text, segment& out)
+	{
+		out.m_first_token = static_cast<uint32_t>(this->m_tokens.size());
+		out.m_last_token = out.m_first_token;
+
+		if (text == "**")
+		{
+			out.m_kind = segment_kind::globstar;
+			return true;
+		}
+
+		bool literal = true;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			char c = text[i];
+
+			if (c == '*')
+			{
+				literal = false;
+				if (this->m_tokens.size() == out.m_first_token || this->m_tokens.back().m_kind != token_kind::star)
+					this->m_tokens.push_back({ token_kind::star, 0, 0 });
+			}
+			else if (c == '?')
+			{
+				literal = false;
+				this->m_tokens.push_back({ token_kind::any, 0, 0 });
+			}
+			else if (c == '[')
+			{
+				size_t close = skip_class(text, i);
+				if (close == text.size())
+					return false;
+
+				std::array<uint64_t, 4> members = {};
+				auto set_member = [&members](unsigned char value)
+				{
+					members[value >> 6] |= uint64_t(1) << (value & 63);
+				};
+
+				size_t position = i + 1;
+				bool negate = text[position] == '!' || text[position] == '^';
+				if (negate)
+					position++;
+
+				// A dash without an upper bound is taken literally, so "[a-]" contains 'a' and '-'
+				//
+				for (; position < close; position++)
+				{
+					unsigned char low = static_cast<unsigned char>(text[position]);
+					unsigned char high = low;
+
+					if (position + 2 < close && text[position + 1] == '-')
+					{
+						high = static_cast<unsigned char>(text[position + 2]);
+						position += 2;
+					}
+
+					for (unsigned value = low; value <= high; value++)
+					{
+						set_member(static_cast<unsigned char>(value));
+
+						if (this->m_ignore_case && value >= 'A' && value <= 'Z')
+							set_member(static_cast<unsigned char>(value + ('a' - 'A')));
+						else if (this->m_ignore_case && value >= 'a' && value <= 'z')
+							set_member(static_cast<unsigned char>(value - ('a' - 'A')));
+					}
+				}
+
+				if (negate)
+				{
+					for (uint64_t& it : members)
+						it = ~it;
+				}
+
+				literal = false;
+				this->m_tokens.push_back({ token_kind::char_class, 0, static_cast<uint32_t>(this->m_classes.size()) });
+				this->m_classes.push_back(members);
+				i = close;
+			}
+			else
+			{
+				this->m_tokens.push_back({ token_kind::literal, c, 0 });
+			}
+		}
+
+		out.m_last_token = static_cast<uint32_t>(this->m_tokens.size());
+		out.m_kind = literal ? segment_kind::literal : segment_kind::wildcard;
+
+		if (literal)
+			out.m_literal.assign(text);
+
+		return true;
+	}
+
+	bool glob_pattern::match_segment(const segment& entry, std::string_view name) const
+	{
+		if (entry.m_kind == segment_kind::globstar)
+			return true;
+
+		// Greedy matching that only ever backtracks to the most recent star, which is enough
+		// since every other token consumes exactly one character
+		//
+		size_t current = entry.m_first_token;
+		size_t position = 0;
+		size_t star_token = std::string_view::npos;
+		size_t star_position = 0;
+
+		while (position < name.size())
+		{
+			if (current < entry.m_last_token)
+			{
+				const token& it = this->m_tokens[current];
+				if (it.m_kind == token_kind::star)
+				{
+					star_token = ++current;
+					star_position = position;
+					continue;
+				}
+
+				if (this->match_token(it, name[position]))
+				{
+					current++;
+					position++;
+					continue;
+				}
+			}
+
+			if (star_token == std::string_view::npos)
+				return false;
+
+			current = star_token;
+			position = ++star_position;
+		}
+
+		while (current < entry.m_last_token && this->m_tokens[current].m_kind == token_kind::star)
+			current++;
+
+		return current == entry.m_last_token;
+	}
+
+	bool glob_pattern::match_token(const token& entry, char c) const
+	{
+		switch (entry.m_kind)
+		{
+		case token_kind::literal:
+			return this->fold(entry.m_value) == this->fold(c);
+		case token_kind::any:
+			return true;
+		case token_kind::char_class:
+		{
+			unsigned char value = static_cast<unsigned char>(c);
+			return (this->m_classes[entry.m_class][value >> 6] >> (value & 63)) & 1;
+		}
+		default:
+			return false;
+		}
+	}
+
+	char glob_pattern::fold(char c) const
+	{
+		if (this->m_ignore_case && c >= 'A' && c <= 'Z')
+			return static_cast<char>(c + ('a' - 'A'));
+
+		return c;
+	}
+
+	void glob_pattern::initial_states(std::vector<state>& out_states) const
+	{
+		out_states.clear();
+		for (size_t i = 0; i < this->m_alternatives.size(); i++)
+			out_states.push_back({ static_cast<uint32_t>(i), 0 });
+
+		this->close(out_states);
+	}
+
+	void glob_pattern::step(const std::vector<state>& states, std::string_view name, bool is_dir, std::vector<state>& out_states) const
+	{
+		out_states.clear();
+
+		for (const state& it : states)
+		{
+			const segment* pending = this->pending_segment(it);
+			if (!pending)
+				continue;
+
+			bool last = it.m_segment + 1 == this->m_alternatives[it.m_alternative].m_segment_count;
+
+			// A globstar stays active while descending into directories, the closure
+			// already tried to continue with the next segment in the parent
+			//
+			if (pending->m_kind == segment_kind::globstar)
+			{
+				if (is_dir)
+					out_states.push_back(it);
+				else if (last)
+					out_states.push_back({ it.m_alternative, it.m_segment + 1 });
+
+				continue;
+			}
+
+			// Files have no children, so they can only satisfy the last segment
+			//
+			if ((is_dir || last) && this->match_segment(*pending, name))
+				out_states.push_back({ it.m_alternative, it.m_segment + 1 });
+		}
+
+		this->close(out_states);
+	}
+
+	void glob_pattern::close(std::vector<state>& states) const
+	{
+		// A globstar may match zero directories, so the segment after it is reachable right away
+		//
+		for (size_t i = 0; i < states.size(); i++)
+		{
+			const segment* pending = this->pending_segment(states[i]);
+			if (pending && pending->m_kind == segment_kind::globstar)
+				states.push_back({ states[i].m_alternative, states[i].m_segment + 1 });
+		}
+
+		std::sort(states.begin(), states.end(), [](const state& lhs, const state& rhs)
+		{
+			return lhs.m_alternative != rhs.m_alternative ? lhs.m_alternative < rhs.m_alternative : lhs.m_segment < rhs.m_segment;
+		});
+
+		states.erase(std::unique(states.begin(), states.end(), [](const state& lhs, const state& rhs)
+		{
+			return lhs.m_alternative == rhs.m_alternative && lhs.m_segment == rhs.m_segment;
+		}), states.end());
+	}
+
+	bool glob_pattern::accepts(const std::vector<state>& states, bool is_dir) const
+	{
+		for (const state& it : states)
+		{
+			const alternative& entry = this->m_alternatives[it.m_alternative];
+			if (it.m_segment == entry.m_segment_count && (is_dir || !entry.m_dirs_only))
+				return true;
+		}
+
+		return false;
+	}
+
+	bool glob_pattern::can_continue(const std::vector<state>& states) const
+	{
+		for (const state& it : states)
+		{
+			if (this->pending_segment(it))
+				return true;
+		}
+
+		return false;
+	}
+
+	bool glob_pattern::literal_only(const std::vector<state>& states) const
+	{
+		for (const state& it : states)
+		{
+			const segment* pending = this->pending_segment(it);
+			if (pending && pending->m_kind != segment_kind::literal)
+				return false;
+		}
+
+		return true;
+	}
+
+	const glob_pattern::segment* glob_pattern::pending_segment(const state& position) const
+	{
+		const alternative& entry = this->m_alternatives[position.m_alternative];
+		if (position.m_segment == entry.m_segment_count)
+			return nullptr;
+
+		return &this->m_segments[entry.m_first_segment + position.m_segment];
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zvfs
+{
+	class vfs;
+
+	/**
+	* Compiled path glob
+	*
+	* Supported syntax, matched per path component:
+	*	*			Any number of characters inside one component
+	*	?			Exactly one character
+	*	[a-z0-9]	One character of a class, [!...] or [^...] negates it
+	*	{png,jpg}	Alternatives, may be nested and may contain slashes
+	*	**			As a whole component, any number of directories. As the last component, everything below
+	*
+	* A trailing slash only matches directories. Braces are expanded once on construction and all
+	* alternatives are matched together, so a node is reported once even if several alternatives match it
+	*/
+	class glob_pattern
+	{
+		friend class vfs;
+
+	public:
+		/**
+		* Compiles a glob pattern
+		*
+		* @param[in] pattern		The pattern, for example "lod?/rock_*.{png,dds}"
+		* @param[in] ignore_case	Compare A-Z and a-z as equal
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the compiled pattern could not be allocated
+		*/
+		[[nodiscard]] glob_pattern(std::string_view pattern, bool ignore_case);
+
+		/**
+		* Checks if the pattern could be compiled
+		* Empty patterns, unbalanced braces, unclosed classes and patterns expanding to too many alternatives are invalid
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool valid() const;
+
+		/**
+		* Matches a complete node path against the pattern
+		*
+		* @param[in] path		Complete node path, directories end in a slash
+		*						Example: "assets/lod0/rock.png"
+		*
+		* @returns				Returns true if the path matches
+		* @exceptsafe basic
+		*/
+		[[nodiscard]] bool match(std::string_view path) const;
+
+		/**
+		* Retrieves the case mode the pattern was compiled with
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool ignore_case() const;
+
+	private:
+		enum class token_kind : uint8_t
+		{
+			literal,
+			any,
+			star,
+			char_class
+		};
+
+		enum class segment_kind : uint8_t
+		{
+			literal,
+			wildcard,
+			globstar
+		};
+
+		struct token
+		{
+			token_kind m_kind;
+			char m_value;
+			uint32_t m_class;
+		};
+
+		struct segment
+		{
+			segment_kind m_kind;
+			uint32_t m_first_token;
+			uint32_t m_last_token;
+			std::string m_literal;
+		};
+
+		struct alternative
+		{
+			uint32_t m_first_segment;
+			uint32_t m_segment_count;
+			bool m_dirs_only;
+		};
+
+		/**
+		* Position inside one alternative, m_segment == segment count means the alternative matched completely
+		*/
+		struct state
+		{
+			uint32_t m_alternative;
+			uint32_t m_segment;
+		};
+
+		[[nodiscard]] bool compile(std::string_view pattern);
+		[[nodiscard]] bool compile_segment(std::string_view text, segment& out);
+		[[nodiscard]] bool match_segment(const segment& entry, std::string_view name) const;
+		[[nodiscard]] bool match_token(const token& entry, char c) const;
+		[[nodiscard]] char fold(char c) const;
+
+		void initial_states(std::vector<state>& out_states) const;
+		void step(const std::vector<state>& states, std::string_view name, bool is_dir, std::vector<state>& out_states) const;
+		void close(std::vector<state>& states) const;
+		[[nodiscard]] bool accepts(const std::vector<state>& states, bool is_dir) const;
+		[[nodiscard]] bool can_continue(const std::vector<state>& states) const;
+		[[nodiscard]] bool literal_only(const std::vector<state>& states) const;
+		[[nodiscard]] const segment* pending_segment(const state& position) const;
+
+	private:
+		std::vector<alternative> m_alternatives;
+		std::vector<segment> m_segments;
+		std::vector<token> m_tokens;
+		std::vector<std::array<uint64_t, 4>> m_classes;
+		bool m_ignore_case;
+		bool m_valid;
+	};
+}
@@ -0,0 +1,246 @@
+#include "hash.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZVFS_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace zvfs
+{
+	namespace
+	{
+		constexpr uint64_t g_ones = 0x0101010101010101ull;
+		constexpr uint64_t g_high_bits = 0x8080808080808080ull;
+		constexpr uint64_t g_multiplier = 0x9E3779B97F4A7C15ull;
+		constexpr uint64_t g_initial_state = 0xCBF29CE484222325ull;
+
+		// Assemble the word byte by byte so the result does not depend on the host byte order
+		// Compilers turn this into a single load on little endian targets
+		//
+		inline uint64_t load_word(const char* data)
+		{
+			uint64_t word = 0;
+			for (size_t i = 0; i < 8; i++)
+				word |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (i * 8);
+
+			return word;
+		}
+
+		inline uint64_t finalize(uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xFF51AFD7ED558CCDull;
+			value ^= value >> 33;
+			value *= 0xC4CEB9FE1A85EC53ull;
+			value ^= value >> 33;
+			return value;
+		}
+	}
+
+	/**
+	* Creates a new hasher
+	*
+	* @param[in] fold_case		Treat A-Z as a-z
+	* @param[in] ascii_only		Reject every character outside of the printable ASCII range
+	* @param[in] seed			Seed mixed into the initial state
+	*
+	* @exceptsafe no-throw
+	*/
+	path_hasher::path_hasher(bool fold_case, bool ascii_only, uint64_t seed)
+		: m_state(g_initial_state ^ seed)
+		, m_pending(0)
+		, m_length(0)
+		, m_invalid(0)
+		, m_pending_size(0)
+		, m_fold_case(fold_case)
+		, m_ascii_only(ascii_only)
+	{
+	}
+
+	/**
+	* Appends data to the hashed input
+	*
+	* @param[in] data			The next piece of the path
+	* @returns					A reference to this hasher
+	*
+	* @exceptsafe no-throw
+	*/
+	path_hasher& path_hasher::update(std::string_view data)
+	{
+		const char* current = data.data();
+		size_t remaining = data.size();
+
+		this->m_length += remaining;
+
+		// Complete a previously started word first
+		//
+		while (this->m_pending_size && remaining)
+		{
+			this->m_pending |= static_cast<uint64_t>(static_cast<unsigned char>(*current)) << (this->m_pending_size * 8);
+			this->m_pending_size++;
+			current++;
+			remaining--;
+
+			if (this->m_pending_size == 8)
+			{
+				this->absorb(this->transform(this->m_pending, this->m_invalid));
+				this->m_pending = 0;
+				this->m_pending_size = 0;
+			}
+		}
+
+#ifdef ZVFS_HASH_SSE2
+		// Validate and fold 16 bytes at once, the two halves are mixed exactly like two scalar words
+		//
+		if (this->m_ascii_only || this->m_fold_case)
+		{
+			const __m128i below = _mm_set1_epi8(32);
+			const __m128i above = _mm_set1_epi8(126);
+			const __m128i upper_begin = _mm_set1_epi8('A' - 1);
+			const __m128i upper_end = _mm_set1_epi8('Z' + 1);
+			const __m128i case_bit = _mm_set1_epi8(0x20);
+
+			int invalid = 0;
+			while (remaining >= 16)
+			{
+				__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+
+				// Signed compares also flag every byte >= 0x80 as being below 32
+				//
+				if (this->m_ascii_only)
+					invalid |= _mm_movemask_epi8(_mm_or_si128(_mm_cmplt_epi8(block, below), _mm_cmpgt_epi8(block, above)));
+
+				if (this->m_fold_case)
+				{
+					__m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(block, upper_begin), _mm_cmplt_epi8(block, upper_end));
+					block = _mm_or_si128(block, _mm_and_si128(is_upper, case_bit));
+				}
+
+				alignas(16) char folded[16];
+				_mm_store_si128(reinterpret_cast<__m128i*>(folded), block);
+
+				this->absorb(load_word(folded));
+				this->absorb(load_word(folded + 8));
+
+				current += 16;
+				remaining -= 16;
+			}
+
+			if (invalid)
+				this->m_invalid |= g_high_bits;
+		}
+#endif
+
+		while (remaining >= 8)
+		{
+			this->absorb(this->transform(load_word(current), this->m_invalid));
+			current += 8;
+			remaining -= 8;
+		}
+
+		// Keep the tail around, it will be completed by the next update or padded by digest
+		//
+		while (remaining)
+		{
+			this->m_pending |= static_cast<uint64_t>(static_cast<unsigned char>(*current)) << (this->m_pending_size * 8);
+			this->m_pending_size++;
+			current++;
+			remaining--;
+		}
+
+		return *this;
+	}
+
+	/**
+	* Computes the hash of all data appended so far. Does not modify the hasher state
+	*
+	* @returns					The hash value. Returns static_cast<size_t>(-1) if the input
+	*							contained illegal characters, valid input never hashes to that value
+	* @exceptsafe no-throw
+	*/
+	size_t path_hasher::digest() const
+	{
+		uint64_t invalid = this->m_invalid;
+		uint64_t state = this->m_state;
+
+		if (this->m_pending_size)
+		{
+			// Pad the unused bytes with a legal character for validation,
+			// then clear them again so the padding never reaches the hash
+			//
+			uint64_t used_mask = (uint64_t(1) << (this->m_pending_size * 8)) - 1;
+			uint64_t padded = this->m_pending | (~used_mask & (g_ones * 'a'));
+			uint64_t word = this->transform(padded, invalid) & used_mask;
+
+			state = (state ^ word) * g_multiplier;
+			state ^= state >> 29;
+		}
+
+		if (invalid)
+			return static_cast<size_t>(-1);
+
+		size_t result = static_cast<size_t>(finalize(state ^ this->m_length));
+		if (result == static_cast<size_t>(-1))
+			result--;
+
+		return result;
+	}
+
+	/**
+	* Checks if all data appended so far passed validation
+	*
+	* @exceptsafe no-throw
+	*/
+	bool path_hasher::valid() const
+	{
+		return this->digest() != static_cast<size_t>(-1);
+	}
+
+	/**
+	* Hashes a complete path in one call
+	*
+	* @param[in] path			The path to hash
+	* @param[in] fold_case		Treat A-Z as a-z
+	* @param[in] ascii_only		Reject every character outside of the printable ASCII range
+	* @param[in] seed			Seed mixed into the initial state
+	*
+	* @returns					See path_hasher::digest
+	* @exceptsafe no-throw
+	*/
+	size_t path_hasher::hash(std::string_view path, bool fold_case, bool ascii_only, uint64_t seed)
+	{
+		return path_hasher(fold_case, ascii_only, seed).update(path).digest();
+	}
+
+	void path_hasher::absorb(uint64_t word)
+	{
+		this->m_state = (this->m_state ^ word) * g_multiplier;
+		this->m_state ^= this->m_state >> 29;
+	}
+
+	uint64_t path_hasher::transform(uint64_t word, uint64_t& invalid) const
+	{
+		// Flag bytes below 0x20, above 0x7E or with the high bit set
+		// Branch free, the flags are only inspected once the whole input was consumed
+		//
+		if (this->m_ascii_only)
+		{
+			uint64_t below = (word - g_ones * 0x20) & ~word & g_high_bits;
+			uint64_t above = ((word + g_ones * (127 - 0x7E)) | word) & g_high_bits;
+			invalid |= below | above;
+		}
+
+		// Set the case bit on every byte within A-Z
+		//
+		if (this->m_fold_case)
+		{
+			uint64_t heptets = word & ~g_high_bits;
+			uint64_t is_above_z = heptets + g_ones * (0x7F - 'Z');
+			uint64_t is_from_a = heptets + g_ones * (0x80 - 'A');
+			uint64_t is_upper = (is_from_a ^ is_above_z) & ~word & g_high_bits;
+			word |= is_upper >> 2;
+		}
+
+		return word;
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace zvfs
+{
+	/**
+	* Streaming path hasher
+	*
+	* Folds ASCII case and validates the ASCII range in the same pass that feeds the hash.
+	* Input is consumed in 8 byte words (16 byte vectors where SSE2 is available) and
+	* never copied to the heap. Feeding a path in several pieces yields the same digest
+	* as feeding it at once, which allows hashing all prefixes of a path in one pass
+	*/
+	class path_hasher
+	{
+	public:
+		/**
+		* Creates a new hasher
+		*
+		* @param[in] fold_case		Treat A-Z as a-z
+		* @param[in] ascii_only		Reject every character outside of the printable ASCII range
+		* @param[in] seed			Seed mixed into the initial state
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] path_hasher(bool fold_case, bool ascii_only, uint64_t seed = 0);
+
+		/**
+		* Appends data to the hashed input
+		*
+		* @param[in] data			The next piece of the path
+		* @returns					A reference to this hasher
+		*
+		* @exceptsafe no-throw
+		*/
+		path_hasher& update(std::string_view data);
+
+		/**
+		* Computes the hash of all data appended so far. Does not modify the hasher state
+		*
+		* @returns					The hash value. Returns static_cast<size_t>(-1) if the input
+		*							contained illegal characters, valid input never hashes to that value
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t digest() const;
+
+		/**
+		* Checks if all data appended so far passed validation
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool valid() const;
+
+		/**
+		* Hashes a complete path in one call
+		*
+		* @param[in] path			The path to hash
+		* @param[in] fold_case		Treat A-Z as a-z
+		* @param[in] ascii_only		Reject every character outside of the printable ASCII range
+		* @param[in] seed			Seed mixed into the initial state
+		*
+		* @returns					See path_hasher::digest
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] static size_t hash(std::string_view path, bool fold_case, bool ascii_only, uint64_t seed = 0);
+
+	private:
+		void absorb(uint64_t word);
+		[[nodiscard]] uint64_t transform(uint64_t word, uint64_t& invalid) const;
+
+	private:
+		uint64_t m_state;
+		uint64_t m_pending;
+		uint64_t m_length;
+		uint64_t m_invalid;
+		size_t m_pending_size;
+		bool m_fold_case;
+		bool m_ascii_only;
+	};
+}
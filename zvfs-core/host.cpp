@@ -0,0 +1,514 @@
+#include "host.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace zvfs
+{
+	namespace
+	{
+		struct host_entry
+		{
+			size_t m_path_offset;
+			size_t m_path_size;
+			uint64_t m_size;
+			bool m_is_file;
+		};
+
+		// Entries of one host directory. Paths are relative to the root, directories end with a slash
+		//
+		struct directory_batch
+		{
+			std::string m_prefix;
+			std::string m_paths;
+			std::vector<host_entry> m_entries;
+		};
+
+		struct scan_state
+		{
+			thread_pool& m_pool;
+			const std::filesystem::path& m_root;
+			int m_root_descriptor;
+			std::mutex m_mutex;
+			std::vector<directory_batch> m_batches;
+
+			// Directories whose task couldn't open them, their entries are dropped from the parent batches
+			//
+			std::vector<std::string> m_skipped;
+
+			// Set by workers that failed to read a directory they had opened, the mount then adds nothing
+			//
+			std::atomic<bool> m_failed;
+		};
+
+		// Adds an entry to the batch and returns its path
+		//
+		std::string_view add_entry(directory_batch& batch, std::string_view name, bool is_file, uint64_t size)
+		{
+			host_entry& entry = batch.m_entries.emplace_back();
+			entry.m_path_offset = batch.m_paths.size();
+			entry.m_size = size;
+			entry.m_is_file = is_file;
+
+			batch.m_paths += batch.m_prefix;
+			batch.m_paths += name;
+			if (!is_file)
+				batch.m_paths += '/';
+
+			entry.m_path_size = batch.m_paths.size() - entry.m_path_offset;
+			return std::string_view(batch.m_paths).substr(entry.m_path_offset, entry.m_path_size);
+		}
+
+		// Vfs paths are UTF-8 with forward slashes, only Windows needs a conversion
+		//
+		std::filesystem::path::string_type native_path(std::string_view path)
+		{
+#ifdef _WIN32
+			return std::filesystem::path(std::u8string(path.begin(), path.end())).make_preferred().native();
+#else
+			return std::filesystem::path::string_type(path);
+#endif
+		}
+
+#ifdef __linux__
+		class descriptor_guard
+		{
+		public:
+			explicit descriptor_guard(int descriptor)
+				: m_descriptor(descriptor)
+			{
+			}
+
+			~descriptor_guard()
+			{
+				if (this->m_descriptor >= 0)
+					::close(this->m_descriptor);
+			}
+
+			descriptor_guard(const descriptor_guard&) = delete;
+			descriptor_guard& operator=(const descriptor_guard&) = delete;
+
+		private:
+			int m_descriptor;
+		};
+#endif
+
+		void scan_directory(scan_state& state, std::string prefix);
+
+		// Subdirectories are queued on the current worker, which takes them newest first. Idle workers steal
+		// the oldest ones, those are closest to the root and carry the largest subtrees
+		//
+		void submit_directory(scan_state& state, std::string_view path)
+		{
+			state.m_pool.submit([&state, prefix = std::string(path)]() mutable
+			{
+				scan_directory(state, std::move(prefix));
+			});
+		}
+
+		void skip_directory(scan_state& state, std::string prefix)
+		{
+			std::lock_guard<std::mutex> lock(state.m_mutex);
+			state.m_skipped.push_back(std::move(prefix));
+		}
+
+		void scan_directory(scan_state& state, std::string prefix)
+		{
+			directory_batch batch;
+			batch.m_prefix = std::move(prefix);
+
+#ifdef __linux__
+			// Subdirectories are opened relative to the root descriptor when their task runs, so queued
+			// directories hold no descriptor and the walk never runs out of them
+			//
+			int descriptor = state.m_root_descriptor;
+			if (!batch.m_prefix.empty())
+			{
+				descriptor = ::openat(state.m_root_descriptor, batch.m_prefix.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+				if (descriptor < 0)
+				{
+					skip_directory(state, std::move(batch.m_prefix));
+					return;
+				}
+			}
+
+			descriptor_guard guard(descriptor != state.m_root_descriptor ? descriptor : -1);
+
+			// One call returns hundreds of entries, readdir would fetch them the same way but copy each one again
+			//
+			alignas(8) char buffer[32 * 1024];
+			while (true)
+			{
+				long count = syscall(SYS_getdents64, descriptor, buffer, sizeof(buffer));
+				if (count < 0)
+				{
+					if (errno == EINTR)
+						continue;
+
+					state.m_failed.store(true, std::memory_order_relaxed);
+					return;
+				}
+
+				if (!count)
+					break;
+
+				// Records are laid out as 64 bit inode, 64 bit offset, 16 bit record length, 8 bit type and the name
+				//
+				for (long position = 0; position < count;)
+				{
+					const char* record = buffer + position;
+
+					uint16_t record_size = 0;
+					std::memcpy(&record_size, record + 16, sizeof(record_size));
+					position += record_size;
+
+					unsigned char type = static_cast<unsigned char>(record[18]);
+					const char* name = record + 19;
+					if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+						continue;
+
+					// Most file systems report the type, sizes are left to host_file so regular files need no stat
+					//
+					uint64_t size = host_file::g_unknown_size;
+					if (type == DT_UNKNOWN)
+					{
+						struct stat status;
+						if (::fstatat(descriptor, name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+							continue;
+
+						if (S_ISDIR(status.st_mode))
+							type = DT_DIR;
+						else if (S_ISREG(status.st_mode))
+							type = DT_REG;
+						else
+							continue;
+
+						size = static_cast<uint64_t>(status.st_size);
+					}
+
+					if (type == DT_DIR)
+						submit_directory(state, add_entry(batch, name, false, 0));
+					else if (type == DT_REG)
+						add_entry(batch, name, true, size);
+				}
+			}
+#else
+			std::error_code error;
+			std::filesystem::directory_iterator iterator(state.m_root / native_path(batch.m_prefix), error);
+
+			// Directories that can't be opened are skipped, failing to read one that was opened fails the mount
+			//
+			if (error)
+			{
+				if (!batch.m_prefix.empty())
+					skip_directory(state, std::move(batch.m_prefix));
+
+				return;
+			}
+
+			// The iterator caches the types the directory listing returned, only entries without one are inspected
+			//
+			for (; !error && iterator != std::filesystem::directory_iterator(); iterator.increment(error))
+			{
+				const std::filesystem::directory_entry& entry = *iterator;
+
+				std::error_code status_error;
+				std::filesystem::file_status status = entry.symlink_status(status_error);
+				if (status_error)
+					continue;
+
+				std::u8string name = entry.path().filename().u8string();
+				std::string_view name_view(reinterpret_cast<const char*>(name.data()), name.size());
+
+				if (std::filesystem::is_directory(status))
+				{
+					submit_directory(state, add_entry(batch, name_view, false, 0));
+				}
+				else if (std::filesystem::is_regular_file(status))
+				{
+					add_entry(batch, name_view, true, host_file::g_unknown_size);
+				}
+			}
+
+			if (error)
+			{
+				state.m_failed.store(true, std::memory_order_relaxed);
+				return;
+			}
+#endif
+
+			if (batch.m_entries.empty())
+				return;
+
+			std::lock_guard<std::mutex> lock(state.m_mutex);
+			state.m_batches.push_back(std::move(batch));
+		}
+	}
+
+	/**
+	* Creates a file referring to a host path
+	*
+	* @param[in] path		Native path of the file on the host
+	* @param[in] size		Size of the file if already known, g_unknown_size otherwise
+	*
+	* @exceptsafe no-throw
+	*/
+	host_file::host_file(std::filesystem::path::string_type path, uint64_t size)
+		: m_path(std::move(path))
+		, m_size(size)
+		, m_source(nullptr)
+	{
+	}
+
+	host_file::~host_file()
+	{
+		if (this->m_source)
+			this->m_source->release();
+	}
+
+	/**
+	* Retrieves the size of the file, queried from the host on first use and kept afterwards
+	*
+	* @returns				The size or 0 if the file could not be inspected
+	* @exceptsafe no-throw
+	*/
+	uint64_t host_file::size() const
+	{
+		// Racing threads query the same value, the atomic only keeps the store from tearing
+		//
+		uint64_t size = this->m_size.load(std::memory_order_relaxed);
+		if (size != g_unknown_size)
+			return size;
+
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExW(this->m_path.c_str(), GetFileExInfoStandard, &attributes))
+			return 0;
+
+		size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+#else
+		struct stat status;
+		if (::stat(this->m_path.c_str(), &status) != 0)
+			return 0;
+
+		size = static_cast<uint64_t>(status.st_size);
+#endif
+
+		this->m_size.store(size, std::memory_order_relaxed);
+		return size;
+	}
+
+	/**
+	* Reads file contents starting at an offset, like pread
+	* Reads at or past the end of the file read nothing, reads crossing the end are shortened
+	*
+	* @param[in] offset		Position of the first byte to read
+	* @param[out] out_buffer	Receives the contents, up to its size is read
+	*
+	* @returns				Number of bytes read or static_cast<size_t>(-1) if the file could not be opened or read
+	* @exceptsafe no-throw
+	*/
+	size_t host_file::read_at(uint64_t offset, std::span<std::byte> out_buffer) const
+	{
+		fd_source* source = nullptr;
+		try
+		{
+			source = this->acquire();
+		}
+		catch (const std::bad_alloc&)
+		{
+			return static_cast<size_t>(-1);
+		}
+
+		if (!source)
+			return static_cast<size_t>(-1);
+
+		uint64_t size = this->m_size.load(std::memory_order_relaxed);
+
+		size_t result = 0;
+		if (offset < size)
+		{
+			size_t count = static_cast<size_t>(std::min<uint64_t>(out_buffer.size(), size - offset));
+			result = source->read_at(offset, out_buffer.first(count));
+		}
+
+		source->release();
+		return result;
+	}
+
+	/**
+	* Closes the descriptor kept since the first read, the next read opens the file again
+	* Reads running meanwhile finish on the descriptor they started with
+	*
+	* @exceptsafe no-throw
+	*/
+	void host_file::drop_cache() const
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		if (!this->m_source)
+			return;
+
+		this->m_source->release();
+		this->m_source = nullptr;
+	}
+
+	/**
+	* Retrieves the path of the file on the host
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the path could not be allocated
+	*/
+	std::filesystem::path host_file::path() const
+	{
+		return std::filesystem::path(this->m_path);
+	}
+
+	fd_source* host_file::acquire() const
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		if (!this->m_source)
+		{
+			this->m_source = fd_source::open(this->m_path);
+			if (!this->m_source)
+				return nullptr;
+
+			// Opening already inspected the file, an unknown size is taken from there
+			//
+			if (this->m_size.load(std::memory_order_relaxed) == g_unknown_size)
+				this->m_size.store(this->m_source->size(), std::memory_order_relaxed);
+		}
+
+		// The reader's own reference keeps the descriptor open if drop_cache runs meanwhile
+		//
+		this->m_source->reference();
+		return this->m_source;
+	}
+
+	/**
+	* Adds a directory tree of the host file system to a vfs
+	* Every directory is scanned by one task of a zvfs::thread_pool, subdirectories become new tasks that idle
+	* workers steal. On Linux directories are read with large getdents64 batches and opened and inspected with
+	* openat and fstatat relative to the root descriptor, elsewhere std::filesystem::directory_iterator is used.
+	* Regular files are only inspected if the file system doesn't report entry types. All entries are then
+	* registered in one vfs::add_bulk pass, files become zvfs::host_file data.
+	* Symbolic links and special files are skipped, subdirectories that can't be opened are skipped with their contents
+	*
+	* @param[in] target			The vfs receiving the entries
+	* @param[in] root			The host directory, its contents are added at the root of the vfs
+	* @param[in] thread_count	Number of workers, 0 uses the number of hardware threads
+	*
+	* @returns				If the function succeeded it returns the number of mounted entries, directories included.
+	*						Paths that already had data keep it.
+	*						Returns -1 if the root could not be opened, a directory could not be read completely or
+	*						the vfs couldn't be modified, nothing is added then
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the entries could not be allocated. Nodes added up to this point remain valid
+	* @throws std::system_error	Thrown if a worker thread could not be started
+	*/
+	size_t mount_directory(vfs& target, const std::filesystem::path& root, size_t thread_count)
+	{
+#ifdef __linux__
+		int root_descriptor = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (root_descriptor < 0)
+			return static_cast<size_t>(-1);
+
+		descriptor_guard guard(root_descriptor);
+#else
+		std::error_code error;
+		if (!std::filesystem::is_directory(root, error))
+			return static_cast<size_t>(-1);
+
+		int root_descriptor = -1;
+#endif
+
+		std::vector<directory_batch> batches;
+		std::vector<std::string> skipped;
+		{
+			thread_pool pool(thread_count ? thread_count : std::max<size_t>(std::thread::hardware_concurrency(), 1));
+			scan_state state{ pool, root, root_descriptor, {}, {}, {}, false };
+
+			pool.submit([&state]()
+			{
+				scan_directory(state, {});
+			});
+
+			pool.wait();
+			if (state.m_failed.load(std::memory_order_relaxed))
+				return static_cast<size_t>(-1);
+
+			batches = std::move(state.m_batches);
+			skipped = std::move(state.m_skipped);
+		}
+
+		// Workers finish directories in any order, sorting them keeps the result independent of the thread count
+		//
+		std::sort(batches.begin(), batches.end(), [](const directory_batch& left, const directory_batch& right)
+		{
+			return left.m_prefix < right.m_prefix;
+		});
+
+		std::sort(skipped.begin(), skipped.end());
+
+		// Directories were added to their parent batch before their own task tried to open them
+		//
+		std::vector<std::string_view> views;
+		std::vector<const host_entry*> entries;
+		for (const directory_batch& batch : batches)
+		{
+			for (const host_entry& it : batch.m_entries)
+			{
+				std::string_view view = std::string_view(batch.m_paths).substr(it.m_path_offset, it.m_path_size);
+				if (!it.m_is_file && std::binary_search(skipped.begin(), skipped.end(), view))
+					continue;
+
+				views.push_back(view);
+				entries.push_back(&it);
+			}
+		}
+
+		std::vector<node_data**> slots;
+		size_t added = target.add_bulk(views, slots);
+		if (added == static_cast<size_t>(-1))
+			return added;
+
+		// Host paths are assembled as native strings, building a std::filesystem::path per file costs more than the scan
+		//
+		std::filesystem::path::string_type prefix = root.native();
+		if (!prefix.empty() && prefix.back() != std::filesystem::path::preferred_separator)
+			prefix += std::filesystem::path::preferred_separator;
+
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (!entries[i]->m_is_file || !slots[i] || *slots[i])
+				continue;
+
+			*slots[i] = new host_file(prefix + native_path(views[i]), entries[i]->m_size);
+		}
+
+		return added;
+	}
+}
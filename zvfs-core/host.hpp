@@ -0,0 +1,109 @@
+#pragma once
+#include "vfs.hpp"
+#include "node.hpp"
+#include "source.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <span>
+
+namespace zvfs
+{
+	/**
+	* File data referring to a regular file of the host file system
+	* The file is opened by its first read, the descriptor is kept for later reads until drop_cache() is called or
+	* the file is destroyed. Mounted files that are never read cost no handles, every file that was read holds one,
+	* so callers reading through large trees should drop each file after use.
+	* Directory scans usually learn the type of an entry but not its size, the size is queried on first use
+	*/
+	class host_file : public file
+	{
+	public:
+		static constexpr uint64_t g_unknown_size = UINT64_MAX;
+
+		/**
+		* Creates a file referring to a host path
+		*
+		* @param[in] path		Native path of the file on the host
+		* @param[in] size		Size of the file if already known, g_unknown_size otherwise
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] explicit host_file(std::filesystem::path::string_type path, uint64_t size = g_unknown_size);
+
+		~host_file() override;
+
+		/**
+		* Retrieves the size of the file, queried from the host on first use and kept afterwards
+		*
+		* @returns				The size or 0 if the file could not be inspected
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] uint64_t size() const override;
+
+		/**
+		* Reads file contents starting at an offset, like pread
+		* Reads at or past the end of the file read nothing, reads crossing the end are shortened
+		*
+		* @param[in] offset		Position of the first byte to read
+		* @param[out] out_buffer	Receives the contents, up to its size is read
+		*
+		* @returns				Number of bytes read or static_cast<size_t>(-1) if the file could not be opened or read
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t read_at(uint64_t offset, std::span<std::byte> out_buffer) const override;
+
+		/**
+		* Closes the descriptor kept since the first read, the next read opens the file again
+		* Reads running meanwhile finish on the descriptor they started with
+		*
+		* @exceptsafe no-throw
+		*/
+		void drop_cache() const override;
+
+		/**
+		* Retrieves the path of the file on the host
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the path could not be allocated
+		*/
+		[[nodiscard]] std::filesystem::path path() const;
+
+	private:
+		[[nodiscard]] fd_source* acquire() const;
+
+	private:
+		std::filesystem::path::string_type m_path;
+		mutable std::atomic<uint64_t> m_size;
+
+		// Opened by the first read, readers take their own reference under the mutex
+		//
+		mutable std::mutex m_mutex;
+		mutable fd_source* m_source;
+	};
+
+	/**
+	* Adds a directory tree of the host file system to a vfs
+	* Every directory is scanned by one task of a zvfs::thread_pool, subdirectories become new tasks that idle
+	* workers steal. On Linux directories are read with large getdents64 batches and opened and inspected with
+	* openat and fstatat relative to the root descriptor, elsewhere std::filesystem::directory_iterator is used.
+	* Regular files are only inspected if the file system doesn't report entry types. All entries are then
+	* registered in one vfs::add_bulk pass, files become zvfs::host_file data.
+	* Symbolic links and special files are skipped, subdirectories that can't be opened are skipped with their contents
+	*
+	* @param[in] target			The vfs receiving the entries
+	* @param[in] root			The host directory, its contents are added at the root of the vfs
+	* @param[in] thread_count	Number of workers, 0 uses the number of hardware threads
+	*
+	* @returns				If the function succeeded it returns the number of mounted entries, directories included.
+	*						Paths that already had data keep it.
+	*						Returns -1 if the root could not be opened, a directory could not be read completely or
+	*						the vfs couldn't be modified, nothing is added then
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the entries could not be allocated. Nodes added up to this point remain valid
+	* @throws std::system_error	Thrown if a worker thread could not be started
+	*/
+	[[nodiscard]] extern size_t mount_directory(vfs& target, const std::filesystem::path& root, size_t thread_count = 0);
+}
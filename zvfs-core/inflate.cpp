@@ -0,0 +1,427 @@
+#include "inflate.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace zvfs
+{
+	namespace
+	{
+		constexpr uint32_t g_max_bits = 15;
+
+		// Codes up to this length are resolved with one table lookup
+		//
+		constexpr uint32_t g_table_bits = 9;
+
+		constexpr uint16_t g_length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		constexpr uint8_t g_length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		constexpr uint16_t g_distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		constexpr uint8_t g_distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+		constexpr uint8_t g_code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		// Bits are consumed least significant first, the buffer is topped up a byte at a time
+		//
+		class bit_reader
+		{
+		public:
+			explicit bit_reader(std::span<const std::byte> input)
+				: m_data(reinterpret_cast<const uint8_t*>(input.data()))
+				, m_size(input.size())
+				, m_position(0)
+				, m_bits(0)
+				, m_count(0)
+			{
+			}
+
+			bool fill(uint32_t count)
+			{
+				while (this->m_count < count)
+				{
+					if (this->m_position == this->m_size)
+						return false;
+
+					this->m_bits |= static_cast<uint64_t>(this->m_data[this->m_position++]) << this->m_count;
+					this->m_count += 8;
+				}
+
+				return true;
+			}
+
+			uint32_t peek(uint32_t count) const
+			{
+				return static_cast<uint32_t>(this->m_bits & ((uint64_t(1) << count) - 1));
+			}
+
+			void consume(uint32_t count)
+			{
+				this->m_bits >>= count;
+				this->m_count -= count;
+			}
+
+			bool read(uint32_t count, uint32_t& out_value)
+			{
+				if (!this->fill(count))
+					return false;
+
+				out_value = this->peek(count);
+				this->consume(count);
+				return true;
+			}
+
+			uint32_t available() const
+			{
+				return this->m_count;
+			}
+
+			void align()
+			{
+				this->consume(this->m_count % 8);
+			}
+
+			// Stored blocks start byte aligned, whole bytes still in the buffer come first
+			//
+			bool copy_bytes(uint8_t* out, size_t size)
+			{
+				while (size && this->m_count >= 8)
+				{
+					*out++ = static_cast<uint8_t>(this->peek(8));
+					this->consume(8);
+					size--;
+				}
+
+				if (size > this->m_size - this->m_position)
+					return false;
+
+				std::memcpy(out, this->m_data + this->m_position, size);
+				this->m_position += size;
+				return true;
+			}
+
+		private:
+			const uint8_t* m_data;
+			size_t m_size;
+			size_t m_position;
+			uint64_t m_bits;
+			uint32_t m_count;
+		};
+
+		// Canonical Huffman code. Short codes are looked up by their bit reversed value, each table entry
+		// holds the symbol and the code length. Longer codes are decoded one bit at a time from the counts
+		//
+		class huffman
+		{
+		public:
+			bool build(const uint8_t* lengths, uint32_t count)
+			{
+				std::memset(this->m_counts, 0, sizeof(this->m_counts));
+				for (uint32_t i = 0; i < count; i++)
+					this->m_counts[lengths[i]]++;
+
+				this->m_counts[0] = 0;
+
+				// Over-subscribed codes can't be decoded, incomplete ones are allowed for single codes
+				//
+				int32_t left = 1;
+				for (uint32_t length = 1; length <= g_max_bits; length++)
+				{
+					left = (left << 1) - this->m_counts[length];
+					if (left < 0)
+						return false;
+				}
+
+				uint16_t offsets[g_max_bits + 1] = {};
+				for (uint32_t length = 1; length < g_max_bits; length++)
+					offsets[length + 1] = offsets[length] + this->m_counts[length];
+
+				for (uint32_t symbol = 0; symbol < count; symbol++)
+				{
+					if (lengths[symbol])
+						this->m_symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+				}
+
+				std::memset(this->m_table, 0, sizeof(this->m_table));
+
+				uint32_t code = 0;
+				uint32_t index = 0;
+				for (uint32_t length = 1; length <= g_table_bits; length++)
+				{
+					for (uint32_t i = 0; i < this->m_counts[length]; i++)
+					{
+						uint32_t reversed = 0;
+						for (uint32_t bit = 0; bit < length; bit++)
+							reversed |= (((code + i) >> bit) & 1) << (length - 1 - bit);
+
+						uint16_t entry = static_cast<uint16_t>((this->m_symbols[index + i] << 4) | length);
+						for (uint32_t slot = reversed; slot < (1u << g_table_bits); slot += 1u << length)
+							this->m_table[slot] = entry;
+					}
+
+					index += this->m_counts[length];
+					code = (code + this->m_counts[length]) << 1;
+				}
+
+				return true;
+			}
+
+			bool decode(bit_reader& reader, uint32_t& out_symbol) const
+			{
+				// Near the end of the stream fewer bits than a table index may be left, the entry is only
+				// used if its code fits into them
+				//
+				reader.fill(g_table_bits);
+				uint16_t entry = this->m_table[reader.peek(g_table_bits)];
+				if (entry && (entry & 15u) <= reader.available())
+				{
+					reader.consume(entry & 15u);
+					out_symbol = entry >> 4;
+					return true;
+				}
+
+				int32_t code = 0;
+				int32_t first = 0;
+				int32_t index = 0;
+				for (uint32_t length = 1; length <= g_max_bits; length++)
+				{
+					uint32_t bit = 0;
+					if (!reader.read(1, bit))
+						return false;
+
+					code |= static_cast<int32_t>(bit);
+					int32_t count = this->m_counts[length];
+					if (code - count < first)
+					{
+						out_symbol = this->m_symbols[index + (code - first)];
+						return true;
+					}
+
+					index += count;
+					first = (first + count) << 1;
+					code <<= 1;
+				}
+
+				return false;
+			}
+
+		private:
+			uint16_t m_counts[g_max_bits + 1];
+			uint16_t m_symbols[288];
+			uint16_t m_table[1u << g_table_bits];
+		};
+
+		bool inflate_block(bit_reader& reader, const huffman& literals, const huffman& distances, uint8_t* out, size_t size, size_t& position)
+		{
+			while (true)
+			{
+				uint32_t symbol = 0;
+				if (!literals.decode(reader, symbol))
+					return false;
+
+				if (symbol < 256)
+				{
+					if (position == size)
+						return false;
+
+					out[position++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+
+				if (symbol == 256)
+					return true;
+
+				symbol -= 257;
+				if (symbol >= 29)
+					return false;
+
+				uint32_t extra = 0;
+				if (!reader.read(g_length_extra[symbol], extra))
+					return false;
+
+				size_t length = g_length_base[symbol] + extra;
+
+				uint32_t distance_symbol = 0;
+				if (!distances.decode(reader, distance_symbol) || distance_symbol >= 30)
+					return false;
+
+				if (!reader.read(g_distance_extra[distance_symbol], extra))
+					return false;
+
+				size_t distance = g_distance_base[distance_symbol] + extra;
+				if (distance > position || length > size - position)
+					return false;
+
+				// Copies may overlap their own output, byte by byte repeats the pattern as intended
+				//
+				const uint8_t* from = out + position - distance;
+				for (size_t i = 0; i < length; i++)
+					out[position + i] = from[i];
+
+				position += length;
+			}
+		}
+
+		bool build_fixed(huffman& literals, huffman& distances)
+		{
+			uint8_t lengths[288];
+			std::memset(lengths, 8, 144);
+			std::memset(lengths + 144, 9, 112);
+			std::memset(lengths + 256, 7, 24);
+			std::memset(lengths + 280, 8, 8);
+
+			if (!literals.build(lengths, 288))
+				return false;
+
+			std::memset(lengths, 5, 30);
+			return distances.build(lengths, 30);
+		}
+
+		bool build_dynamic(bit_reader& reader, huffman& literals, huffman& distances)
+		{
+			uint32_t literal_count = 0;
+			uint32_t distance_count = 0;
+			uint32_t code_length_count = 0;
+			if (!reader.read(5, literal_count) || !reader.read(5, distance_count) || !reader.read(4, code_length_count))
+				return false;
+
+			literal_count += 257;
+			distance_count += 1;
+			code_length_count += 4;
+			if (literal_count > 286 || distance_count > 30)
+				return false;
+
+			uint8_t lengths[286 + 30] = {};
+			for (uint32_t i = 0; i < code_length_count; i++)
+			{
+				uint32_t length = 0;
+				if (!reader.read(3, length))
+					return false;
+
+				lengths[g_code_length_order[i]] = static_cast<uint8_t>(length);
+			}
+
+			huffman code_lengths;
+			if (!code_lengths.build(lengths, 19))
+				return false;
+
+			std::memset(lengths, 0, sizeof(lengths));
+
+			// Literal and distance lengths form one sequence, repeats may cross from one into the other
+			//
+			uint32_t total = literal_count + distance_count;
+			uint32_t index = 0;
+			while (index < total)
+			{
+				uint32_t symbol = 0;
+				if (!code_lengths.decode(reader, symbol))
+					return false;
+
+				if (symbol < 16)
+				{
+					lengths[index++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+
+				uint8_t value = 0;
+				uint32_t repeat = 0;
+				if (symbol == 16)
+				{
+					if (!index || !reader.read(2, repeat))
+						return false;
+
+					value = lengths[index - 1];
+					repeat += 3;
+				}
+				else if (symbol == 17)
+				{
+					if (!reader.read(3, repeat))
+						return false;
+
+					repeat += 3;
+				}
+				else
+				{
+					if (!reader.read(7, repeat))
+						return false;
+
+					repeat += 11;
+				}
+
+				if (repeat > total - index)
+					return false;
+
+				std::memset(lengths + index, value, repeat);
+				index += repeat;
+			}
+
+			// A block without an end of block code could never finish
+			//
+			if (!lengths[256])
+				return false;
+
+			return literals.build(lengths, literal_count) && distances.build(lengths + literal_count, distance_count);
+		}
+	}
+
+	/**
+	* Decompresses a raw DEFLATE stream (RFC 1951) whose decompressed size is known, as stored in ZIP archives
+	* Huffman codes up to 9 bits are decoded through a lookup table, longer ones bit by bit
+	*
+	* @param[in] input		The compressed stream
+	* @param[out] output	Receives the decompressed data, has to be exactly as large as the decompressed stream
+	*
+	* @returns				Returns true if the stream was valid and filled output completely
+	* @exceptsafe no-throw
+	*/
+	bool inflate(std::span<const std::byte> input, std::span<std::byte> output)
+	{
+		bit_reader reader(input);
+		uint8_t* out = reinterpret_cast<uint8_t*>(output.data());
+		size_t size = output.size();
+		size_t position = 0;
+
+		huffman literals;
+		huffman distances;
+
+		uint32_t last = 0;
+		while (!last)
+		{
+			uint32_t type = 0;
+			if (!reader.read(1, last) || !reader.read(2, type))
+				return false;
+
+			if (type == 0)
+			{
+				reader.align();
+
+				uint32_t length = 0;
+				uint32_t complement = 0;
+				if (!reader.read(16, length) || !reader.read(16, complement) || length != (~complement & 0xFFFFu))
+					return false;
+
+				if (length > size - position || !reader.copy_bytes(out + position, length))
+					return false;
+
+				position += length;
+				continue;
+			}
+
+			if (type == 1)
+			{
+				if (!build_fixed(literals, distances))
+					return false;
+			}
+			else if (type == 2)
+			{
+				if (!build_dynamic(reader, literals, distances))
+					return false;
+			}
+			else
+			{
+				return false;
+			}
+
+			if (!inflate_block(reader, literals, distances, out, size, position))
+				return false;
+		}
+
+		return position == size;
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <span>
+
+namespace zvfs
+{
+	/**
+	* Decompresses a raw DEFLATE stream (RFC 1951) whose decompressed size is known, as stored in ZIP archives
+	* Huffman codes up to 9 bits are decoded through a lookup table, longer ones bit by bit
+	*
+	* @param[in] input		The compressed stream
+	* @param[out] output	Receives the decompressed data, has to be exactly as large as the decompressed stream
+	*
+	* @returns				Returns true if the stream was valid and filled output completely
+	* @exceptsafe no-throw
+	*/
+	[[nodiscard]] extern bool inflate(std::span<const std::byte> input, std::span<std::byte> output);
+}
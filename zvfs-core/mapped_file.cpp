@@ -0,0 +1,225 @@
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zvfs
+{
+	/**
+	* Creates an object that maps nothing
+	*
+	* @exceptsafe no-throw
+	*/
+	mapped_file::mapped_file()
+		: m_data(nullptr)
+		, m_size(0)
+	{
+	}
+
+	/**
+	* Unmaps the file
+	*
+	* @exceptsafe no-throw
+	*/
+	mapped_file::~mapped_file()
+	{
+		this->close();
+	}
+
+	mapped_file::mapped_file(mapped_file&& other) noexcept
+		: m_data(std::exchange(other.m_data, nullptr))
+		, m_size(std::exchange(other.m_size, 0))
+	{
+	}
+
+	mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+	{
+		if (this != &other)
+		{
+			this->close();
+			this->m_data = std::exchange(other.m_data, nullptr);
+			this->m_size = std::exchange(other.m_size, 0);
+		}
+
+		return *this;
+	}
+
+	/**
+	* Maps a file, a previous mapping is released first
+	*
+	* @param[in] path		Path of the file
+	*
+	* @returns				Returns true if the file was mapped. Empty files can't be mapped
+	* @exceptsafe no-throw
+	*/
+	bool mapped_file::open(const std::filesystem::path& path)
+	{
+		this->close();
+
+#ifdef _WIN32
+		HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(handle, &file_size) || file_size.QuadPart <= 0 || static_cast<unsigned long long>(file_size.QuadPart) > SIZE_MAX)
+		{
+			CloseHandle(handle);
+			return false;
+		}
+
+		// The view keeps the mapping object and the file alive, both handles can be closed right away
+		//
+		HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(handle);
+		if (!mapping)
+			return false;
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!view)
+			return false;
+
+		this->m_data = static_cast<const std::byte*>(view);
+		this->m_size = static_cast<size_t>(file_size.QuadPart);
+#else
+		int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (descriptor < 0)
+			return false;
+
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size <= 0 || static_cast<unsigned long long>(status.st_size) > SIZE_MAX)
+		{
+			::close(descriptor);
+			return false;
+		}
+
+		// The mapping holds its own reference to the file, the descriptor is not needed afterwards
+		//
+		size_t size = static_cast<size_t>(status.st_size);
+		void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+		::close(descriptor);
+		if (view == MAP_FAILED)
+			return false;
+
+		this->m_data = static_cast<const std::byte*>(view);
+		this->m_size = size;
+#endif
+
+		return true;
+	}
+
+	/**
+	* Releases the mapping, pointers into it become invalid
+	*
+	* @exceptsafe no-throw
+	*/
+	void mapped_file::close()
+	{
+		if (!this->m_data)
+			return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(this->m_data);
+#else
+		munmap(const_cast<std::byte*>(this->m_data), this->m_size);
+#endif
+
+		this->m_data = nullptr;
+		this->m_size = 0;
+	}
+
+	/**
+	* Checks if a file is mapped
+	*
+	* @exceptsafe no-throw
+	*/
+	bool mapped_file::is_open() const
+	{
+		return this->m_data != nullptr;
+	}
+
+	/**
+	* Retrieves the first byte of the mapping, page aligned
+	*
+	* @returns				The mapped bytes or a nullptr if nothing is mapped
+	* @exceptsafe no-throw
+	*/
+	const std::byte* mapped_file::data() const
+	{
+		return this->m_data;
+	}
+
+	/**
+	* Retrieves the number of mapped bytes
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t mapped_file::size() const
+	{
+		return this->m_size;
+	}
+
+	/**
+	* Tells the operating system how a range of the mapping is going to be accessed
+	* Hints are advisory, hints a platform doesn't support are ignored
+	*
+	* @param[in] hints		Combination of g_sequential (read ahead aggressively), g_willneed (start reading now)
+	*						and g_hugepage (back the range with huge pages where possible)
+	* @param[in] offset		First byte of the range
+	* @param[in] length		Length of the range, clamped to the mapping
+	*
+	* @exceptsafe no-throw
+	*/
+	void mapped_file::advise(uint32_t hints, size_t offset, size_t length) const
+	{
+		if (!this->m_data || offset >= this->m_size)
+			return;
+
+		length = std::min(length, this->m_size - offset);
+
+#ifdef _WIN32
+		// Windows only knows about prefetching, read ahead and large pages are not available for file views
+		//
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+		if (hints & g_willneed)
+		{
+			WIN32_MEMORY_RANGE_ENTRY range = { const_cast<std::byte*>(this->m_data) + offset, length };
+			PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+		}
+#else
+		(void)hints;
+		(void)length;
+#endif
+#else
+		// madvise wants a page aligned start, the range is widened to the page holding the first byte
+		//
+		size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		size_t aligned_offset = offset & ~(page_size - 1);
+		void* start = const_cast<std::byte*>(this->m_data) + aligned_offset;
+		length += offset - aligned_offset;
+
+		if (hints & g_sequential)
+			madvise(start, length, MADV_SEQUENTIAL);
+
+		if (hints & g_willneed)
+			madvise(start, length, MADV_WILLNEED);
+
+#ifdef MADV_HUGEPAGE
+		if (hints & g_hugepage)
+			madvise(start, length, MADV_HUGEPAGE);
+#endif
+#endif
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace zvfs
+{
+	/**
+	* Read-only memory mapping of a whole file
+	*
+	* The mapping is shared, processes mapping the same file use the same physical pages through the page cache.
+	* Pages are only read from disk when they are first touched, opening costs the same for any file size
+	*/
+	class mapped_file
+	{
+	public:
+		// Access hints for advise(), they can be combined
+		//
+		static constexpr uint32_t g_sequential = 1;
+		static constexpr uint32_t g_willneed = 2;
+		static constexpr uint32_t g_hugepage = 4;
+
+		/**
+		* Creates an object that maps nothing
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] mapped_file();
+
+		/**
+		* Unmaps the file
+		*
+		* @exceptsafe no-throw
+		*/
+		~mapped_file();
+
+		mapped_file(mapped_file&& other) noexcept;
+		mapped_file& operator=(mapped_file&& other) noexcept;
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		/**
+		* Maps a file, a previous mapping is released first
+		*
+		* @param[in] path		Path of the file
+		*
+		* @returns				Returns true if the file was mapped. Empty files can't be mapped
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool open(const std::filesystem::path& path);
+
+		/**
+		* Releases the mapping, pointers into it become invalid
+		*
+		* @exceptsafe no-throw
+		*/
+		void close();
+
+		/**
+		* Checks if a file is mapped
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool is_open() const;
+
+		/**
+		* Retrieves the first byte of the mapping, page aligned
+		*
+		* @returns				The mapped bytes or a nullptr if nothing is mapped
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] const std::byte* data() const;
+
+		/**
+		* Retrieves the number of mapped bytes
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t size() const;
+
+		/**
+		* Tells the operating system how a range of the mapping is going to be accessed
+		* Hints are advisory, hints a platform doesn't support are ignored
+		*
+		* @param[in] hints		Combination of g_sequential (read ahead aggressively), g_willneed (start reading now)
+		*						and g_hugepage (back the range with huge pages where possible)
+		* @param[in] offset		First byte of the range
+		* @param[in] length		Length of the range, clamped to the mapping
+		*
+		* @exceptsafe no-throw
+		*/
+		void advise(uint32_t hints, size_t offset = 0, size_t length = SIZE_MAX) const;
+
+	private:
+		const std::byte* m_data;
+		size_t m_size;
+	};
+}
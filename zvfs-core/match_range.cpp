@@ -0,0 +1,129 @@
+#include "match_range.hpp"
+#include "path.hpp"
+
+namespace zvfs
+{
+	node* match_range::iterator::operator*() const
+	{
+		return this->m_range->m_current;
+	}
+
+	match_range::iterator& match_range::iterator::operator++()
+	{
+		this->m_range->advance();
+		return *this;
+	}
+
+	void match_range::iterator::operator++(int)
+	{
+		this->m_range->advance();
+	}
+
+	bool match_range::iterator::operator==(std::default_sentinel_t) const
+	{
+		return !this->m_range->m_current;
+	}
+
+	match_range::iterator::iterator(match_range* range)
+		: m_range(range)
+	{
+	}
+
+	/**
+	* Retrieves an iterator to the current match, the first call searches for the first match
+	*
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the search state could not grow
+	*/
+	match_range::iterator match_range::begin()
+	{
+		if (!this->m_started)
+		{
+			this->m_started = true;
+			this->advance();
+		}
+
+		return iterator(this);
+	}
+
+	/**
+	* Retrieves the sentinel marking the end of the search
+	*
+	* @exceptsafe no-throw
+	*/
+	std::default_sentinel_t match_range::end() const
+	{
+		return std::default_sentinel;
+	}
+
+	match_range::match_range(std::string_view filter, bool ignore_case)
+		: m_dir_locks(nullptr)
+		, m_filter(filter)
+		, m_next_candidate(0)
+		, m_current(nullptr)
+		, m_use_candidates(false)
+		, m_ignore_case(ignore_case)
+		, m_started(false)
+	{
+	}
+
+	void match_range::advance()
+	{
+		this->m_current = nullptr;
+
+		// Index candidates only contain all trigrams of the filter, each of them still has to be verified
+		//
+		if (this->m_use_candidates)
+		{
+			while (this->m_next_candidate < this->m_candidates.size())
+			{
+				node* candidate = this->m_candidates[this->m_next_candidate++];
+
+				this->m_path_buffer.resize(candidate->m_path_size);
+				candidate->write_path(this->m_path_buffer.data());
+
+				if (path::contains(this->m_path_buffer, this->m_filter, this->m_ignore_case))
+				{
+					this->m_current = candidate;
+					return;
+				}
+			}
+
+			return;
+		}
+
+		// Depth first walk that assembles each path in the shared buffer, the path of a popped
+		// node's parent is always still a prefix of the buffer
+		//
+		while (!this->m_pending.empty())
+		{
+			node* current = this->m_pending.back();
+			this->m_pending.pop_back();
+
+			size_t parent_size = current->m_parent ? current->m_parent->m_path_size : 0;
+			this->m_path_buffer.resize(parent_size);
+			this->m_path_buffer.append(current->m_name, current->m_name_size);
+
+			if (!current->m_is_file)
+			{
+				// A thread safe vfs may be adding children right now, their directory is locked meanwhile
+				//
+				std::shared_lock<std::shared_mutex> dir_lock;
+				if (this->m_dir_locks)
+					dir_lock = std::shared_lock<std::shared_mutex>(this->m_dir_locks->get(current));
+
+				if (current->m_dir)
+				{
+					for (node* it : *current->m_dir)
+						this->m_pending.push_back(it);
+				}
+			}
+
+			if (path::contains(this->m_path_buffer, this->m_filter, this->m_ignore_case))
+			{
+				this->m_current = current;
+				return;
+			}
+		}
+	}
+}
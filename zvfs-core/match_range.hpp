@@ -0,0 +1,89 @@
+#pragma once
+#include "node.hpp"
+#include <cstddef>
+#include <iterator>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Lazily evaluated result of a substring search over node paths
+	*
+	* Matches are produced one at a time while iterating, so stopping early skips the rest of the search
+	* and no result list is built. The range is a single pass input range, created by vfs::matches.
+	* The vfs must not be modified while a range is iterated. A thread safe vfs stays read locked
+	* until the range is destroyed, so adding or removing nodes on the same thread meanwhile deadlocks
+	*/
+	class match_range
+	{
+		friend class vfs;
+
+	public:
+		/**
+		* Input iterator over the matching nodes
+		*
+		*/
+		class iterator
+		{
+			friend class match_range;
+
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = node*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = node**;
+			using reference = node*;
+
+			[[nodiscard]] node* operator*() const;
+			iterator& operator++();
+			void operator++(int);
+			[[nodiscard]] bool operator==(std::default_sentinel_t) const;
+
+		private:
+			explicit iterator(match_range* range);
+
+			match_range* m_range;
+		};
+
+		match_range(const match_range&) = delete;
+		match_range& operator=(const match_range&) = delete;
+		match_range(match_range&&) = default;
+		match_range& operator=(match_range&&) = default;
+
+		/**
+		* Retrieves an iterator to the current match, the first call searches for the first match
+		*
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if the search state could not grow
+		*/
+		[[nodiscard]] iterator begin();
+
+		/**
+		* Retrieves the sentinel marking the end of the search
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] std::default_sentinel_t end() const;
+
+	private:
+		match_range(std::string_view filter, bool ignore_case);
+
+		void advance();
+
+	private:
+		std::shared_lock<std::shared_mutex> m_lock;
+		dir_locks* m_dir_locks;
+		std::string m_filter;
+		std::string m_path_buffer;
+		std::vector<node*> m_pending;
+		std::vector<node*> m_candidates;
+		size_t m_next_candidate;
+		node* m_current;
+		bool m_use_candidates;
+		bool m_ignore_case;
+		bool m_started;
+	};
+}
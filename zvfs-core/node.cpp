@@ -1,6 +1,17 @@
 #include "node.hpp"
+#include "path.hpp"
+#include "hash.hpp"
+#include <algorithm>
+#include <cstring>
 namespace zvfs
 {
+	namespace
+	{
+		// Directories below this size are scanned, hashing the name wouldn't pay off
+		//
+		constexpr size_t g_lookup_threshold = 16;
+	}
+
 	/**
 	* Retrieves a the nodes parent node
 	* 
@@ -15,6 +26,7 @@ namespace zvfs
 
 	/**
 	* Sets the nodes parent node
+	* The path of this node is derived from the parent chain
 	* 
 	* @param[in] parent		The parent node pointer
 	*
@@ -22,17 +34,84 @@ namespace zvfs
 	*/
 	void node::set_parent(node* parent)
 	{
+		// A cached path is stale once the parent chain changes
+		//
+		if (char* cached = this->m_path.exchange(nullptr, std::memory_order_relaxed))
+			this->m_resource->deallocate(cached, this->m_path_size, 1);
+
 		this->m_parent = parent;
+		this->m_path_size = this->m_name_size + (parent ? parent->m_path_size : 0);
 	}
 
 	/**
 	* Retrieves the nodes full path
+	* Nodes only store their own name, the full path is assembled on first use and cached
 	*
-	* @exceptsafe no-throw
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the path could not be materialized
 	*/
 	std::string_view node::path()
 	{
-		return this->m_path;
+		// Nodes directly below the root share their path with their name
+		//
+		if (this->m_path_size == this->m_name_size)
+			return { this->m_name, this->m_name_size };
+
+		// Concurrent readers may race to fill the cache, the first published copy wins
+		//
+		char* cached = this->m_path.load(std::memory_order_acquire);
+		if (!cached)
+		{
+			char* path = static_cast<char*>(this->m_resource->allocate(this->m_path_size, 1));
+			this->write_path(path);
+
+			if (this->m_path.compare_exchange_strong(cached, path, std::memory_order_acq_rel, std::memory_order_acquire))
+				cached = path;
+			else
+				this->m_resource->deallocate(path, this->m_path_size, 1);
+		}
+
+		return { cached, this->m_path_size };
+	}
+
+	/**
+	* Retrieves the last component of the nodes path
+	* Directory names keep their trailing slash
+	*
+	* @exceptsafe no-throw
+	*/
+	std::string_view node::name()
+	{
+		return { this->m_name, this->m_name_size };
+	}
+
+	/**
+	* Compares the nodes full path against a string without materializing it
+	*
+	* @param[in] path		The path to compare against
+	* @param[in] ignore_case	Compare A-Z and a-z as equal
+	*
+	* @exceptsafe no-throw
+	*/
+	bool node::path_equals(std::string_view path, bool ignore_case)
+	{
+		if (path.size() != this->m_path_size)
+			return false;
+
+		if (const char* cached = this->m_path.load(std::memory_order_acquire))
+			return path::equals({ cached, this->m_path_size }, path, ignore_case);
+
+		// Compare component by component from the back, the sizes already match in total
+		//
+		size_t offset = path.size();
+		for (node* it = this; it && offset; it = it->m_parent)
+		{
+			offset -= it->m_name_size;
+			if (!path::equals({ it->m_name, it->m_name_size }, path.substr(offset, it->m_name_size), ignore_case))
+				return false;
+		}
+
+		return true;
 	}
 
 	/**
@@ -45,44 +124,122 @@ namespace zvfs
 		return this->m_hash;
 	}
 
-	node::node(bool is_file, bool is_root, size_t hash, std::string& path)
+	node::node(bool is_file, bool is_root, size_t hash, std::string_view name, std::pmr::memory_resource* resource)
 		: m_is_file(is_file)
 		, m_is_root(is_root)
 		, m_file(nullptr)
 		, m_hash(hash)
-		, m_path(path)
 		, m_parent(nullptr)
+		, m_name(name.data())
+		, m_name_size(static_cast<uint32_t>(name.size()))
+		, m_path_size(static_cast<uint32_t>(name.size()))
+		, m_path(nullptr)
+		, m_resource(resource)
+		, m_child_index(0)
+		, m_search_id(0)
+		, m_owns_dir(false)
 	{
 	}
 
-	node::node(bool is_file, bool is_root, size_t hash, std::string_view path)
-		: m_is_file(is_file)
-		, m_is_root(is_root)
-		, m_file(nullptr)
-		, m_hash(hash)
-		, m_path(path)
-		, m_parent(nullptr)
+	node::~node()
 	{
+		if (char* cached = this->m_path.exchange(nullptr, std::memory_order_relaxed))
+			this->m_resource->deallocate(cached, this->m_path_size, 1);
 	}
 
-	node::~node()
+	void node::write_path(char* out) const
 	{
-		if (m_is_file)
-			delete this->m_file;
-		else
-			delete this->m_dir;
+		// Fill the buffer back to front while walking up to the root
+		//
+		size_t offset = this->m_path_size;
+		for (const node* it = this; it && offset; it = it->m_parent)
+		{
+			offset -= it->m_name_size;
+			std::memcpy(out + offset, it->m_name, it->m_name_size);
+		}
+	}
 
-		this->m_file = nullptr;
+	/**
+	* Retrieves the size of the file contents in bytes
+	*
+	* @returns				The size, the default implementation returns the size of view()
+	* @exceptsafe no-throw
+	*/
+	uint64_t file::size() const
+	{
+		return this->view().size();
+	}
+
+	/**
+	* Reads file contents starting at an offset, like pread
+	* Reads at or past the end of the file read nothing, reads crossing the end are shortened
+	*
+	* @param[in] offset		Position of the first byte to read
+	* @param[out] out_buffer	Receives the contents, up to its size is read
+	*
+	* @returns				Number of bytes read or static_cast<size_t>(-1) if reading failed.
+	*						The default implementation copies from view()
+	* @exceptsafe no-throw
+	*/
+	size_t file::read_at(uint64_t offset, std::span<std::byte> out_buffer) const
+	{
+		std::span<const std::byte> contents = this->view();
+		if (offset >= contents.size())
+			return 0;
+
+		size_t count = std::min(out_buffer.size(), contents.size() - static_cast<size_t>(offset));
+		if (count)
+			std::memcpy(out_buffer.data(), contents.data() + offset, count);
+
+		return count;
+	}
+
+	/**
+	* Retrieves the whole file contents without copying, if the backend has them in memory
+	*
+	* @returns				The contents, valid as long as the file object or until drop_cache() is called.
+	*						Empty if the backend can't provide a view, read_at has to be used then
+	* @exceptsafe no-throw
+	*/
+	std::span<const std::byte> file::view() const
+	{
+		return {};
+	}
+
+	/**
+	* Frees contents the backend keeps in memory after producing them, for example decompressed data
+	* Later reads produce them again. Views retrieved before become invalid, nobody may still use them.
+	* The default implementation keeps nothing and does nothing
+	*
+	* @exceptsafe no-throw
+	*/
+	void file::drop_cache() const
+	{
+	}
+
+	/**
+	* Creates an empty directory
+	*
+	* @param[in] resource	Memory resource used for the children list
+	* @param[in] ignore_case	Treat A-Z and a-z as equal when looking up children by name
+	*
+	* @exceptsafe no-throw
+	*/
+	dir::dir(std::pmr::memory_resource* resource, bool ignore_case)
+		: m_children(resource)
+		, m_lookup(resource)
+		, m_ignore_case(ignore_case)
+	{
 	}
 
 	/**
 	* Retrieves the begin Iterator used to iterate over children nodes
 	*
-	* @returns				A std::vector<node*> iterator to the begin of the container
+	* @returns				A std::pmr::vector<node*> iterator to the begin of the container
 	*
 	* @exceptsafe no-throw
 	*/
-	std::vector<node*>::iterator dir::begin()
+	std::pmr::vector<node*>::iterator dir::begin()
 	{
 		return this->m_children.begin();
 	}
@@ -90,11 +247,11 @@ namespace zvfs
 	/**
 	* Retrieves the end Iterator used to iterate over children nodes
 	*
-	* @returns				A std::vector<node*> iterator to the end of the container
+	* @returns				A std::pmr::vector<node*> iterator to the end of the container
 	*
 	* @exceptsafe no-throw
 	*/
-	std::vector<node*>::iterator dir::end()
+	std::pmr::vector<node*>::iterator dir::end()
 	{
 		return this->m_children.end();
 	}
@@ -104,15 +261,32 @@ namespace zvfs
 	*
 	* @param[in] entry		The child node to add
 	*
-	* @exceptsafe no-throw
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the child list or the name index could not be grown
 	*/
 	void dir::add_child(node* entry)
 	{
+		// Everything that allocates happens before the directory changes, a failed add leaves it as it was
+		//
+		size_t count = this->m_children.size() + 1;
+		bool rebuild = this->m_lookup.empty() ? count >= g_lookup_threshold : count * 2 > this->m_lookup.size();
+
+		std::pmr::vector<lookup_slot> table(this->m_lookup.get_allocator());
+		if (rebuild)
+			table.assign(lookup_capacity(count), lookup_slot{ 0, 0 });
+
 		this->m_children.push_back(entry);
+		entry->m_child_index = static_cast<uint32_t>(count - 1);
+
+		if (rebuild)
+			this->lookup_build(table);
+		else if (!this->m_lookup.empty())
+			this->lookup_insert(this->hash_name(entry->name()), entry->m_child_index);
 	}
 
 	/**
 	* Remove a children node from this directory
+	* Runs in constant time, the last child takes the place of the removed one
 	*
 	* @param[in] entry		The child node to remove
 	* @returns				Returns true on success
@@ -121,19 +295,80 @@ namespace zvfs
 	*/
 	bool dir::remove_child(node* entry)
 	{
-		auto result = std::find_if(this->m_children.begin(), this->m_children.end(), [entry](node* it)
+		// The back index has to point at the entry, otherwise it isn't a child of this directory
+		//
+		uint32_t index = entry->m_child_index;
+		if (index >= this->m_children.size() || this->m_children[index] != entry)
+			return false;
+
+		if (!this->m_lookup.empty())
+			this->lookup_erase(this->hash_name(entry->name()), index);
+
+		// Swap and pop
+		//
+		node* last = this->m_children.back();
+		if (last != entry)
 		{
-			return it == entry;
-		});
+			if (!this->m_lookup.empty())
+				this->lookup_update(this->hash_name(last->name()), last->m_child_index, index);
 
-		if (result == this->m_children.end())
-			return false;
+			this->m_children[index] = last;
+			last->m_child_index = index;
+		}
 
-		this->m_children.erase(result);
+		this->m_children.pop_back();
+
+		// Drop the name index once the directory is small again
+		//
+		if (!this->m_lookup.empty() && this->m_children.size() < g_lookup_threshold / 2)
+		{
+			this->m_lookup.clear();
+			this->m_lookup.shrink_to_fit();
+		}
 
 		return true;
 	}
 
+	/**
+	* Looks up a direct child by its name
+	* Small directories are scanned, larger ones maintain a hashed name index
+	*
+	* @param[in] name		The name of the child, directories have to be requested with their trailing slash
+	*						Example: "file.png" or "folder/"
+	*
+	* @returns				The child node or a nullptr if no child has that name
+	* @exceptsafe no-throw
+	*/
+	node* dir::find_child(std::string_view name)
+	{
+		if (this->m_lookup.empty())
+		{
+			for (node* it : this->m_children)
+			{
+				if (path::equals(it->name(), name, this->m_ignore_case))
+					return it;
+			}
+
+			return nullptr;
+		}
+
+		uint32_t hash = this->hash_name(name);
+		size_t mask = this->m_lookup.size() - 1;
+
+		for (size_t position = hash & mask; this->m_lookup[position].m_index; position = (position + 1) & mask)
+		{
+			const lookup_slot& current = this->m_lookup[position];
+			if (current.m_hash != hash)
+				continue;
+
+			node* child = this->m_children[current.m_index - 1];
+			if (path::equals(child->name(), name, this->m_ignore_case))
+				return child;
+		}
+
+		return nullptr;
+	}
+
 	/**
 	* Returns the number of child nodes in this directory
 	*
@@ -145,4 +380,95 @@ namespace zvfs
 	{
 		return this->m_children.size();
 	}
-}
\ No newline at end of file
+
+	uint32_t dir::hash_name(std::string_view name)
+	{
+		return static_cast<uint32_t>(path_hasher::hash(name, this->m_ignore_case, false));
+	}
+
+	size_t dir::lookup_capacity(size_t count)
+	{
+		// Size the table for a load factor of at most 1/4, it is rebuilt once it exceeds 1/2
+		//
+		size_t capacity = g_lookup_threshold;
+		while (capacity < count * 4)
+			capacity *= 2;
+
+		return capacity;
+	}
+
+	void dir::lookup_build(std::pmr::vector<lookup_slot>& table)
+	{
+		this->m_lookup.swap(table);
+
+		for (uint32_t i = 0; i < this->m_children.size(); i++)
+			this->lookup_insert(this->hash_name(this->m_children[i]->name()), i);
+	}
+
+	void dir::lookup_insert(uint32_t hash, uint32_t index)
+	{
+		size_t mask = this->m_lookup.size() - 1;
+		size_t position = hash & mask;
+
+		while (this->m_lookup[position].m_index)
+			position = (position + 1) & mask;
+
+		this->m_lookup[position] = { hash, index + 1 };
+	}
+
+	void dir::lookup_erase(uint32_t hash, uint32_t index)
+	{
+		size_t mask = this->m_lookup.size() - 1;
+		size_t position = hash & mask;
+
+		while (this->m_lookup[position].m_index != index + 1)
+			position = (position + 1) & mask;
+
+		// Linear probing deletion without tombstones: move back every following slot
+		// whose home position does not lie between the hole and its current position
+		//
+		size_t next = position;
+		while (true)
+		{
+			next = (next + 1) & mask;
+			if (!this->m_lookup[next].m_index)
+				break;
+
+			size_t home = this->m_lookup[next].m_hash & mask;
+			bool stays = position <= next ? (position < home && home <= next) : (position < home || home <= next);
+			if (stays)
+				continue;
+
+			this->m_lookup[position] = this->m_lookup[next];
+			position = next;
+		}
+
+		this->m_lookup[position] = { 0, 0 };
+	}
+
+	void dir::lookup_update(uint32_t hash, uint32_t old_index, uint32_t new_index)
+	{
+		size_t mask = this->m_lookup.size() - 1;
+		size_t position = hash & mask;
+
+		while (this->m_lookup[position].m_index != old_index + 1)
+			position = (position + 1) & mask;
+
+		this->m_lookup[position].m_index = new_index + 1;
+	}
+
+	/**
+	* Retrieves the lock guarding the children of a directory node
+	*
+	* @param[in] entry		The directory node
+	*
+	* @exceptsafe no-throw
+	*/
+	std::shared_mutex& dir_locks::get(const node* entry)
+	{
+		// Nodes are at least 64 bytes apart, the low address bits carry no information
+		//
+		uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(entry)) >> 6;
+		return this->m_stripes[static_cast<size_t>((address * 0x9E3779B97F4A7C15ull) >> 58)].m_mutex;
+	}
+}
@@ -1,4 +1,11 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <shared_mutex>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -20,6 +27,18 @@ namespace zvfs
 		//
 		friend class vfs;
 
+		// Directories maintain the back index into their children list
+		//
+		friend class dir;
+
+		// Lazy searches assemble paths in their own buffer
+		//
+		friend class match_range;
+
+		// Snapshots copy paths without materializing them
+		//
+		friend class frozen_vfs;
+
 	public:
 		/**
 		* Retrieves a the nodes parent node
@@ -32,6 +51,7 @@ namespace zvfs
 
 		/**
 		* Sets the nodes parent node
+		* The path of this node is derived from the parent chain
 		* 
 		* @param[in] parent		The parent node pointer
 		*
@@ -41,11 +61,31 @@ namespace zvfs
 
 		/**
 		* Retrieves the nodes full path
+		* Nodes only store their own name, the full path is assembled on first use and cached
 		*
-		* @exceptsafe no-throw
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if the path could not be materialized
 		*/
 		[[nodiscard]] std::string_view path();
 
+		/**
+		* Retrieves the last component of the nodes path
+		* Directory names keep their trailing slash
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] std::string_view name();
+
+		/**
+		* Compares the nodes full path against a string without materializing it
+		*
+		* @param[in] path		The path to compare against
+		* @param[in] ignore_case	Compare A-Z and a-z as equal
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool path_equals(std::string_view path, bool ignore_case);
+
 		/**
 		* Retrieves the node hash (hash of the full path)
 		*
@@ -63,14 +103,38 @@ namespace zvfs
 		};
 
 	private:
-		node(bool is_file, bool is_root, size_t hash, std::string& path);
-		node(bool is_file, bool is_root, size_t hash, std::string_view path);
+		node(bool is_file, bool is_root, size_t hash, std::string_view name, std::pmr::memory_resource* resource);
 		~node();
 
+		void write_path(char* out) const;
+
 	private:
 		size_t m_hash;
-		std::string m_path;
 		node* m_parent;
+
+		// Name is a view into the owning vfs string pool
+		//
+		const char* m_name;
+		uint32_t m_name_size;
+		uint32_t m_path_size;
+
+		// Lazily materialized full path, allocated from m_resource
+		// Published atomically, so readers of a thread safe vfs can fill it concurrently
+		//
+		std::atomic<char*> m_path;
+		std::pmr::memory_resource* m_resource;
+
+		// Position of this node inside the children list of its parent directory
+		//
+		uint32_t m_child_index;
+
+		// Id of this node inside the trigram index of the owning vfs, if enabled
+		//
+		uint32_t m_search_id;
+
+		// Set if m_dir was allocated from the owning vfs instead of being supplied by the user
+		//
+		bool m_owns_dir;
 	};
 
 	/**
@@ -86,13 +150,52 @@ namespace zvfs
 
 	/**
 	* A node data container for files
-	* Not useful in itself, provides a specialized type that can be overloaded further
-	* See tests or example for reference
+	* Backends derive from it and implement the positional read interface, so consumers never need
+	* to know the concrete type. See tests or example for reference
 	*
+	* Reads take an explicit offset and share no cursor, implementations have to allow concurrent reads
 	*/
 	class file : public node_data
 	{
+	public:
+		/**
+		* Retrieves the size of the file contents in bytes
+		*
+		* @returns				The size, the default implementation returns the size of view()
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] virtual uint64_t size() const;
+
+		/**
+		* Reads file contents starting at an offset, like pread
+		* Reads at or past the end of the file read nothing, reads crossing the end are shortened
+		*
+		* @param[in] offset		Position of the first byte to read
+		* @param[out] out_buffer	Receives the contents, up to its size is read
+		*
+		* @returns				Number of bytes read or static_cast<size_t>(-1) if reading failed.
+		*						The default implementation copies from view()
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] virtual size_t read_at(uint64_t offset, std::span<std::byte> out_buffer) const;
+
+		/**
+		* Retrieves the whole file contents without copying, if the backend has them in memory
+		*
+		* @returns				The contents, valid as long as the file object or until drop_cache() is called.
+		*						Empty if the backend can't provide a view, read_at has to be used then
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] virtual std::span<const std::byte> view() const;
 
+		/**
+		* Frees contents the backend keeps in memory after producing them, for example decompressed data
+		* Later reads produce them again. Views retrieved before become invalid, nobody may still use them.
+		* The default implementation keeps nothing and does nothing
+		*
+		* @exceptsafe no-throw
+		*/
+		virtual void drop_cache() const;
 	};
 
 	/**
@@ -103,35 +206,47 @@ namespace zvfs
 	class dir : public node_data
 	{
 	public:
+		/**
+		* Creates an empty directory
+		*
+		* @param[in] resource	Memory resource used for the children list
+		* @param[in] ignore_case	Treat A-Z and a-z as equal when looking up children by name
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] dir(std::pmr::memory_resource* resource = std::pmr::get_default_resource(), bool ignore_case = false);
+
 		/**
 		* Retrieves the begin Iterator used to iterate over children nodes
 		*
-		* @returns				A std::vector<node*> iterator to the begin of the container
+		* @returns				A std::pmr::vector<node*> iterator to the begin of the container
 		*
 		* @exceptsafe no-throw
 		*/
-		[[nodiscard]] std::vector<node*>::iterator begin();
+		[[nodiscard]] std::pmr::vector<node*>::iterator begin();
 
 		/**
 		* Retrieves the end Iterator used to iterate over children nodes
 		*
-		* @returns				A std::vector<node*> iterator to the end of the container
+		* @returns				A std::pmr::vector<node*> iterator to the end of the container
 		*
 		* @exceptsafe no-throw
 		*/
-		[[nodiscard]] std::vector<node*>::iterator end();
+		[[nodiscard]] std::pmr::vector<node*>::iterator end();
 
 		/**
 		* Add a children node to this directory
 		*
 		* @param[in] entry		The child node to add
 		*
-		* @exceptsafe no-throw
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the child list or the name index could not be grown
 		*/
 		void add_child(node* entry);
 
 		/**
 		* Remove a children node from this directory
+		* Runs in constant time, the last child takes the place of the removed one
 		*
 		* @param[in] entry		The child node to remove
 		* @returns				Returns true on success
@@ -140,6 +255,18 @@ namespace zvfs
 		*/
 		[[nodiscard]] bool remove_child(node* entry);
 
+		/**
+		* Looks up a direct child by its name
+		* Small directories are scanned, larger ones maintain a hashed name index
+		*
+		* @param[in] name		The name of the child, directories have to be requested with their trailing slash
+		*						Example: "file.png" or "folder/"
+		*
+		* @returns				The child node or a nullptr if no child has that name
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] node* find_child(std::string_view name);
+
 		/**
 		* Returns the number of child nodes in this directory
 		*
@@ -150,6 +277,54 @@ namespace zvfs
 		[[nodiscard]] size_t size();
 
 	private:
-		std::vector<node*> m_children;
+		// Hashed name index slot. Stores the low hash bits and the child position + 1, zero marks an empty slot
+		//
+		struct lookup_slot
+		{
+			uint32_t m_hash;
+			uint32_t m_index;
+		};
+
+		[[nodiscard]] uint32_t hash_name(std::string_view name);
+		[[nodiscard]] static size_t lookup_capacity(size_t count);
+		void lookup_build(std::pmr::vector<lookup_slot>& table);
+		void lookup_insert(uint32_t hash, uint32_t index);
+		void lookup_erase(uint32_t hash, uint32_t index);
+		void lookup_update(uint32_t hash, uint32_t old_index, uint32_t new_index);
+
+	private:
+		std::pmr::vector<node*> m_children;
+		std::pmr::vector<lookup_slot> m_lookup;
+		bool m_ignore_case;
+	};
+
+	/**
+	* Fixed set of reader/writer locks guarding the children of directories
+	*
+	* A directory is mapped to one of the locks by the address of its node, so modifying one directory
+	* only blocks the few unrelated directories that share its lock. Adding a child locks the parent exclusively,
+	* reading the children of a directory locks it shared
+	*/
+	class dir_locks
+	{
+	public:
+		/**
+		* Retrieves the lock guarding the children of a directory node
+		*
+		* @param[in] entry		The directory node
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] std::shared_mutex& get(const node* entry);
+
+	private:
+		// Every lock gets its own cache line, threads working on neighbouring locks don't share lines
+		//
+		struct alignas(64) stripe
+		{
+			std::shared_mutex m_mutex;
+		};
+
+		std::array<stripe, 64> m_stripes;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,346 @@
+#include "node_index.hpp"
+#include <new>
+#include <utility>
+
+namespace zvfs
+{
+	namespace
+	{
+		// Keep the table at most 80% full, probe sequences grow quickly beyond that
+		//
+		constexpr size_t g_max_load_numerator = 4;
+		constexpr size_t g_max_load_denominator = 5;
+		constexpr size_t g_min_capacity = 16;
+		constexpr size_t g_cache_line = 64;
+	}
+
+	node* node_index::iterator::operator*() const
+	{
+		return this->m_index->m_slots[this->m_position].m_node;
+	}
+
+	node_index::iterator& node_index::iterator::operator++()
+	{
+		this->m_position++;
+		this->skip_empty();
+		return *this;
+	}
+
+	bool node_index::iterator::operator==(const iterator& other) const
+	{
+		return this->m_position == other.m_position;
+	}
+
+	bool node_index::iterator::operator!=(const iterator& other) const
+	{
+		return this->m_position != other.m_position;
+	}
+
+	node_index::iterator::iterator(const node_index* index, size_t position)
+		: m_index(index)
+		, m_position(position)
+	{
+		this->skip_empty();
+	}
+
+	void node_index::iterator::skip_empty()
+	{
+		while (this->m_position < this->m_index->m_capacity && !this->m_index->m_slots[this->m_position].m_node)
+			this->m_position++;
+	}
+
+	/**
+	* Creates an empty index, no memory is allocated until the first insertion
+	*
+	* @param[in] resource	Memory resource used for the slot storage
+	*
+	* @exceptsafe no-throw
+	*/
+	node_index::node_index(std::pmr::memory_resource* resource)
+		: m_resource(resource)
+		, m_table(nullptr)
+		, m_sequence(0)
+		, m_epochs(nullptr)
+		, m_slots(nullptr)
+		, m_capacity(0)
+		, m_mask(0)
+		, m_shift(64)
+		, m_size(0)
+	{
+	}
+
+	/**
+	* Frees the slot storage. Does not touch the stored nodes
+	*
+	* @exceptsafe no-throw
+	*/
+	node_index::~node_index()
+	{
+		this->clear();
+	}
+
+	/**
+	* Inserts a node keyed by node::hash()
+	* The caller is responsible for not inserting the same key twice
+	*
+	* @param[in] entry		The node to insert
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the table could not grow
+	*/
+	void node_index::insert(node* entry)
+	{
+		this->reserve(this->m_size + 1);
+
+		this->begin_write();
+		this->place({ entry->hash(), entry });
+		this->end_write();
+
+		this->m_size++;
+	}
+
+	/**
+	* Removes a node from the index
+	*
+	* @param[in] entry		The node to remove. Compared by identity, not by key
+	* @returns				Returns true if the node was found and removed
+	*
+	* @exceptsafe no-throw
+	*/
+	bool node_index::erase(node* entry)
+	{
+		if (!this->m_size)
+			return false;
+
+		size_t hash = entry->hash();
+		size_t position = this->home(hash);
+		for (size_t distance = 0;; distance++)
+		{
+			const slot& current = this->m_slots[position];
+			if (!current.m_node || this->distance(current.m_hash, position) < distance)
+				return false;
+
+			if (current.m_node == entry)
+				break;
+
+			position = (position + 1) & this->m_mask;
+		}
+
+		// Backward shift deletion, pull every following displaced slot one step closer to its home
+		// This keeps the table free of tombstones
+		//
+		this->begin_write();
+
+		size_t next = (position + 1) & this->m_mask;
+		while (this->m_slots[next].m_node && this->distance(this->m_slots[next].m_hash, next) > 0)
+		{
+			store_slot(this->m_slots[position], this->m_slots[next]);
+			position = next;
+			next = (next + 1) & this->m_mask;
+		}
+
+		store_slot(this->m_slots[position], { 0, nullptr });
+		this->end_write();
+
+		this->m_size--;
+
+		return true;
+	}
+
+	/**
+	* Grows the table so that it can hold count nodes without rehashing
+	*
+	* @param[in] count		Number of nodes the index should be able to hold
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the table could not grow
+	*/
+	void node_index::reserve(size_t count)
+	{
+		if (count * g_max_load_denominator <= this->m_capacity * g_max_load_numerator)
+			return;
+
+		size_t capacity = this->m_capacity ? this->m_capacity : g_min_capacity;
+		while (count * g_max_load_denominator > capacity * g_max_load_numerator)
+			capacity *= 2;
+
+		this->rehash(capacity);
+	}
+
+	/**
+	* Removes all nodes and frees the slot storage
+	*
+	* @exceptsafe no-throw
+	*/
+	void node_index::clear()
+	{
+		if (table_header* table = this->m_table.exchange(nullptr, std::memory_order_acq_rel))
+			free_table(this->m_resource, table);
+
+		this->m_slots = nullptr;
+		this->m_capacity = 0;
+		this->m_mask = 0;
+		this->m_shift = 64;
+		this->m_size = 0;
+	}
+
+	/**
+	* Retrieves the number of nodes stored in the index
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t node_index::size() const
+	{
+		return this->m_size;
+	}
+
+	/**
+	* Retrieves the begin iterator used to iterate over all stored nodes
+	*
+	* @exceptsafe no-throw
+	*/
+	node_index::iterator node_index::begin() const
+	{
+		return iterator(this, 0);
+	}
+
+	/**
+	* Retrieves the end iterator used to iterate over all stored nodes
+	*
+	* @exceptsafe no-throw
+	*/
+	node_index::iterator node_index::end() const
+	{
+		return iterator(this, this->m_capacity);
+	}
+
+	/**
+	* Retrieves the number of slots in the table
+	* Slot positions in [0, capacity()) can be used to split iteration into independent ranges
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t node_index::capacity() const
+	{
+		return this->m_capacity;
+	}
+
+	/**
+	* Retrieves an iterator to the first node stored at or after a slot position
+	* Iterating from at(first) to at(last) visits exactly the nodes stored in the slots [first, last)
+	*
+	* @param[in] position	Slot position, clamped to capacity()
+	*
+	* @exceptsafe no-throw
+	*/
+	node_index::iterator node_index::at(size_t position) const
+	{
+		return iterator(this, position < this->m_capacity ? position : this->m_capacity);
+	}
+
+	/**
+	* Attaches an epoch domain, replaced slot arrays are retired through it instead of being freed right away
+	*
+	* @param[in] domain		The domain concurrent readers pin, nullptr frees replaced arrays immediately
+	*
+	* @exceptsafe no-throw
+	*/
+	void node_index::set_epoch_domain(epoch_domain* domain)
+	{
+		this->m_epochs = domain;
+	}
+
+	void node_index::free_table(void* context, void* pointer)
+	{
+		table_header* table = static_cast<table_header*>(pointer);
+		size_t bytes = sizeof(table_header) + table->m_capacity * sizeof(slot);
+
+		static_cast<std::pmr::memory_resource*>(context)->deallocate(table, bytes, g_cache_line);
+	}
+
+	void node_index::begin_write()
+	{
+		// Odd sequence numbers mark a modification in progress, readers retry until they see the same even number twice
+		//
+		this->m_sequence.store(this->m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void node_index::end_write()
+	{
+		this->m_sequence.store(this->m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	void node_index::rehash(size_t capacity)
+	{
+		// Cache line aligned storage so a probe sequence never straddles more lines than necessary
+		// The header occupies exactly one line in front of the slots
+		//
+		void* storage = this->m_resource->allocate(sizeof(table_header) + capacity * sizeof(slot), g_cache_line);
+
+		size_t bits = 0;
+		while ((size_t(1) << bits) < capacity)
+			bits++;
+
+		table_header* table = new (storage) table_header{ capacity, capacity - 1, 64 - bits };
+		slot* slots = const_cast<slot*>(slots_of(table));
+		for (size_t i = 0; i < capacity; i++)
+			slots[i] = { 0, nullptr };
+
+		table_header* old_table = this->m_table.load(std::memory_order_relaxed);
+		slot* old_slots = this->m_slots;
+		size_t old_capacity = this->m_capacity;
+
+		this->m_slots = slots;
+		this->m_capacity = capacity;
+		this->m_mask = capacity - 1;
+		this->m_shift = 64 - bits;
+
+		for (size_t i = 0; i < old_capacity; i++)
+		{
+			if (old_slots[i].m_node)
+				this->place(old_slots[i]);
+		}
+
+		// Readers still probing the old array get consistent results from it, it only goes away once they are done
+		//
+		this->m_table.store(table, std::memory_order_release);
+
+		if (!old_table)
+			return;
+
+		if (this->m_epochs)
+			this->m_epochs->retire(old_table, &node_index::free_table, this->m_resource);
+		else
+			free_table(this->m_resource, old_table);
+	}
+
+	void node_index::place(slot entry)
+	{
+		size_t position = this->home(entry.m_hash);
+		size_t distance = 0;
+		while (true)
+		{
+			slot& current = this->m_slots[position];
+			if (!current.m_node)
+			{
+				store_slot(current, entry);
+				return;
+			}
+
+			// Robin hood: steal the slot from entries that are closer to their home than we are
+			//
+			size_t current_distance = this->distance(current.m_hash, position);
+			if (current_distance < distance)
+			{
+				slot displaced = current;
+				store_slot(current, entry);
+				entry = displaced;
+				distance = current_distance;
+			}
+
+			position = (position + 1) & this->m_mask;
+			distance++;
+		}
+	}
+}
@@ -0,0 +1,329 @@
+#pragma once
+#include "node.hpp"
+#include "epoch.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <thread>
+
+namespace zvfs
+{
+	/**
+	* Flat open addressing hash table mapping path hashes to nodes
+	*
+	* Uses robin hood linear probing over 16 byte slots (hash + node pointer),
+	* so a typical lookup stays within one or two cache lines.
+	* The table never trusts the hash alone, every hash match is verified against the key
+	*
+	* Modifications are published through a sequence counter, so find_concurrent can run next to a single writer
+	* without taking a lock. Replaced slot arrays are retired through an epoch domain if one is attached
+	*/
+	class node_index
+	{
+	public:
+		/**
+		* Forward iterator over all nodes stored in the index
+		*
+		*/
+		class iterator
+		{
+			friend class node_index;
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = node*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = node**;
+			using reference = node*;
+
+			[[nodiscard]] node* operator*() const;
+			iterator& operator++();
+			[[nodiscard]] bool operator==(const iterator& other) const;
+			[[nodiscard]] bool operator!=(const iterator& other) const;
+
+		private:
+			iterator(const node_index* index, size_t position);
+			void skip_empty();
+
+			const node_index* m_index;
+			size_t m_position;
+		};
+
+		/**
+		* Creates an empty index, no memory is allocated until the first insertion
+		*
+		* @param[in] resource	Memory resource used for the slot storage
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] node_index(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		/**
+		* Frees the slot storage. Does not touch the stored nodes
+		*
+		* @exceptsafe no-throw
+		*/
+		~node_index();
+
+		node_index(const node_index&) = delete;
+		node_index& operator=(const node_index&) = delete;
+
+		/**
+		* Looks up a node by its hash
+		*
+		* @param[in] hash		Hash of the requested key
+		* @param[in] equal		Callable invoked as equal(node*) for every hash match,
+		*						it has to return true if the node actually represents the requested key
+		*
+		* @returns				The matching node or a nullptr if the key is not present
+		* @exceptsafe no-throw
+		*/
+		template<typename Equal>
+		[[nodiscard]] node* find(size_t hash, Equal&& equal) const
+		{
+			if (!this->m_size)
+				return nullptr;
+
+			size_t position = this->home(hash);
+			for (size_t distance = 0;; distance++)
+			{
+				const slot& current = this->m_slots[position];
+
+				// An empty slot or a slot that is closer to its home than we are to ours
+				// terminates the probe sequence. Robin hood ordering guarantees the key can't be further back
+				//
+				if (!current.m_node || this->distance(current.m_hash, position) < distance)
+					return nullptr;
+
+				if (current.m_hash == hash && equal(current.m_node))
+					return current.m_node;
+
+				position = (position + 1) & this->m_mask;
+			}
+		}
+
+		/**
+		* Looks up a node by its hash while another thread may modify the index
+		* The lookup is retried until it completes without an overlapping modification.
+		* The caller has to be pinned in the attached epoch domain, nodes passed to equal
+		* may already be removed but are never freed while the caller is pinned
+		*
+		* @param[in] hash		Hash of the requested key
+		* @param[in] equal		Callable invoked as equal(node*) for every hash match,
+		*						it has to return true if the node actually represents the requested key
+		*
+		* @returns				The matching node or a nullptr if the key is not present
+		* @exceptsafe no-throw
+		*/
+		template<typename Equal>
+		[[nodiscard]] node* find_concurrent(size_t hash, Equal&& equal) const
+		{
+			for (;;)
+			{
+				uint64_t sequence = this->m_sequence.load(std::memory_order_acquire);
+				if (sequence & 1)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				node* result = nullptr;
+				const table_header* table = this->m_table.load(std::memory_order_acquire);
+
+				if (table)
+				{
+					const slot* slots = slots_of(table);
+					size_t position = home(hash, table->m_shift, table->m_mask);
+
+					// A torn view of the table may lack the terminating slot, the capacity bounds the probe
+					//
+					for (size_t distance = 0; distance <= table->m_mask; distance++)
+					{
+						slot current = load_slot(slots[position]);
+						if (!current.m_node || distance_of(current.m_hash, position, table->m_shift, table->m_mask) < distance)
+							break;
+
+						if (current.m_hash == hash && equal(current.m_node))
+						{
+							result = current.m_node;
+							break;
+						}
+
+						position = (position + 1) & table->m_mask;
+					}
+				}
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (this->m_sequence.load(std::memory_order_relaxed) == sequence)
+					return result;
+			}
+		}
+
+		/**
+		* Inserts a node keyed by node::hash()
+		* The caller is responsible for not inserting the same key twice
+		*
+		* @param[in] entry		The node to insert
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the table could not grow
+		*/
+		void insert(node* entry);
+
+		/**
+		* Removes a node from the index
+		*
+		* @param[in] entry		The node to remove. Compared by identity, not by key
+		* @returns				Returns true if the node was found and removed
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool erase(node* entry);
+
+		/**
+		* Grows the table so that it can hold count nodes without rehashing
+		*
+		* @param[in] count		Number of nodes the index should be able to hold
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the table could not grow
+		*/
+		void reserve(size_t count);
+
+		/**
+		* Removes all nodes and frees the slot storage
+		*
+		* @exceptsafe no-throw
+		*/
+		void clear();
+
+		/**
+		* Retrieves the number of nodes stored in the index
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t size() const;
+
+		/**
+		* Retrieves the begin iterator used to iterate over all stored nodes
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] iterator begin() const;
+
+		/**
+		* Retrieves the end iterator used to iterate over all stored nodes
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] iterator end() const;
+
+		/**
+		* Retrieves the number of slots in the table
+		* Slot positions in [0, capacity()) can be used to split iteration into independent ranges
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t capacity() const;
+
+		/**
+		* Retrieves an iterator to the first node stored at or after a slot position
+		* Iterating from at(first) to at(last) visits exactly the nodes stored in the slots [first, last)
+		*
+		* @param[in] position	Slot position, clamped to capacity()
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] iterator at(size_t position) const;
+
+		/**
+		* Attaches an epoch domain, replaced slot arrays are retired through it instead of being freed right away
+		*
+		* @param[in] domain		The domain concurrent readers pin, nullptr frees replaced arrays immediately
+		*
+		* @exceptsafe no-throw
+		*/
+		void set_epoch_domain(epoch_domain* domain);
+
+	private:
+		struct slot
+		{
+			size_t m_hash;
+			node* m_node;
+		};
+
+		// Geometry of one slot array, stored in the first cache line of its allocation
+		// so readers get a consistent view from a single pointer
+		//
+		struct alignas(64) table_header
+		{
+			size_t m_capacity;
+			size_t m_mask;
+			size_t m_shift;
+		};
+
+		[[nodiscard]] static size_t home(size_t hash, size_t shift, size_t mask)
+		{
+			// Fibonacci hashing spreads weak low bits over the whole table
+			//
+			return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> shift) & mask;
+		}
+
+		[[nodiscard]] static size_t distance_of(size_t hash, size_t position, size_t shift, size_t mask)
+		{
+			return (position - home(hash, shift, mask)) & mask;
+		}
+
+		[[nodiscard]] size_t home(size_t hash) const
+		{
+			return home(hash, this->m_shift, this->m_mask);
+		}
+
+		[[nodiscard]] size_t distance(size_t hash, size_t position) const
+		{
+			return distance_of(hash, position, this->m_shift, this->m_mask);
+		}
+
+		[[nodiscard]] static const slot* slots_of(const table_header* table)
+		{
+			return reinterpret_cast<const slot*>(table + 1);
+		}
+
+		// Slots are only written through atomic stores, so concurrent readers never race with the writer
+		// The node pointer is published with release semantics, a reader that loads it sees the complete node
+		//
+		[[nodiscard]] static slot load_slot(const slot& source)
+		{
+			return {
+				std::atomic_ref<size_t>(const_cast<size_t&>(source.m_hash)).load(std::memory_order_relaxed),
+				std::atomic_ref<node*>(const_cast<node*&>(source.m_node)).load(std::memory_order_acquire)
+			};
+		}
+
+		static void store_slot(slot& target, slot value)
+		{
+			std::atomic_ref<size_t>(target.m_hash).store(value.m_hash, std::memory_order_relaxed);
+			std::atomic_ref<node*>(target.m_node).store(value.m_node, std::memory_order_release);
+		}
+
+		static void free_table(void* context, void* pointer);
+
+		void begin_write();
+		void end_write();
+		void rehash(size_t capacity);
+		void place(slot entry);
+
+	private:
+		std::pmr::memory_resource* m_resource;
+		std::atomic<table_header*> m_table;
+		std::atomic<uint64_t> m_sequence;
+		epoch_domain* m_epochs;
+		slot* m_slots;
+		size_t m_capacity;
+		size_t m_mask;
+		size_t m_shift;
+		size_t m_size;
+	};
+}
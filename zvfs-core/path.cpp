@@ -20,5 +20,77 @@ namespace zvfs
 
 			return { path_view.substr(0, split_index), path_view.substr(split_index) };
 		}
+
+		bool equals(std::string_view lhs, std::string_view rhs, bool ignore_case)
+		{
+			if (lhs.size() != rhs.size())
+				return false;
+
+			if (!ignore_case)
+				return lhs == rhs;
+
+			// Only the ASCII range is folded, this matches the rules used for hashing
+			//
+			for (size_t i = 0; i < lhs.size(); i++)
+			{
+				unsigned char l = static_cast<unsigned char>(lhs[i]);
+				unsigned char r = static_cast<unsigned char>(rhs[i]);
+
+				if (l >= 'A' && l <= 'Z')
+					l += 'a' - 'A';
+
+				if (r >= 'A' && r <= 'Z')
+					r += 'a' - 'A';
+
+				if (l != r)
+					return false;
+			}
+
+			return true;
+		}
+
+		bool contains(std::string_view haystack, std::string_view needle, bool ignore_case)
+		{
+			if (!ignore_case)
+				return haystack.find(needle) != std::string_view::npos;
+
+			if (needle.size() > haystack.size())
+				return false;
+
+			for (size_t i = 0; i + needle.size() <= haystack.size(); i++)
+			{
+				if (equals(haystack.substr(i, needle.size()), needle, true))
+					return true;
+			}
+
+			return false;
+		}
+
+		int compare(std::string_view lhs, std::string_view rhs, bool ignore_case)
+		{
+			if (!ignore_case)
+				return lhs.compare(rhs);
+
+			size_t length = std::min(lhs.size(), rhs.size());
+			for (size_t i = 0; i < length; i++)
+			{
+				unsigned char l = static_cast<unsigned char>(lhs[i]);
+				unsigned char r = static_cast<unsigned char>(rhs[i]);
+
+				if (l >= 'A' && l <= 'Z')
+					l += 'a' - 'A';
+
+				if (r >= 'A' && r <= 'Z')
+					r += 'a' - 'A';
+
+				if (l != r)
+					return l < r ? -1 : 1;
+			}
+
+			if (lhs.size() == rhs.size())
+				return 0;
+
+			return lhs.size() < rhs.size() ? -1 : 1;
+		}
 	} // namespace path
 } // namespace zvfs
\ No newline at end of file
@@ -9,5 +9,11 @@ namespace zvfs
 		extern std::pair<std::string_view, std::string_view> split_path(std::string_view path);
 
 		extern std::pair<std::string_view, std::string_view> split_path(std::string& path);
+
+		extern bool equals(std::string_view lhs, std::string_view rhs, bool ignore_case);
+
+		extern bool contains(std::string_view haystack, std::string_view needle, bool ignore_case);
+
+		extern int compare(std::string_view lhs, std::string_view rhs, bool ignore_case);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "perfect_hash.hpp"
+#include <algorithm>
+
+namespace zvfs
+{
+	namespace
+	{
+		// Buckets that can't be placed within this many displacements make the build fail
+		//
+		constexpr uint32_t g_max_displacement = 1u << 20;
+	}
+
+	/**
+	* Computes the displacements for a set of keys
+	*
+	* @param[in] keys				Distinct keys, at most 2^31 - 1 of them
+	* @param[out] out_displacements	Receives one displacement per bucket, bucket_count(keys.size()) in total
+	* @param[out] out_slots			Receives the slot of every key in key order
+	*
+	* @returns						Returns false if the keys contain duplicates or no displacement was found,
+	*								a different set of keys (for example hashed with another seed) has to be used then
+	* @exceptsafe basic
+	* @throws std::bad_alloc		Thrown if the temporary buckets could not be allocated
+	*/
+	bool perfect_hash::build(std::span<const uint64_t> keys, std::vector<uint32_t>& out_displacements, std::vector<uint32_t>& out_slots)
+	{
+		size_t key_count = keys.size();
+		if (key_count >= g_direct_slot)
+			return false;
+
+		size_t buckets = bucket_count(key_count);
+		out_displacements.assign(buckets, 0);
+		out_slots.assign(key_count, 0);
+
+		// Group the key indices by bucket with a counting sort
+		//
+		std::vector<uint32_t> bucket_begin(buckets + 1, 0);
+		for (uint64_t key : keys)
+			bucket_begin[bucket(key, buckets) + 1]++;
+
+		for (size_t i = 0; i < buckets; i++)
+			bucket_begin[i + 1] += bucket_begin[i];
+
+		std::vector<uint32_t> members(key_count);
+		std::vector<uint32_t> fill(bucket_begin.begin(), bucket_begin.end() - 1);
+		for (uint32_t i = 0; i < key_count; i++)
+			members[fill[bucket(keys[i], buckets)]++] = i;
+
+		// Large buckets are the hardest to place, they go first while most slots are still free
+		//
+		std::vector<uint32_t> order(buckets);
+		for (uint32_t i = 0; i < buckets; i++)
+			order[i] = i;
+
+		std::stable_sort(order.begin(), order.end(), [&bucket_begin](uint32_t lhs, uint32_t rhs)
+		{
+			return bucket_begin[lhs + 1] - bucket_begin[lhs] > bucket_begin[rhs + 1] - bucket_begin[rhs];
+		});
+
+		std::vector<bool> taken(key_count, false);
+		std::vector<uint32_t> candidate_slots;
+		size_t next_free = 0;
+
+		for (uint32_t current : order)
+		{
+			uint32_t first = bucket_begin[current];
+			uint32_t size = bucket_begin[current + 1] - first;
+			if (!size)
+				break;
+
+			// Singletons take the next free slot directly
+			//
+			if (size == 1)
+			{
+				while (taken[next_free])
+					next_free++;
+
+				taken[next_free] = true;
+				out_slots[members[first]] = static_cast<uint32_t>(next_free);
+				out_displacements[current] = g_direct_slot | static_cast<uint32_t>(next_free);
+				continue;
+			}
+
+			// Duplicate keys collide under every displacement, there is no point in searching
+			//
+			for (uint32_t i = first; i < first + size; i++)
+			{
+				for (uint32_t j = i + 1; j < first + size; j++)
+				{
+					if (keys[members[i]] == keys[members[j]])
+						return false;
+				}
+			}
+
+			bool placed = false;
+			for (uint32_t displacement = 0; displacement < g_max_displacement && !placed; displacement++)
+			{
+				candidate_slots.clear();
+				placed = true;
+
+				for (uint32_t i = first; i < first + size; i++)
+				{
+					size_t position = slot(keys[members[i]], displacement, key_count);
+					if (taken[position] || std::find(candidate_slots.begin(), candidate_slots.end(), position) != candidate_slots.end())
+					{
+						placed = false;
+						break;
+					}
+
+					candidate_slots.push_back(static_cast<uint32_t>(position));
+				}
+
+				if (!placed)
+					continue;
+
+				for (uint32_t i = 0; i < size; i++)
+				{
+					taken[candidate_slots[i]] = true;
+					out_slots[members[first + i]] = candidate_slots[i];
+				}
+
+				out_displacements[current] = displacement;
+			}
+
+			if (!placed)
+				return false;
+		}
+
+		return true;
+	}
+}
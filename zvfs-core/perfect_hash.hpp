@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Minimal perfect hash over a fixed set of 64 bit keys, built with hash and displace (CHD)
+	*
+	* Keys are grouped into buckets of about four. Every bucket stores one 32 bit displacement that moves
+	* all of its keys to distinct slots of [0, key_count). Buckets with a single key store the slot itself
+	* instead, marked by the top bit. A lookup costs one bucket read and one mix of the key
+	*/
+	class perfect_hash
+	{
+	public:
+		/**
+		* Computes the displacements for a set of keys
+		*
+		* @param[in] keys				Distinct keys, at most 2^31 - 1 of them
+		* @param[out] out_displacements	Receives one displacement per bucket, bucket_count(keys.size()) in total
+		* @param[out] out_slots			Receives the slot of every key in key order
+		*
+		* @returns						Returns false if the keys contain duplicates or no displacement was found,
+		*								a different set of keys (for example hashed with another seed) has to be used then
+		* @exceptsafe basic
+		* @throws std::bad_alloc		Thrown if the temporary buckets could not be allocated
+		*/
+		[[nodiscard]] static bool build(std::span<const uint64_t> keys, std::vector<uint32_t>& out_displacements, std::vector<uint32_t>& out_slots);
+
+		/**
+		* Retrieves the number of buckets used for a number of keys
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] static size_t bucket_count(size_t key_count)
+		{
+			return key_count / 4 + 1;
+		}
+
+		/**
+		* Retrieves the bucket of a key
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] static size_t bucket(uint64_t key, size_t bucket_count)
+		{
+			return static_cast<size_t>(((key >> 32) * static_cast<uint64_t>(bucket_count)) >> 32);
+		}
+
+		/**
+		* Retrieves the slot of a key given the displacement of its bucket
+		* Keys that are not part of the set still map to some slot, the caller has to verify the key stored there
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] static size_t slot(uint64_t key, uint32_t displacement, size_t key_count)
+		{
+			if (displacement & g_direct_slot)
+				return displacement & ~g_direct_slot;
+
+			// Finalizer of splitmix64, every displacement yields an independent looking permutation
+			//
+			uint64_t mixed = key ^ (static_cast<uint64_t>(displacement) * 0x9E3779B97F4A7C15ull);
+			mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+			mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBull;
+			mixed ^= mixed >> 31;
+
+			return static_cast<size_t>(((mixed & 0xFFFFFFFFull) * static_cast<uint64_t>(key_count)) >> 32);
+		}
+
+	private:
+		static constexpr uint32_t g_direct_slot = 0x80000000u;
+	};
+}
@@ -0,0 +1,324 @@
+#include "radix_tree.hpp"
+#include <algorithm>
+
+namespace zvfs
+{
+	/**
+	* Creates an empty tree
+	*
+	* @param[in] ignore_case	Store and compare keys with A-Z folded to a-z
+	* @param[in] resource		Memory resource used for all tree nodes
+	*
+	* @exceptsafe no-throw
+	*/
+	radix_tree::radix_tree(bool ignore_case, std::pmr::memory_resource* resource)
+		: m_resource(resource)
+		, m_root(nullptr)
+		, m_ignore_case(ignore_case)
+	{
+	}
+
+	/**
+	* Frees all tree nodes. Does not touch the referenced vfs nodes
+	*
+	* @exceptsafe no-throw
+	*/
+	radix_tree::~radix_tree()
+	{
+		this->clear();
+	}
+
+	/**
+	* Associates a key with a node, replacing any previous association
+	*
+	* @param[in] key		The full node path
+	* @param[in] value		The node stored under key
+	*
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if a tree node could not be allocated
+	*/
+	void radix_tree::insert(std::string_view key, node* value)
+	{
+		if (!this->m_root)
+			this->m_root = this->create({}, nullptr);
+
+		tree_node* current = this->m_root;
+		size_t offset = 0;
+
+		while (offset < key.size())
+		{
+			std::string_view remaining = key.substr(offset);
+			size_t position = this->child_position(current, this->fold(remaining[0]));
+
+			// No edge starts with this character, the rest of the key becomes a new leaf
+			//
+			if (position == current->m_children.size() || current->m_children[position]->m_label[0] != this->fold(remaining[0]))
+			{
+				tree_node* leaf = this->create(remaining, value);
+				current->m_children.insert(current->m_children.begin() + position, leaf);
+				return;
+			}
+
+			tree_node* child = current->m_children[position];
+			size_t common = this->common_length(child->m_label, remaining);
+
+			if (common == child->m_label.size())
+			{
+				current = child;
+				offset += common;
+				continue;
+			}
+
+			// The key diverges inside the edge label, split the edge at the divergence point
+			//
+			tree_node* split = this->create(std::string_view(child->m_label).substr(0, common), nullptr);
+			child->m_label.erase(0, common);
+			split->m_children.push_back(child);
+			current->m_children[position] = split;
+
+			offset += common;
+			if (offset == key.size())
+			{
+				split->m_value = value;
+				return;
+			}
+
+			tree_node* leaf = this->create(key.substr(offset), value);
+			size_t leaf_position = this->child_position(split, leaf->m_label[0]);
+			split->m_children.insert(split->m_children.begin() + leaf_position, leaf);
+			return;
+		}
+
+		current->m_value = value;
+	}
+
+	/**
+	* Removes a key and merges the tree nodes that became redundant
+	*
+	* @param[in] key		The full node path
+	* @returns				Returns true if the key was present
+	*
+	* @exceptsafe no-throw
+	*/
+	bool radix_tree::erase(std::string_view key)
+	{
+		if (!this->m_root)
+			return false;
+
+		tree_node* parent = nullptr;
+		tree_node* current = this->m_root;
+		size_t offset = 0;
+
+		while (offset < key.size())
+		{
+			std::string_view remaining = key.substr(offset);
+			size_t position = this->child_position(current, this->fold(remaining[0]));
+			if (position == current->m_children.size())
+				return false;
+
+			tree_node* child = current->m_children[position];
+			if (child->m_label[0] != this->fold(remaining[0]) || this->common_length(child->m_label, remaining) != child->m_label.size())
+				return false;
+
+			parent = current;
+			current = child;
+			offset += child->m_label.size();
+		}
+
+		if (!current->m_value)
+			return false;
+
+		current->m_value = nullptr;
+
+		if (current == this->m_root)
+			return true;
+
+		if (current->m_children.empty())
+		{
+			size_t position = this->child_position(parent, current->m_label[0]);
+			parent->m_children.erase(parent->m_children.begin() + position);
+			this->destroy(current);
+
+			// The parent may have turned into a plain pass-through edge
+			//
+			if (parent != this->m_root && !parent->m_value && parent->m_children.size() == 1)
+				this->merge_with_child(parent);
+		}
+		else if (current->m_children.size() == 1)
+		{
+			this->merge_with_child(current);
+		}
+
+		return true;
+	}
+
+	/**
+	* Appends all nodes whose key starts with prefix in lexicographic key order
+	*
+	* @param[in] prefix		The requested key prefix, an empty prefix lists every node
+	* @param[out] out_nodes	Receives the matching nodes, existing content is kept
+	*
+	* @returns				Number of appended nodes
+	* @exceptsafe basic
+	*/
+	size_t radix_tree::find_prefix(std::string_view prefix, std::vector<node*>& out_nodes) const
+	{
+		if (!this->m_root)
+			return 0;
+
+		const tree_node* current = this->m_root;
+		size_t offset = 0;
+
+		while (offset < prefix.size())
+		{
+			std::string_view remaining = prefix.substr(offset);
+			size_t position = this->child_position(current, this->fold(remaining[0]));
+			if (position == current->m_children.size())
+				return 0;
+
+			const tree_node* child = current->m_children[position];
+			size_t common = this->common_length(child->m_label, remaining);
+
+			// The prefix may end in the middle of an edge, everything below it still matches
+			//
+			if (common == remaining.size())
+			{
+				current = child;
+				break;
+			}
+
+			if (common < child->m_label.size())
+				return 0;
+
+			current = child;
+			offset += common;
+		}
+
+		// Pre-order walk over sorted children visits the keys in lexicographic order
+		//
+		size_t count_before = out_nodes.size();
+		std::vector<const tree_node*> pending = { current };
+		while (!pending.empty())
+		{
+			const tree_node* entry = pending.back();
+			pending.pop_back();
+
+			if (entry->m_value)
+				out_nodes.push_back(entry->m_value);
+
+			for (auto it = entry->m_children.rbegin(); it != entry->m_children.rend(); ++it)
+				pending.push_back(*it);
+		}
+
+		return out_nodes.size() - count_before;
+	}
+
+	/**
+	* Removes all keys
+	*
+	* @exceptsafe no-throw
+	*/
+	void radix_tree::clear()
+	{
+		if (this->m_root)
+			this->destroy_recursive(this->m_root);
+
+		this->m_root = nullptr;
+	}
+
+	/**
+	* Forgets all tree nodes without freeing them
+	* Only valid if the memory resource is released in bulk right after
+	*
+	* @exceptsafe no-throw
+	*/
+	void radix_tree::abandon()
+	{
+		this->m_root = nullptr;
+	}
+
+	char radix_tree::fold(char c) const
+	{
+		if (this->m_ignore_case && c >= 'A' && c <= 'Z')
+			return static_cast<char>(c + ('a' - 'A'));
+
+		return c;
+	}
+
+	radix_tree::tree_node* radix_tree::create(std::string_view label, node* value)
+	{
+		std::pmr::polymorphic_allocator<tree_node> allocator(this->m_resource);
+
+		tree_node* entry = allocator.allocate(1);
+		try
+		{
+			new (entry) tree_node{ std::pmr::string(label, this->m_resource), value, std::pmr::vector<tree_node*>(this->m_resource) };
+		}
+		catch (...)
+		{
+			allocator.deallocate(entry, 1);
+			throw;
+		}
+
+		for (char& c : entry->m_label)
+			c = this->fold(c);
+
+		return entry;
+	}
+
+	void radix_tree::destroy(tree_node* entry)
+	{
+		std::pmr::polymorphic_allocator<tree_node> allocator(this->m_resource);
+
+		entry->~tree_node();
+		allocator.deallocate(entry, 1);
+	}
+
+	void radix_tree::destroy_recursive(tree_node* entry)
+	{
+		std::vector<tree_node*> pending = { entry };
+		while (!pending.empty())
+		{
+			tree_node* current = pending.back();
+			pending.pop_back();
+
+			pending.insert(pending.end(), current->m_children.begin(), current->m_children.end());
+			this->destroy(current);
+		}
+	}
+
+	size_t radix_tree::child_position(const tree_node* parent, char first) const
+	{
+		// Children are ordered by the unsigned value of their first label character
+		//
+		auto position = std::lower_bound(parent->m_children.begin(), parent->m_children.end(), first, [](const tree_node* child, char value)
+		{
+			return static_cast<unsigned char>(child->m_label[0]) < static_cast<unsigned char>(value);
+		});
+
+		return static_cast<size_t>(position - parent->m_children.begin());
+	}
+
+	size_t radix_tree::common_length(std::string_view label, std::string_view key) const
+	{
+		size_t length = std::min(label.size(), key.size());
+		for (size_t i = 0; i < length; i++)
+		{
+			if (label[i] != this->fold(key[i]))
+				return i;
+		}
+
+		return length;
+	}
+
+	void radix_tree::merge_with_child(tree_node* entry)
+	{
+		tree_node* child = entry->m_children[0];
+
+		entry->m_label += child->m_label;
+		entry->m_value = child->m_value;
+		entry->m_children = std::move(child->m_children);
+
+		this->destroy(child);
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "node.hpp"
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Compressed radix tree over node paths
+	*
+	* Secondary index next to the hash index. Edges carry whole path fragments and the children of every
+	* tree node are kept sorted, so a pre-order walk yields paths in lexicographic order and all paths
+	* sharing a prefix are found below a single tree node
+	*/
+	class radix_tree
+	{
+	public:
+		/**
+		* Creates an empty tree
+		*
+		* @param[in] ignore_case	Store and compare keys with A-Z folded to a-z
+		* @param[in] resource		Memory resource used for all tree nodes
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] radix_tree(bool ignore_case, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		/**
+		* Frees all tree nodes. Does not touch the referenced vfs nodes
+		*
+		* @exceptsafe no-throw
+		*/
+		~radix_tree();
+
+		radix_tree(const radix_tree&) = delete;
+		radix_tree& operator=(const radix_tree&) = delete;
+
+		/**
+		* Associates a key with a node, replacing any previous association
+		*
+		* @param[in] key		The full node path
+		* @param[in] value		The node stored under key
+		*
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if a tree node could not be allocated
+		*/
+		void insert(std::string_view key, node* value);
+
+		/**
+		* Removes a key and merges the tree nodes that became redundant
+		*
+		* @param[in] key		The full node path
+		* @returns				Returns true if the key was present
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool erase(std::string_view key);
+
+		/**
+		* Appends all nodes whose key starts with prefix in lexicographic key order
+		*
+		* @param[in] prefix		The requested key prefix, an empty prefix lists every node
+		* @param[out] out_nodes	Receives the matching nodes, existing content is kept
+		*
+		* @returns				Number of appended nodes
+		* @exceptsafe basic
+		*/
+		size_t find_prefix(std::string_view prefix, std::vector<node*>& out_nodes) const;
+
+		/**
+		* Removes all keys
+		*
+		* @exceptsafe no-throw
+		*/
+		void clear();
+
+		/**
+		* Forgets all tree nodes without freeing them
+		* Only valid if the memory resource is released in bulk right after
+		*
+		* @exceptsafe no-throw
+		*/
+		void abandon();
+
+	private:
+		struct tree_node
+		{
+			std::pmr::string m_label;
+			node* m_value;
+			std::pmr::vector<tree_node*> m_children;
+		};
+
+		[[nodiscard]] char fold(char c) const;
+		[[nodiscard]] tree_node* create(std::string_view label, node* value);
+		void destroy(tree_node* entry);
+		void destroy_recursive(tree_node* entry);
+		[[nodiscard]] size_t child_position(const tree_node* parent, char first) const;
+		[[nodiscard]] size_t common_length(std::string_view label, std::string_view key) const;
+		void merge_with_child(tree_node* entry);
+
+	private:
+		std::pmr::memory_resource* m_resource;
+		tree_node* m_root;
+		bool m_ignore_case;
+	};
+}
@@ -10,19 +10,30 @@ namespace zvfs
 	* @param[in] ansi_paths				Require paths to be in the ASCII range.
 	*									Warning: Unicode encoded paths are not yet supported. Disable this with care!
 	* @param[in] max_path				The maximum length of any provided path for a node
+	* @param[in] prefix_index			Maintain a radix tree next to the hash index, speeds up vfs::list_prefix
+	*									at the cost of additional memory per node
+	* @param[in] substring_index		Maintain trigram posting lists of all paths, lets vfs::find skip the full scan
+	*									for filters of three or more characters at the cost of additional memory per node
+	* @param[in] thread_safe			Guard the vfs with a reader/writer lock. Searches and adds run in parallel, adds only
+	*									wait for each other on the same index shard or parent directory. Removing nodes
+	*									runs exclusively. vfs::get never locks, removed nodes are freed once no lookup
+	*									can still see them
 	* 
 	* @exceptsafe no-throw
 	*/
-	vfs_settings::vfs_settings(bool lowercase_filesystem, bool ansi_paths, size_t max_path)
+	vfs_settings::vfs_settings(bool lowercase_filesystem, bool ansi_paths, size_t max_path, bool prefix_index, bool substring_index, bool thread_safe)
 		: m_lowercase_filesystem(lowercase_filesystem)		
 		, m_ansi_paths(ansi_paths)
 		, m_max_path(max_path)
+		, m_prefix_index(prefix_index)
+		, m_substring_index(substring_index)
+		, m_thread_safe(thread_safe)
 	{
 
 	}
 
 	namespace settings
 	{
-		vfs_settings g_default_settings(true, true, 255);
+		vfs_settings g_default_settings(true, true, 255, false, false, false);
 	}
 } // namespace zvfs
\ No newline at end of file
@@ -14,14 +14,25 @@ namespace zvfs
 		* @param[in] ansi_paths				Require paths to be in the ASCII range.
 		*									Warning: Unicode encoded paths are not yet supported. Disable this with care!
 		* @param[in] max_path				The maximum length of any provided path for a node
+		* @param[in] prefix_index			Maintain a radix tree next to the hash index, speeds up vfs::list_prefix
+		*									at the cost of additional memory per node
+		* @param[in] substring_index		Maintain trigram posting lists of all paths, lets vfs::find skip the full scan
+		*									for filters of three or more characters at the cost of additional memory per node
+		* @param[in] thread_safe			Guard the vfs with a reader/writer lock. Searches and adds run in parallel, adds only
+		*									wait for each other on the same index shard or parent directory. Removing nodes
+		*									runs exclusively. vfs::get never locks, removed nodes are freed once no lookup
+		*									can still see them
 		* 
 		* @exceptsafe no-throw
 		*/
-		[[nodiscard]] vfs_settings(bool lowercase_filesystem = true, bool ansi_paths = true, size_t max_path = 255);
+		[[nodiscard]] vfs_settings(bool lowercase_filesystem = true, bool ansi_paths = true, size_t max_path = 255, bool prefix_index = false, bool substring_index = false, bool thread_safe = false);
 
 		bool m_lowercase_filesystem;
 		bool m_ansi_paths;
 		size_t m_max_path;
+		bool m_prefix_index;
+		bool m_substring_index;
+		bool m_thread_safe;
 	};
 
 	namespace settings
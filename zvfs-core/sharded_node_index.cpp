@@ -0,0 +1,156 @@
+#include "sharded_node_index.hpp"
+
+namespace zvfs
+{
+	/**
+	* Creates an empty index, no slot storage is allocated until the first insertion
+	*
+	* @param[in] shard_count	Number of shards, rounded up to a power of two
+	* @param[in] concurrent		Lock shards on modification and look up without locks
+	* @param[in] resource		Memory resource used for the slot storage, has to be synchronized in concurrent mode
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the shards could not be allocated
+	*/
+	sharded_node_index::sharded_node_index(size_t shard_count, bool concurrent, std::pmr::memory_resource* resource)
+		: m_concurrent(concurrent)
+	{
+		size_t count = 1;
+		while (count < shard_count)
+			count *= 2;
+
+		this->m_shards.reserve(count);
+		for (size_t i = 0; i < count; i++)
+			this->m_shards.push_back(std::make_unique<shard>(resource));
+
+		this->m_mask = count - 1;
+	}
+
+	/**
+	* Inserts a node keyed by node::hash()
+	* The caller is responsible for not inserting the same key twice
+	*
+	* @param[in] entry		The node to insert
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the shard could not grow
+	*/
+	void sharded_node_index::insert(node* entry)
+	{
+		shard& target = this->shard_of(entry->hash());
+
+		std::unique_lock<std::shared_mutex> lock = this->lock_exclusive(target);
+		target.m_index.insert(entry);
+	}
+
+	/**
+	* Removes a node from the index
+	*
+	* @param[in] entry		The node to remove. Compared by identity, not by key
+	* @returns				Returns true if the node was found and removed
+	*
+	* @exceptsafe no-throw
+	*/
+	bool sharded_node_index::erase(node* entry)
+	{
+		shard& target = this->shard_of(entry->hash());
+
+		std::unique_lock<std::shared_mutex> lock = this->lock_exclusive(target);
+		return target.m_index.erase(entry);
+	}
+
+	/**
+	* Grows the shards so that they can hold count evenly distributed nodes without rehashing
+	*
+	* @param[in] count		Number of nodes the index should be able to hold
+	*
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if a shard could not grow
+	*/
+	void sharded_node_index::reserve(size_t count)
+	{
+		// Hash bits spread nodes evenly, a little headroom absorbs the variance between shards
+		//
+		size_t per_shard = this->m_shards.size() == 1 ? count : count / this->m_shards.size() + count / (this->m_shards.size() * 8) + 1;
+
+		for (const std::unique_ptr<shard>& it : this->m_shards)
+		{
+			std::unique_lock<std::shared_mutex> lock = this->lock_exclusive(*it);
+			it->m_index.reserve(per_shard);
+		}
+	}
+
+	/**
+	* Removes all nodes and frees the slot storage. No other thread may access the index meanwhile
+	*
+	* @exceptsafe no-throw
+	*/
+	void sharded_node_index::clear()
+	{
+		for (const std::unique_ptr<shard>& it : this->m_shards)
+			it->m_index.clear();
+	}
+
+	/**
+	* Retrieves the number of nodes stored in all shards
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t sharded_node_index::size() const
+	{
+		size_t count = 0;
+		for (const std::unique_ptr<shard>& it : this->m_shards)
+		{
+			std::shared_lock<std::shared_mutex> lock = this->lock_shared(*it);
+			count += it->m_index.size();
+		}
+
+		return count;
+	}
+
+	/**
+	* Retrieves the number of units visit() splits the index into
+	* A single shard is split by slot positions, multiple shards are split by shard
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t sharded_node_index::partitions() const
+	{
+		if (this->m_shards.size() == 1)
+		{
+			std::shared_lock<std::shared_mutex> lock = this->lock_shared(*this->m_shards.front());
+			return this->m_shards.front()->m_index.capacity();
+		}
+
+		return this->m_shards.size();
+	}
+
+	/**
+	* Attaches an epoch domain to every shard, see node_index::set_epoch_domain
+	*
+	* @param[in] domain		The domain concurrent readers pin
+	*
+	* @exceptsafe no-throw
+	*/
+	void sharded_node_index::set_epoch_domain(epoch_domain* domain)
+	{
+		for (const std::unique_ptr<shard>& it : this->m_shards)
+			it->m_index.set_epoch_domain(domain);
+	}
+
+	std::shared_lock<std::shared_mutex> sharded_node_index::lock_shared(shard& target) const
+	{
+		if (!this->m_concurrent)
+			return {};
+
+		return std::shared_lock<std::shared_mutex>(target.m_mutex);
+	}
+
+	std::unique_lock<std::shared_mutex> sharded_node_index::lock_exclusive(shard& target) const
+	{
+		if (!this->m_concurrent)
+			return {};
+
+		return std::unique_lock<std::shared_mutex>(target.m_mutex);
+	}
+}
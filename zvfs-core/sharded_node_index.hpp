@@ -0,0 +1,210 @@
+#pragma once
+#include "node_index.hpp"
+#include "epoch.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Path index split into independent zvfs::node_index shards, selected by bits of the node hash
+	*
+	* In concurrent mode every shard has its own reader/writer lock, so inserts into different shards
+	* never wait for each other. Lookups never lock, they run through node_index::find_concurrent.
+	* With a single shard and concurrent mode disabled it behaves exactly like one zvfs::node_index
+	*/
+	class sharded_node_index
+	{
+	public:
+		/**
+		* Creates an empty index, no slot storage is allocated until the first insertion
+		*
+		* @param[in] shard_count	Number of shards, rounded up to a power of two
+		* @param[in] concurrent		Lock shards on modification and look up without locks
+		* @param[in] resource		Memory resource used for the slot storage, has to be synchronized in concurrent mode
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the shards could not be allocated
+		*/
+		[[nodiscard]] sharded_node_index(size_t shard_count, bool concurrent, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		sharded_node_index(const sharded_node_index&) = delete;
+		sharded_node_index& operator=(const sharded_node_index&) = delete;
+
+		/**
+		* Looks up a node by its hash
+		* In concurrent mode the caller has to be pinned in the attached epoch domain, see node_index::find_concurrent
+		*
+		* @param[in] hash		Hash of the requested key
+		* @param[in] equal		Callable invoked as equal(node*) for every hash match,
+		*						it has to return true if the node actually represents the requested key
+		*
+		* @returns				The matching node or a nullptr if the key is not present
+		* @exceptsafe no-throw
+		*/
+		template<typename Equal>
+		[[nodiscard]] node* find(size_t hash, Equal&& equal) const
+		{
+			const node_index& index = this->shard_of(hash).m_index;
+			if (this->m_concurrent)
+				return index.find_concurrent(hash, equal);
+
+			return index.find(hash, equal);
+		}
+
+		/**
+		* Inserts a node keyed by node::hash()
+		* The caller is responsible for not inserting the same key twice
+		*
+		* @param[in] entry		The node to insert
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the shard could not grow
+		*/
+		void insert(node* entry);
+
+		/**
+		* Removes a node from the index
+		*
+		* @param[in] entry		The node to remove. Compared by identity, not by key
+		* @returns				Returns true if the node was found and removed
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool erase(node* entry);
+
+		/**
+		* Grows the shards so that they can hold count evenly distributed nodes without rehashing
+		*
+		* @param[in] count		Number of nodes the index should be able to hold
+		*
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if a shard could not grow
+		*/
+		void reserve(size_t count);
+
+		/**
+		* Removes all nodes and frees the slot storage. No other thread may access the index meanwhile
+		*
+		* @exceptsafe no-throw
+		*/
+		void clear();
+
+		/**
+		* Retrieves the number of nodes stored in all shards
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t size() const;
+
+		/**
+		* Retrieves the number of units visit() splits the index into
+		* A single shard is split by slot positions, multiple shards are split by shard
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t partitions() const;
+
+		/**
+		* Calls a function for every node stored in the units [first, last) of partitions()
+		* Visiting disjoint unit ranges visits every node exactly once. In concurrent mode each shard is
+		* read locked while it is visited, nodes inserted meanwhile may or may not be visited
+		*
+		* @param[in] first		First unit
+		* @param[in] last		Unit after the last one
+		* @param[in] function	Invoked as function(node*)
+		*
+		* @exceptsafe basic
+		* @throws ...			Rethrows exceptions thrown by function
+		*/
+		template<typename Function>
+		void visit(size_t first, size_t last, Function&& function) const
+		{
+			if (this->m_shards.size() == 1)
+			{
+				const node_index& index = this->m_shards.front()->m_index;
+				std::shared_lock<std::shared_mutex> lock = this->lock_shared(*this->m_shards.front());
+
+				for (auto it = index.at(first), end = index.at(last); it != end; ++it)
+					function(*it);
+
+				return;
+			}
+
+			for (size_t i = first; i < last && i < this->m_shards.size(); i++)
+			{
+				std::shared_lock<std::shared_mutex> lock = this->lock_shared(*this->m_shards[i]);
+				for (node* it : this->m_shards[i]->m_index)
+					function(it);
+			}
+		}
+
+		/**
+		* Calls a function for every stored node without locking
+		* No other thread may modify the index meanwhile
+		*
+		* @param[in] function	Invoked as function(node*)
+		*
+		* @exceptsafe basic
+		* @throws ...			Rethrows exceptions thrown by function
+		*/
+		template<typename Function>
+		void for_each(Function&& function) const
+		{
+			for (const std::unique_ptr<shard>& it : this->m_shards)
+			{
+				for (node* entry : it->m_index)
+					function(entry);
+			}
+		}
+
+		/**
+		* Attaches an epoch domain to every shard, see node_index::set_epoch_domain
+		*
+		* @param[in] domain		The domain concurrent readers pin
+		*
+		* @exceptsafe no-throw
+		*/
+		void set_epoch_domain(epoch_domain* domain);
+
+	private:
+		// Shards are cache line aligned so writers of neighbouring shards don't share lines
+		//
+		struct alignas(64) shard
+		{
+			explicit shard(std::pmr::memory_resource* resource)
+				: m_index(resource)
+			{
+			}
+
+			std::shared_mutex m_mutex;
+			node_index m_index;
+		};
+
+		[[nodiscard]] const shard& shard_of(size_t hash) const
+		{
+			// The index itself probes by the top bits of the same product, the shard takes bits below those
+			//
+			return *this->m_shards[static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> 24) & this->m_mask];
+		}
+
+		[[nodiscard]] shard& shard_of(size_t hash)
+		{
+			return const_cast<shard&>(std::as_const(*this).shard_of(hash));
+		}
+
+		[[nodiscard]] std::shared_lock<std::shared_mutex> lock_shared(shard& target) const;
+		[[nodiscard]] std::unique_lock<std::shared_mutex> lock_exclusive(shard& target) const;
+
+	private:
+		std::vector<std::unique_ptr<shard>> m_shards;
+		size_t m_mask;
+		bool m_concurrent;
+	};
+}
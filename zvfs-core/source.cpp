@@ -0,0 +1,380 @@
+#include "source.hpp"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zvfs
+{
+	/**
+	* Adds a reference
+	*
+	* @exceptsafe no-throw
+	*/
+	void source::reference()
+	{
+		this->m_references.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	* Releases a reference, the source is deleted when it was the last one
+	*
+	* @returns				The number of references left
+	* @exceptsafe no-throw
+	*/
+	uint64_t source::release()
+	{
+		// The releasing thread has to see every write done through the other references before deleting
+		//
+		uint64_t remaining = this->m_references.fetch_sub(1, std::memory_order_acq_rel) - 1;
+		if (!remaining)
+			delete this;
+
+		return remaining;
+	}
+
+	/**
+	* Retrieves the whole contents without copying, if the source has them in memory
+	*
+	* @returns				The contents, valid as long as the source. Empty by default
+	* @exceptsafe no-throw
+	*/
+	std::span<const std::byte> source::view() const
+	{
+		return {};
+	}
+
+	source::source()
+		: m_references(1)
+	{
+	}
+
+	/**
+	* Opens a file for reading
+	*
+	* @param[in] path		Path of the file
+	*
+	* @returns				The source holding one reference or a nullptr if the file could not be opened
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the source could not be allocated
+	*/
+	fd_source* fd_source::open(const std::filesystem::path& path)
+	{
+#ifdef _WIN32
+		HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+			return nullptr;
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(handle, &file_size))
+		{
+			CloseHandle(handle);
+			return nullptr;
+		}
+
+		intptr_t descriptor = reinterpret_cast<intptr_t>(handle);
+		uint64_t size = static_cast<uint64_t>(file_size.QuadPart);
+#else
+		int handle = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (handle < 0)
+			return nullptr;
+
+		struct stat status;
+		if (fstat(handle, &status) != 0)
+		{
+			::close(handle);
+			return nullptr;
+		}
+
+		intptr_t descriptor = handle;
+		uint64_t size = static_cast<uint64_t>(status.st_size);
+#endif
+
+		try
+		{
+			return new fd_source(descriptor, size);
+		}
+		catch (...)
+		{
+#ifdef _WIN32
+			CloseHandle(handle);
+#else
+			::close(handle);
+#endif
+			throw;
+		}
+	}
+
+	/**
+	* Retrieves the size of the file when it was opened
+	*
+	* @exceptsafe no-throw
+	*/
+	uint64_t fd_source::size() const
+	{
+		return this->m_size;
+	}
+
+	/**
+	* Reads contents starting at an offset, like pread
+	* Reads at or past the end read nothing, reads crossing the end are shortened
+	*
+	* @param[in] offset		Position of the first byte to read
+	* @param[out] out_buffer	Receives the contents, up to its size is read
+	*
+	* @returns				Number of bytes read or static_cast<size_t>(-1) if reading failed
+	* @exceptsafe no-throw
+	*/
+	size_t fd_source::read_at(uint64_t offset, std::span<std::byte> out_buffer) const
+	{
+		if (offset >= this->m_size)
+			return 0;
+
+		size_t count = static_cast<size_t>(std::min<uint64_t>(out_buffer.size(), this->m_size - offset));
+		size_t done = 0;
+
+		// Both calls may return less than requested, the rest is read until the end of the file
+		//
+		while (done < count)
+		{
+#ifdef _WIN32
+			OVERLAPPED position = {};
+			position.Offset = static_cast<DWORD>(offset + done);
+			position.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+
+			DWORD chunk = static_cast<DWORD>(std::min<size_t>(count - done, 0x40000000));
+			DWORD result = 0;
+			if (!ReadFile(reinterpret_cast<HANDLE>(this->m_descriptor), out_buffer.data() + done, chunk, &result, &position))
+			{
+				if (GetLastError() == ERROR_HANDLE_EOF)
+					break;
+
+				return static_cast<size_t>(-1);
+			}
+#else
+			ssize_t result = pread(static_cast<int>(this->m_descriptor), out_buffer.data() + done, count - done, static_cast<off_t>(offset + done));
+			if (result < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				return static_cast<size_t>(-1);
+			}
+#endif
+
+			// The file shrank since it was opened
+			//
+			if (result == 0)
+				break;
+
+			done += static_cast<size_t>(result);
+		}
+
+		return done;
+	}
+
+	fd_source::~fd_source()
+	{
+#ifdef _WIN32
+		CloseHandle(reinterpret_cast<HANDLE>(this->m_descriptor));
+#else
+		::close(static_cast<int>(this->m_descriptor));
+#endif
+	}
+
+	fd_source::fd_source(intptr_t descriptor, uint64_t size)
+		: m_descriptor(descriptor)
+		, m_size(size)
+	{
+	}
+
+	/**
+	* Maps a file
+	*
+	* @param[in] path		Path of the file
+	* @param[in] hints		Access hints applied to the whole mapping, see mapped_file::advise
+	*
+	* @returns				The source holding one reference or a nullptr if the file could not be mapped.
+	*						Empty files can't be mapped
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the source could not be allocated
+	*/
+	mapped_source* mapped_source::open(const std::filesystem::path& path, uint32_t hints)
+	{
+		// Only the last reference may destroy a source, a failed one drops the reference it was created with
+		//
+		mapped_source* result = new mapped_source();
+		if (!result->m_mapping.open(path))
+		{
+			result->release();
+			return nullptr;
+		}
+
+		if (hints)
+			result->m_mapping.advise(hints);
+
+		return result;
+	}
+
+	/**
+	* Retrieves the size of the mapped file
+	*
+	* @exceptsafe no-throw
+	*/
+	uint64_t mapped_source::size() const
+	{
+		return this->m_mapping.size();
+	}
+
+	/**
+	* Copies contents starting at an offset out of the mapping
+	* Reads at or past the end read nothing, reads crossing the end are shortened
+	*
+	* @param[in] offset		Position of the first byte to read
+	* @param[out] out_buffer	Receives the contents, up to its size is read
+	*
+	* @returns				Number of bytes read
+	* @exceptsafe no-throw
+	*/
+	size_t mapped_source::read_at(uint64_t offset, std::span<std::byte> out_buffer) const
+	{
+		if (offset >= this->m_mapping.size())
+			return 0;
+
+		size_t count = std::min(out_buffer.size(), this->m_mapping.size() - static_cast<size_t>(offset));
+		if (count)
+			std::memcpy(out_buffer.data(), this->m_mapping.data() + offset, count);
+
+		return count;
+	}
+
+	/**
+	* Retrieves the whole mapping
+	*
+	* @exceptsafe no-throw
+	*/
+	std::span<const std::byte> mapped_source::view() const
+	{
+		return std::span<const std::byte>(this->m_mapping.data(), this->m_mapping.size());
+	}
+
+	/**
+	* Applies access hints to a range of the mapping, for example to prefetch one entry
+	*
+	* @param[in] hints		Combination of mapped_file::g_sequential, mapped_file::g_willneed and mapped_file::g_hugepage
+	* @param[in] offset		First byte of the range
+	* @param[in] length		Length of the range, clamped to the mapping
+	*
+	* @exceptsafe no-throw
+	*/
+	void mapped_source::advise(uint32_t hints, uint64_t offset, uint64_t length) const
+	{
+		if (offset >= this->m_mapping.size())
+			return;
+
+		this->m_mapping.advise(hints, static_cast<size_t>(offset), static_cast<size_t>(std::min<uint64_t>(length, this->m_mapping.size() - offset)));
+	}
+
+	mapped_source::~mapped_source() = default;
+
+	/**
+	* Creates a file covering [offset, offset + size) of a source
+	*
+	* @param[in] origin		The source, gains a reference
+	* @param[in] offset		Position of the first byte of the file inside the source
+	* @param[in] size		Size of the file in bytes
+	*
+	* @exceptsafe no-throw
+	*/
+	source_file::source_file(source* origin, uint64_t offset, uint64_t size)
+		: m_origin(origin)
+		, m_offset(offset)
+		, m_size(size)
+	{
+		this->m_origin->reference();
+	}
+
+	/**
+	* Releases the reference to the source
+	*
+	* @exceptsafe no-throw
+	*/
+	source_file::~source_file()
+	{
+		this->m_origin->release();
+	}
+
+	/**
+	* Retrieves the size of the file contents in bytes
+	*
+	* @exceptsafe no-throw
+	*/
+	uint64_t source_file::size() const
+	{
+		return this->m_size;
+	}
+
+	/**
+	* Reads file contents starting at an offset, like pread
+	* Reads at or past the end of the file read nothing, reads crossing the end are shortened
+	*
+	* @param[in] offset		Position of the first byte to read
+	* @param[out] out_buffer	Receives the contents, up to its size is read
+	*
+	* @returns				Number of bytes read or static_cast<size_t>(-1) if reading failed
+	* @exceptsafe no-throw
+	*/
+	size_t source_file::read_at(uint64_t offset, std::span<std::byte> out_buffer) const
+	{
+		if (offset >= this->m_size)
+			return 0;
+
+		size_t count = static_cast<size_t>(std::min<uint64_t>(out_buffer.size(), this->m_size - offset));
+		return this->m_origin->read_at(this->m_offset + offset, out_buffer.first(count));
+	}
+
+	/**
+	* Retrieves the file contents without copying if the source has them in memory
+	*
+	* @returns				The contents or an empty span if the source has no view or the range exceeds it
+	* @exceptsafe no-throw
+	*/
+	std::span<const std::byte> source_file::view() const
+	{
+		std::span<const std::byte> contents = this->m_origin->view();
+		if (this->m_offset > contents.size() || this->m_size > contents.size() - this->m_offset)
+			return {};
+
+		return contents.subspan(static_cast<size_t>(this->m_offset), static_cast<size_t>(this->m_size));
+	}
+
+	/**
+	* Retrieves the source the file reads from
+	*
+	* @exceptsafe no-throw
+	*/
+	source* source_file::origin() const
+	{
+		return this->m_origin;
+	}
+
+	/**
+	* Retrieves the position of the first byte of the file inside its source
+	*
+	* @exceptsafe no-throw
+	*/
+	uint64_t source_file::offset() const
+	{
+		return this->m_offset;
+	}
+}
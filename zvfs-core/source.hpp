@@ -0,0 +1,266 @@
+#pragma once
+#include "node.hpp"
+#include "mapped_file.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace zvfs
+{
+	/**
+	* Reference counted, randomly readable container of file contents, usually an archive
+	* Backends create one source per archive and one zvfs::source_file per entry that refers to a range of it
+	*
+	* Reads take an explicit offset and share no cursor, any number of threads may read one source at once.
+	* A source is created with one reference and deletes itself when the last one is released
+	*/
+	class source
+	{
+	public:
+		source(const source&) = delete;
+		source& operator=(const source&) = delete;
+
+		/**
+		* Adds a reference
+		*
+		* @exceptsafe no-throw
+		*/
+		void reference();
+
+		/**
+		* Releases a reference, the source is deleted when it was the last one
+		*
+		* @returns				The number of references left
+		* @exceptsafe no-throw
+		*/
+		uint64_t release();
+
+		/**
+		* Retrieves the size of the source in bytes
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] virtual uint64_t size() const = 0;
+
+		/**
+		* Reads contents starting at an offset, like pread
+		* Reads at or past the end read nothing, reads crossing the end are shortened
+		*
+		* @param[in] offset		Position of the first byte to read
+		* @param[out] out_buffer	Receives the contents, up to its size is read
+		*
+		* @returns				Number of bytes read or static_cast<size_t>(-1) if reading failed
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] virtual size_t read_at(uint64_t offset, std::span<std::byte> out_buffer) const = 0;
+
+		/**
+		* Retrieves the whole contents without copying, if the source has them in memory
+		*
+		* @returns				The contents, valid as long as the source. Empty by default
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] virtual std::span<const std::byte> view() const;
+
+	protected:
+		[[nodiscard]] source();
+		virtual ~source() = default;
+
+	private:
+		std::atomic<uint64_t> m_references;
+	};
+
+	/**
+	* Source reading a file through a shared descriptor with pread, or ReadFile with an explicit offset on Windows
+	* Reads go straight to the operating system, nothing is locked or buffered
+	*/
+	class fd_source : public source
+	{
+	public:
+		/**
+		* Opens a file for reading
+		*
+		* @param[in] path		Path of the file
+		*
+		* @returns				The source holding one reference or a nullptr if the file could not be opened
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the source could not be allocated
+		*/
+		[[nodiscard]] static fd_source* open(const std::filesystem::path& path);
+
+		/**
+		* Retrieves the size of the file when it was opened
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] uint64_t size() const override;
+
+		/**
+		* Reads contents starting at an offset, like pread
+		* Reads at or past the end read nothing, reads crossing the end are shortened
+		*
+		* @param[in] offset		Position of the first byte to read
+		* @param[out] out_buffer	Receives the contents, up to its size is read
+		*
+		* @returns				Number of bytes read or static_cast<size_t>(-1) if reading failed
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t read_at(uint64_t offset, std::span<std::byte> out_buffer) const override;
+
+	protected:
+		~fd_source() override;
+
+	private:
+		fd_source(intptr_t descriptor, uint64_t size);
+
+	private:
+		// A file descriptor, or a HANDLE on Windows
+		//
+		intptr_t m_descriptor;
+		uint64_t m_size;
+	};
+
+	/**
+	* Source mapping a whole file once, for archives that store their entries uncompressed
+	* Entries expose views straight into the mapping, see source_file::view, reads copy from it
+	*/
+	class mapped_source : public source
+	{
+	public:
+		/**
+		* Maps a file
+		*
+		* @param[in] path		Path of the file
+		* @param[in] hints		Access hints applied to the whole mapping, see mapped_file::advise
+		*
+		* @returns				The source holding one reference or a nullptr if the file could not be mapped.
+		*						Empty files can't be mapped
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the source could not be allocated
+		*/
+		[[nodiscard]] static mapped_source* open(const std::filesystem::path& path, uint32_t hints = 0);
+
+		/**
+		* Retrieves the size of the mapped file
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] uint64_t size() const override;
+
+		/**
+		* Copies contents starting at an offset out of the mapping
+		* Reads at or past the end read nothing, reads crossing the end are shortened
+		*
+		* @param[in] offset		Position of the first byte to read
+		* @param[out] out_buffer	Receives the contents, up to its size is read
+		*
+		* @returns				Number of bytes read
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t read_at(uint64_t offset, std::span<std::byte> out_buffer) const override;
+
+		/**
+		* Retrieves the whole mapping
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] std::span<const std::byte> view() const override;
+
+		/**
+		* Applies access hints to a range of the mapping, for example to prefetch one entry
+		*
+		* @param[in] hints		Combination of mapped_file::g_sequential, mapped_file::g_willneed and mapped_file::g_hugepage
+		* @param[in] offset		First byte of the range
+		* @param[in] length		Length of the range, clamped to the mapping
+		*
+		* @exceptsafe no-throw
+		*/
+		void advise(uint32_t hints, uint64_t offset, uint64_t length) const;
+
+	protected:
+		~mapped_source() override;
+
+	private:
+		mapped_source() = default;
+
+	private:
+		mapped_file m_mapping;
+	};
+
+	/**
+	* File data referring to a range of a zvfs::source, typically one archive entry
+	* Holds a reference to the source for its whole lifetime
+	*/
+	class source_file : public file
+	{
+	public:
+		/**
+		* Creates a file covering [offset, offset + size) of a source
+		*
+		* @param[in] origin		The source, gains a reference
+		* @param[in] offset		Position of the first byte of the file inside the source
+		* @param[in] size		Size of the file in bytes
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] source_file(source* origin, uint64_t offset, uint64_t size);
+
+		/**
+		* Releases the reference to the source
+		*
+		* @exceptsafe no-throw
+		*/
+		~source_file() override;
+
+		source_file(const source_file&) = delete;
+		source_file& operator=(const source_file&) = delete;
+
+		/**
+		* Retrieves the size of the file contents in bytes
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] uint64_t size() const override;
+
+		/**
+		* Reads file contents starting at an offset, like pread
+		* Reads at or past the end of the file read nothing, reads crossing the end are shortened
+		*
+		* @param[in] offset		Position of the first byte to read
+		* @param[out] out_buffer	Receives the contents, up to its size is read
+		*
+		* @returns				Number of bytes read or static_cast<size_t>(-1) if reading failed
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t read_at(uint64_t offset, std::span<std::byte> out_buffer) const override;
+
+		/**
+		* Retrieves the file contents without copying if the source has them in memory
+		*
+		* @returns				The contents or an empty span if the source has no view or the range exceeds it
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] std::span<const std::byte> view() const override;
+
+		/**
+		* Retrieves the source the file reads from
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] source* origin() const;
+
+		/**
+		* Retrieves the position of the first byte of the file inside its source
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] uint64_t offset() const;
+
+	private:
+		source* m_origin;
+		uint64_t m_offset;
+		uint64_t m_size;
+	};
+}
@@ -0,0 +1,130 @@
+#include "string_pool.hpp"
+#include "hash.hpp"
+#include <cstring>
+
+namespace zvfs
+{
+	namespace
+	{
+		constexpr size_t g_initial_block_size = 16 * 1024;
+		constexpr size_t g_min_table_size = 64;
+	}
+
+	/**
+	* Creates an empty pool
+	*
+	* @param[in] resource	Upstream memory resource for the string blocks and the lookup table
+	*
+	* @exceptsafe no-throw
+	*/
+	string_pool::string_pool(std::pmr::memory_resource* resource)
+		: m_storage(g_initial_block_size, resource)
+		, m_table(resource)
+		, m_size(0)
+	{
+	}
+
+	/**
+	* Retrieves the pooled copy of a string, storing it on first use
+	*
+	* @param[in] value		The string to intern
+	* @returns				A view into the pool with the same content as value
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the pool could not grow
+	*/
+	std::string_view string_pool::intern(std::string_view value)
+	{
+		if (value.empty())
+			return {};
+
+		// Keep the table at most half full, probing is linear
+		//
+		if ((this->m_size + 1) * 2 > this->m_table.size())
+			this->grow();
+
+		// Components are hashed exactly, the pool preserves the original spelling
+		//
+		size_t hash = path_hasher::hash(value, false, false);
+		size_t mask = this->m_table.size() - 1;
+		size_t position = hash & mask;
+
+		while (this->m_table[position].m_data)
+		{
+			const entry& current = this->m_table[position];
+			if (current.m_hash == hash && std::string_view(current.m_data, current.m_size) == value)
+				return { current.m_data, current.m_size };
+
+			position = (position + 1) & mask;
+		}
+
+		char* data = static_cast<char*>(this->m_storage.allocate(value.size(), 1));
+		std::memcpy(data, value.data(), value.size());
+
+		this->m_table[position] = { hash, data, value.size() };
+		this->m_size++;
+
+		return { data, value.size() };
+	}
+
+	/**
+	* Allocates storage for strings that are already deduplicated, for example restored from a file
+	* The storage lives as long as interned strings but is not indexed, intern may store its strings again
+	*
+	* @param[in] size		Number of bytes
+	* @returns				Uninitialized storage of the requested size
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the pool could not grow
+	*/
+	char* string_pool::allocate(size_t size)
+	{
+		return static_cast<char*>(this->m_storage.allocate(size ? size : 1, 1));
+	}
+
+	/**
+	* Releases all strings and the lookup table
+	* Invalidates every view returned by intern
+	*
+	* @exceptsafe no-throw
+	*/
+	void string_pool::clear()
+	{
+		this->m_table.clear();
+		this->m_table.shrink_to_fit();
+		this->m_storage.release();
+		this->m_size = 0;
+	}
+
+	/**
+	* Retrieves the number of distinct strings in the pool
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t string_pool::size() const
+	{
+		return this->m_size;
+	}
+
+	void string_pool::grow()
+	{
+		size_t capacity = this->m_table.empty() ? g_min_table_size : this->m_table.size() * 2;
+
+		std::pmr::vector<entry> table(capacity, entry{ 0, nullptr, 0 }, this->m_table.get_allocator());
+		size_t mask = capacity - 1;
+
+		for (const entry& it : this->m_table)
+		{
+			if (!it.m_data)
+				continue;
+
+			size_t position = it.m_hash & mask;
+			while (table[position].m_data)
+				position = (position + 1) & mask;
+
+			table[position] = it;
+		}
+
+		this->m_table.swap(table);
+	}
+}
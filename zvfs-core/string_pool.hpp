@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Deduplicating storage for path components
+	*
+	* Every distinct string is stored exactly once in densely packed blocks.
+	* Strings stay valid until the pool is cleared or destroyed, interned strings are never freed individually
+	*/
+	class string_pool
+	{
+	public:
+		/**
+		* Creates an empty pool
+		*
+		* @param[in] resource	Upstream memory resource for the string blocks and the lookup table
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] string_pool(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		string_pool(const string_pool&) = delete;
+		string_pool& operator=(const string_pool&) = delete;
+
+		/**
+		* Retrieves the pooled copy of a string, storing it on first use
+		*
+		* @param[in] value		The string to intern
+		* @returns				A view into the pool with the same content as value
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the pool could not grow
+		*/
+		[[nodiscard]] std::string_view intern(std::string_view value);
+
+		/**
+		* Allocates storage for strings that are already deduplicated, for example restored from a file
+		* The storage lives as long as interned strings but is not indexed, intern may store its strings again
+		*
+		* @param[in] size		Number of bytes
+		* @returns				Uninitialized storage of the requested size
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the pool could not grow
+		*/
+		[[nodiscard]] char* allocate(size_t size);
+
+		/**
+		* Releases all strings and the lookup table
+		* Invalidates every view returned by intern
+		*
+		* @exceptsafe no-throw
+		*/
+		void clear();
+
+		/**
+		* Retrieves the number of distinct strings in the pool
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t size() const;
+
+	private:
+		struct entry
+		{
+			size_t m_hash;
+			const char* m_data;
+			size_t m_size;
+		};
+
+		void grow();
+
+	private:
+		std::pmr::monotonic_buffer_resource m_storage;
+		std::pmr::vector<entry> m_table;
+		size_t m_size;
+	};
+}
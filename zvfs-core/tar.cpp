@@ -0,0 +1,477 @@
+#include "tar.hpp"
+#include "archive.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace zvfs
+{
+	namespace
+	{
+		constexpr uint64_t g_block_size = 512;
+
+		// Headers of small entries follow each other closely, one buffered read covers many of them
+		//
+		constexpr size_t g_window_size = 256 * 1024;
+
+		// Long names and pax records are read into memory, anything larger is treated as damage
+		//
+		constexpr uint64_t g_max_metadata_size = 1024 * 1024;
+
+		// Header layout shared by ustar, GNU and pax archives
+		//
+		constexpr size_t g_name_offset = 0;
+		constexpr size_t g_name_size = 100;
+		constexpr size_t g_size_offset = 124;
+		constexpr size_t g_size_size = 12;
+		constexpr size_t g_checksum_offset = 148;
+		constexpr size_t g_checksum_size = 8;
+		constexpr size_t g_type_offset = 156;
+		constexpr size_t g_link_offset = 157;
+		constexpr size_t g_link_size = 100;
+		constexpr size_t g_magic_offset = 257;
+		constexpr size_t g_prefix_offset = 345;
+		constexpr size_t g_prefix_size = 155;
+
+		// Old GNU sparse headers flag whether extension blocks with more of the sparse map follow them
+		//
+		constexpr size_t g_sparse_extended_offset = 482;
+		constexpr size_t g_extension_extended_offset = 504;
+
+		struct tar_entry
+		{
+			uint64_t m_data_offset;
+			uint64_t m_size;
+			uint32_t m_path_offset;
+			uint32_t m_path_size;
+			bool m_is_file;
+		};
+
+		// Records of a pax extended header that apply to the next regular header
+		//
+		struct pax_records
+		{
+			std::string m_path;
+			std::string m_link;
+			uint64_t m_size = 0;
+			bool m_has_path = false;
+			bool m_has_link = false;
+			bool m_has_size = false;
+		};
+
+		// Hands out byte ranges of the archive, straight from the view or from a window of buffered reads
+		//
+		class block_reader
+		{
+		public:
+			explicit block_reader(source& archive)
+				: m_archive(archive)
+				, m_view(archive.view())
+				, m_window_offset(0)
+				, m_window_size(0)
+			{
+			}
+
+			const std::byte* at(uint64_t offset, uint64_t size)
+			{
+				if (!this->m_view.empty())
+				{
+					if (offset > this->m_view.size() || size > this->m_view.size() - offset)
+						return nullptr;
+
+					return this->m_view.data() + offset;
+				}
+
+				if (offset >= this->m_window_offset && offset + size <= this->m_window_offset + this->m_window_size)
+					return this->m_window.data() + (offset - this->m_window_offset);
+
+				this->m_window.resize(std::max<size_t>(g_window_size, static_cast<size_t>(size)));
+				this->m_window_offset = offset;
+				this->m_window_size = this->m_archive.read_at(offset, this->m_window);
+
+				if (this->m_window_size == static_cast<size_t>(-1))
+					this->m_window_size = 0;
+
+				return this->m_window_size >= size ? this->m_window.data() : nullptr;
+			}
+
+		private:
+			source& m_archive;
+			std::span<const std::byte> m_view;
+			std::vector<std::byte> m_window;
+			uint64_t m_window_offset;
+			size_t m_window_size;
+		};
+
+		// Octal fields are parsed without data dependent branches: digits are accumulated while a running mask
+		// stays set, the first NUL or space clears it. GNU stores values that don't fit as base-256 instead
+		//
+		bool parse_number(const std::byte* field, size_t width, uint64_t& out_value)
+		{
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(field);
+			if (bytes[0] & 0x80)
+			{
+				// Negative values and values above 64 bits are rejected
+				//
+				if (bytes[0] != 0x80)
+					return false;
+
+				uint64_t value = 0;
+				for (size_t i = 1; i < width; i++)
+				{
+					if (value >> 56)
+						return false;
+
+					value = (value << 8) | bytes[i];
+				}
+
+				out_value = value;
+				return true;
+			}
+
+			size_t first = 0;
+			while (first < width && bytes[first] == ' ')
+				first++;
+
+			uint64_t value = 0;
+			uint64_t running = ~uint64_t(0);
+			for (size_t i = first; i < width; i++)
+			{
+				uint64_t digit = static_cast<uint64_t>(bytes[i]) - '0';
+				running &= 0 - static_cast<uint64_t>(digit < 8);
+				value = (((value << 3) | digit) & running) | (value & ~running);
+			}
+
+			out_value = value;
+			return true;
+		}
+
+		// The checksum covers the header with its own field read as spaces, old archives summed signed bytes
+		//
+		bool valid_checksum(const std::byte* block, uint32_t unsigned_sum)
+		{
+			uint64_t stored = 0;
+			if (!parse_number(block + g_checksum_offset, g_checksum_size, stored))
+				return false;
+
+			uint32_t field_sum = 0;
+			for (size_t i = g_checksum_offset; i < g_checksum_offset + g_checksum_size; i++)
+				field_sum += static_cast<uint8_t>(block[i]);
+
+			if (stored == unsigned_sum - field_sum + ' ' * g_checksum_size)
+				return true;
+
+			int32_t signed_sum = 0;
+			for (size_t i = 0; i < g_block_size; i++)
+			{
+				if (i < g_checksum_offset || i >= g_checksum_offset + g_checksum_size)
+					signed_sum += static_cast<int8_t>(block[i]);
+			}
+
+			return static_cast<int64_t>(stored) == signed_sum + static_cast<int32_t>(' ' * g_checksum_size);
+		}
+
+		uint32_t block_sum(const std::byte* block)
+		{
+			// A plain reduction over the block, compilers vectorize it
+			//
+			uint32_t sum = 0;
+			for (size_t i = 0; i < g_block_size; i++)
+				sum += static_cast<uint8_t>(block[i]);
+
+			return sum;
+		}
+
+		std::string_view field_string(const std::byte* field, size_t width)
+		{
+			const char* begin = reinterpret_cast<const char*>(field);
+			const void* end = std::memchr(begin, 0, width);
+			return std::string_view(begin, end ? static_cast<const char*>(end) - begin : width);
+		}
+
+		// Records look like "<length> <key>=<value>\n", the length counts the whole record
+		//
+		bool parse_pax(std::string_view records, pax_records& out_records)
+		{
+			while (!records.empty())
+			{
+				size_t separator = records.find(' ');
+				if (separator == std::string_view::npos || !separator)
+					return false;
+
+				uint64_t length = 0;
+				for (size_t i = 0; i < separator; i++)
+				{
+					uint64_t digit = static_cast<uint64_t>(records[i]) - '0';
+					if (digit > 9 || length > records.size())
+						return false;
+
+					length = length * 10 + digit;
+				}
+
+				if (length <= separator + 1 || length > records.size() || records[length - 1] != '\n')
+					return false;
+
+				std::string_view record = records.substr(separator + 1, length - separator - 2);
+				records.remove_prefix(length);
+
+				size_t equals = record.find('=');
+				if (equals == std::string_view::npos)
+					return false;
+
+				std::string_view key = record.substr(0, equals);
+				std::string_view value = record.substr(equals + 1);
+
+				if (key == "path")
+				{
+					out_records.m_path.assign(value);
+					out_records.m_has_path = true;
+				}
+				else if (key == "linkpath")
+				{
+					out_records.m_link.assign(value);
+					out_records.m_has_link = true;
+				}
+				else if (key == "size")
+				{
+					uint64_t size = 0;
+					for (char it : value)
+					{
+						uint64_t digit = static_cast<uint64_t>(it) - '0';
+						if (digit > 9 || size > (UINT64_MAX - digit) / 10)
+							return false;
+
+						size = size * 10 + digit;
+					}
+
+					out_records.m_size = size;
+					out_records.m_has_size = true;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	/**
+	* Adds every entry of a tar archive to a vfs
+	* Understands ustar, GNU (long names and links, base-256 sizes) and pax (path, linkpath and size records) archives.
+	* Headers are read from the view of the source if it has one and through large buffered reads otherwise, every
+	* header checksum is verified. Files become zvfs::source_file data referring to their range of the archive, hard
+	* links share the range of the entry they name. Symbolic links, devices, GNU sparse files, volume labels,
+	* multivolume continuations and global pax headers are skipped. The whole archive is validated before the first
+	* node is added, the nodes are then registered through vfs::add_bulk
+	*
+	* @param[in] target		The vfs receiving the entries
+	* @param[in] archive	The archive, every mounted file holds a reference to it
+	*
+	* @returns				If the function succeeded it returns the number of mounted entries.
+	*						Later entries replace earlier ones with the same path, paths that already had data keep it.
+	*						Returns -1 if the archive is damaged, truncated or could not be read, nothing is added then
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the entries could not be allocated. Nodes added up to this point remain valid
+	*/
+	size_t mount_tar(vfs& target, source& archive)
+	{
+		block_reader reader(archive);
+		uint64_t archive_size = archive.size();
+
+		std::vector<tar_entry> entries;
+		std::string paths;
+
+		// Hard links name an earlier entry, the index is only built once the first link shows up
+		//
+		std::unordered_map<std::string, size_t> entries_by_path;
+		size_t indexed_entries = 0;
+
+		// Extension headers apply to the next regular header only
+		//
+		std::string long_name;
+		std::string long_link;
+		pax_records pax;
+		bool has_long_name = false;
+		bool has_long_link = false;
+
+		std::string name;
+		std::string link;
+		uint64_t offset = 0;
+
+		// Archives end with zero blocks, a missing end marker right at the end of the data is tolerated
+		//
+		while (offset < archive_size)
+		{
+			const std::byte* block = reader.at(offset, g_block_size);
+			if (!block)
+				return static_cast<size_t>(-1);
+
+			uint32_t sum = block_sum(block);
+			if (!sum)
+				break;
+
+			if (!valid_checksum(block, sum))
+				return static_cast<size_t>(-1);
+
+			uint64_t size = 0;
+			if (!parse_number(block + g_size_offset, g_size_size, size))
+				return static_cast<size_t>(-1);
+
+			char type = static_cast<char>(block[g_type_offset]);
+			bool is_extension = type == 'L' || type == 'K' || type == 'x' || type == 'g';
+			if (pax.m_has_size && !is_extension)
+				size = pax.m_size;
+
+			// The sparse map of old GNU sparse files may continue in extension blocks between header and data
+			//
+			uint64_t data_offset = offset + g_block_size;
+			if (type == 'S' && block[g_sparse_extended_offset] != std::byte(0))
+			{
+				const std::byte* extension = nullptr;
+				do
+				{
+					extension = reader.at(data_offset, g_block_size);
+					if (!extension)
+						return static_cast<size_t>(-1);
+
+					data_offset += g_block_size;
+				}
+				while (extension[g_extension_extended_offset] != std::byte(0));
+			}
+
+			if (data_offset > archive_size || size > archive_size - data_offset)
+				return static_cast<size_t>(-1);
+
+			offset = data_offset + ((size + g_block_size - 1) & ~(g_block_size - 1));
+
+			if (type == 'L' || type == 'K' || type == 'x')
+			{
+				if (size > g_max_metadata_size)
+					return static_cast<size_t>(-1);
+
+				const std::byte* data = reader.at(data_offset, size);
+				if (!data)
+					return static_cast<size_t>(-1);
+
+				if (type == 'L')
+				{
+					long_name.assign(field_string(data, static_cast<size_t>(size)));
+					has_long_name = true;
+				}
+				else if (type == 'K')
+				{
+					long_link.assign(field_string(data, static_cast<size_t>(size)));
+					has_long_link = true;
+				}
+				else if (!parse_pax(std::string_view(reinterpret_cast<const char*>(data), static_cast<size_t>(size)), pax))
+				{
+					return static_cast<size_t>(-1);
+				}
+
+				continue;
+			}
+
+			// Global headers carry nothing that is mounted
+			//
+			if (is_extension)
+				continue;
+
+			// Unknown types are regular files, as POSIX asks. Symbolic links, devices and FIFOs have no data.
+			// Sparse files store their data without the holes, volume labels name the archive and multivolume
+			// entries only hold the rest of a file that started in another archive, none of them is mounted
+			//
+			bool is_file = type != '5' && type != 'D';
+			bool is_hard_link = type == '1';
+			bool is_skipped = type == '2' || type == '3' || type == '4' || type == '6' || type == 'S' || type == 'V' || type == 'M';
+
+			// Only POSIX ustar headers have a prefix, GNU headers store other fields there
+			//
+			if (pax.m_has_path)
+				name = pax.m_path;
+			else if (has_long_name)
+				name = long_name;
+			else
+			{
+				std::string_view prefix;
+				if (std::memcmp(block + g_magic_offset, "ustar\0", 6) == 0)
+					prefix = field_string(block + g_prefix_offset, g_prefix_size);
+
+				name.assign(prefix);
+				if (!prefix.empty())
+					name += '/';
+
+				name += field_string(block + g_name_offset, g_name_size);
+			}
+
+			if (pax.m_has_link)
+				link = pax.m_link;
+			else if (has_long_link)
+				link = long_link;
+			else
+				link.assign(field_string(block + g_link_offset, g_link_size));
+
+			has_long_name = false;
+			has_long_link = false;
+			pax.m_has_path = false;
+			pax.m_has_link = false;
+			pax.m_has_size = false;
+
+			std::string_view path = strip_leading(name);
+			if (is_skipped || path.empty())
+				continue;
+
+			// A hard link shares the data of the last entry stored under its target before it,
+			// links to directories or to paths outside of the archive are skipped
+			//
+			uint64_t link_offset = 0;
+			uint64_t link_size = 0;
+			if (is_hard_link)
+			{
+				for (; indexed_entries < entries.size(); indexed_entries++)
+				{
+					const tar_entry& it = entries[indexed_entries];
+					entries_by_path.insert_or_assign(paths.substr(it.m_path_offset, it.m_path_size), indexed_entries);
+				}
+
+				auto target_entry = entries_by_path.find(std::string(strip_leading(link)));
+				if (target_entry == entries_by_path.end() || !entries[target_entry->second].m_is_file)
+					continue;
+
+				link_offset = entries[target_entry->second].m_data_offset;
+				link_size = entries[target_entry->second].m_size;
+			}
+
+			// Old archives mark directories by a trailing slash only
+			//
+			if (path.ends_with('/'))
+			{
+				if (is_hard_link)
+					continue;
+
+				is_file = false;
+			}
+
+			if (paths.size() + path.size() + 1 > UINT32_MAX)
+				return static_cast<size_t>(-1);
+
+			tar_entry& entry = entries.emplace_back();
+			entry.m_data_offset = is_hard_link ? link_offset : data_offset;
+			entry.m_size = is_hard_link ? link_size : size;
+			entry.m_path_offset = static_cast<uint32_t>(paths.size());
+			entry.m_is_file = is_file;
+
+			paths += path;
+			if (!is_file && !path.ends_with('/'))
+				paths += '/';
+
+			entry.m_path_size = static_cast<uint32_t>(paths.size() - entry.m_path_offset);
+		}
+
+		return add_entries(target, std::span<const tar_entry>(entries), paths, [&archive](const tar_entry& entry) -> file*
+		{
+			return new source_file(&archive, entry.m_data_offset, entry.m_size);
+		});
+	}
+}
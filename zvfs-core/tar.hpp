@@ -0,0 +1,27 @@
+#pragma once
+#include "vfs.hpp"
+#include "source.hpp"
+#include <cstddef>
+
+namespace zvfs
+{
+	/**
+	* Adds every entry of a tar archive to a vfs
+	* Understands ustar, GNU (long names and links, base-256 sizes) and pax (path, linkpath and size records) archives.
+	* Headers are read from the view of the source if it has one and through large buffered reads otherwise, every
+	* header checksum is verified. Files become zvfs::source_file data referring to their range of the archive, hard
+	* links share the range of the entry they name. Symbolic links, devices, GNU sparse files, volume labels,
+	* multivolume continuations and global pax headers are skipped. The whole archive is validated before the first
+	* node is added, the nodes are then registered through vfs::add_bulk
+	*
+	* @param[in] target		The vfs receiving the entries
+	* @param[in] archive	The archive, every mounted file holds a reference to it
+	*
+	* @returns				If the function succeeded it returns the number of mounted entries.
+	*						Later entries replace earlier ones with the same path, paths that already had data keep it.
+	*						Returns -1 if the archive is damaged, truncated or could not be read, nothing is added then
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the entries could not be allocated. Nodes added up to this point remain valid
+	*/
+	[[nodiscard]] extern size_t mount_tar(vfs& target, source& archive);
+}
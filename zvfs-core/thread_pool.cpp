@@ -0,0 +1,239 @@
+#include "thread_pool.hpp"
+#include <utility>
+
+namespace zvfs
+{
+	namespace
+	{
+		// Lets submit() find the queue of the worker it is called from
+		//
+		thread_local const thread_pool* t_pool = nullptr;
+		thread_local size_t t_queue = 0;
+	}
+
+	/**
+	* Starts the worker threads
+	*
+	* @param[in] thread_count	Number of workers, 0 uses the number of hardware threads
+	*
+	* @exceptsafe strong
+	* @throws std::system_error	Thrown if a thread could not be started
+	*/
+	thread_pool::thread_pool(size_t thread_count)
+		: m_queued(0)
+		, m_pending(0)
+		, m_next_queue(0)
+		, m_stop(false)
+	{
+		if (!thread_count)
+			thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+		for (size_t i = 0; i < thread_count; i++)
+			this->m_queues.push_back(std::make_unique<worker_queue>());
+
+		try
+		{
+			for (size_t i = 0; i < thread_count; i++)
+				this->m_threads.emplace_back(&thread_pool::worker, this, i);
+		}
+		catch (...)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->m_mutex);
+				this->m_stop = true;
+			}
+
+			this->m_wake.notify_all();
+			for (std::thread& it : this->m_threads)
+				it.join();
+
+			throw;
+		}
+	}
+
+	/**
+	* Finishes all queued tasks and joins the worker threads
+	*
+	* @exceptsafe no-throw
+	*/
+	thread_pool::~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			this->m_stop = true;
+		}
+
+		this->m_wake.notify_all();
+		for (std::thread& it : this->m_threads)
+			it.join();
+	}
+
+	/**
+	* Queues a task
+	*
+	* @param[in] task		The task, may submit further tasks itself
+	*
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the task could not be queued
+	*/
+	void thread_pool::submit(std::function<void()> task)
+	{
+		size_t index = t_pool == this ? t_queue : this->m_next_queue++ % this->m_queues.size();
+		worker_queue& queue = *this->m_queues[index];
+
+		// Count the task before it becomes visible, so wait() can't observe zero pending tasks while it runs
+		// and a worker taking it right away can't drive the queued count below zero
+		//
+		this->m_pending++;
+		try
+		{
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			this->m_queued++;
+
+			try
+			{
+				queue.m_tasks.push_back(std::move(task));
+			}
+			catch (...)
+			{
+				this->m_queued--;
+				throw;
+			}
+		}
+		catch (...)
+		{
+			this->m_pending--;
+			throw;
+		}
+
+		// Taking the lock orders the notification after the check of a worker that is about to sleep
+		//
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+		}
+
+		this->m_wake.notify_one();
+	}
+
+	/**
+	* Executes queued tasks on the calling thread until every submitted task has finished
+	* Must not be called from inside a task
+	*
+	* @exceptsafe basic
+	* @throws ...			Rethrows the first exception thrown by a task since the last wait
+	*/
+	void thread_pool::wait()
+	{
+		std::function<void()> task;
+		while (this->take(0, task))
+			this->run(task);
+
+		std::unique_lock<std::mutex> lock(this->m_mutex);
+		this->m_done.wait(lock, [this]()
+		{
+			return this->m_pending == 0;
+		});
+
+		std::exception_ptr error = std::exchange(this->m_error, nullptr);
+		lock.unlock();
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	/**
+	* Retrieves the number of worker threads
+	*
+	* @exceptsafe no-throw
+	*/
+	size_t thread_pool::size() const
+	{
+		return this->m_threads.size();
+	}
+
+	void thread_pool::worker(size_t index)
+	{
+		t_pool = this;
+		t_queue = index;
+
+		std::function<void()> task;
+		for (;;)
+		{
+			if (this->take(index, task))
+			{
+				this->run(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(this->m_mutex);
+			this->m_wake.wait(lock, [this]()
+			{
+				return this->m_stop || this->m_queued > 0;
+			});
+
+			// Shutting down still drains the queues, so no submitted task is lost
+			//
+			if (this->m_stop && this->m_queued == 0)
+				return;
+		}
+	}
+
+	bool thread_pool::take(size_t index, std::function<void()>& out_task)
+	{
+		// Own tasks newest first for locality, stolen tasks oldest first since those tend to be the biggest
+		//
+		{
+			worker_queue& queue = *this->m_queues[index];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+
+			if (!queue.m_tasks.empty())
+			{
+				out_task = std::move(queue.m_tasks.back());
+				queue.m_tasks.pop_back();
+				this->m_queued--;
+				return true;
+			}
+		}
+
+		for (size_t i = 1; i < this->m_queues.size(); i++)
+		{
+			worker_queue& queue = *this->m_queues[(index + i) % this->m_queues.size()];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+
+			if (!queue.m_tasks.empty())
+			{
+				out_task = std::move(queue.m_tasks.front());
+				queue.m_tasks.pop_front();
+				this->m_queued--;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void thread_pool::run(std::function<void()>& task)
+	{
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			if (!this->m_error)
+				this->m_error = std::current_exception();
+		}
+
+		task = nullptr;
+
+		if (--this->m_pending == 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->m_mutex);
+			}
+
+			this->m_done.notify_all();
+		}
+	}
+}
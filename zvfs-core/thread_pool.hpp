@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Fixed size work stealing thread pool
+	*
+	* Every worker owns a task queue. Tasks submitted from inside a worker go to its own queue and are taken
+	* newest first, idle workers steal the oldest tasks of other queues. Tasks submitted from outside the pool
+	* are spread over the queues round robin. The thread calling wait() helps executing tasks until all are done
+	*/
+	class thread_pool
+	{
+	public:
+		/**
+		* Starts the worker threads
+		*
+		* @param[in] thread_count	Number of workers, 0 uses the number of hardware threads
+		*
+		* @exceptsafe strong
+		* @throws std::system_error	Thrown if a thread could not be started
+		*/
+		[[nodiscard]] explicit thread_pool(size_t thread_count = 0);
+
+		/**
+		* Finishes all queued tasks and joins the worker threads
+		*
+		* @exceptsafe no-throw
+		*/
+		~thread_pool();
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		/**
+		* Queues a task
+		*
+		* @param[in] task		The task, may submit further tasks itself
+		*
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the task could not be queued
+		*/
+		void submit(std::function<void()> task);
+
+		/**
+		* Executes queued tasks on the calling thread until every submitted task has finished
+		* Must not be called from inside a task
+		*
+		* @exceptsafe basic
+		* @throws ...			Rethrows the first exception thrown by a task since the last wait
+		*/
+		void wait();
+
+		/**
+		* Splits [0, count) into chunks and processes them in parallel, returns once all chunks are done
+		*
+		* @param[in] count		Number of items
+		* @param[in] function	Callable invoked as function(chunk, first, last) for every chunk,
+		*						chunks are numbered from 0 in item order
+		*
+		* @returns				Number of chunks the items were split into
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if a chunk could not be queued. Chunks queued before have finished by then
+		* @throws ...			Rethrows the first exception thrown by function
+		*/
+		template<typename Function>
+		size_t parallel_for(size_t count, Function&& function)
+		{
+			// A few chunks per worker even out chunks that take longer than others
+			//
+			size_t chunks = std::min(count, this->size() * 4);
+			try
+			{
+				for (size_t chunk = 0; chunk < chunks; chunk++)
+				{
+					size_t first = count * chunk / chunks;
+					size_t last = count * (chunk + 1) / chunks;
+
+					this->submit([&function, chunk, first, last]()
+					{
+						function(chunk, first, last);
+					});
+				}
+			}
+			catch (...)
+			{
+				// Queued chunks refer to function, they have to finish before the caller's frame goes away.
+				// Their own exceptions are dropped in favor of the one that stopped the loop
+				//
+				try
+				{
+					this->wait();
+				}
+				catch (...)
+				{
+				}
+
+				throw;
+			}
+
+			this->wait();
+			return chunks;
+		}
+
+		/**
+		* Retrieves the number of worker threads
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] size_t size() const;
+
+	private:
+		struct worker_queue
+		{
+			std::mutex m_mutex;
+			std::deque<std::function<void()>> m_tasks;
+		};
+
+		void worker(size_t index);
+		[[nodiscard]] bool take(size_t index, std::function<void()>& out_task);
+		void run(std::function<void()>& task);
+
+	private:
+		std::vector<std::unique_ptr<worker_queue>> m_queues;
+		std::vector<std::thread> m_threads;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		std::atomic<size_t> m_queued;
+		std::atomic<size_t> m_pending;
+		std::atomic<size_t> m_next_queue;
+		std::exception_ptr m_error;
+		bool m_stop;
+	};
+}
@@ -0,0 +1,182 @@
+#include "trigram_index.hpp"
+#include <algorithm>
+
+namespace zvfs
+{
+	namespace
+	{
+		// Rebuilding is only worth it once a good share of all ids are dead
+		//
+		constexpr size_t g_min_compaction_removals = 4096;
+
+		inline uint32_t fold(char c)
+		{
+			unsigned char value = static_cast<unsigned char>(c);
+			if (value >= 'A' && value <= 'Z')
+				value += 'a' - 'A';
+
+			return value;
+		}
+	}
+
+	/**
+	* Creates an empty index
+	*
+	* @param[in] resource	Memory resource used for the posting lists
+	*
+	* @exceptsafe no-throw
+	*/
+	trigram_index::trigram_index(std::pmr::memory_resource* resource)
+		: m_postings(resource)
+		, m_nodes(resource)
+		, m_removed(0)
+	{
+	}
+
+	/**
+	* Registers a node under all trigrams of its path
+	*
+	* @param[in] entry		The node to register
+	* @param[in] path		The full path of the node
+	*
+	* @returns				The id assigned to the node, required to erase it again
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if a posting list could not grow
+	*/
+	uint32_t trigram_index::insert(node* entry, std::string_view path)
+	{
+		uint32_t id = static_cast<uint32_t>(this->m_nodes.size());
+		this->m_nodes.push_back(entry);
+
+		// Ids only ever grow, appending keeps every posting list sorted
+		//
+		std::vector<uint32_t> trigrams;
+		collect_trigrams(path, trigrams);
+
+		for (uint32_t trigram : trigrams)
+		{
+			auto& postings = this->m_postings.try_emplace(trigram).first->second;
+			postings.push_back(id);
+		}
+
+		return id;
+	}
+
+	/**
+	* Unregisters a node
+	*
+	* @param[in] id			The id returned by insert
+	*
+	* @exceptsafe no-throw
+	*/
+	void trigram_index::erase(uint32_t id)
+	{
+		if (id >= this->m_nodes.size() || !this->m_nodes[id])
+			return;
+
+		this->m_nodes[id] = nullptr;
+		this->m_removed++;
+	}
+
+	/**
+	* Collects the nodes whose path might contain a substring
+	*
+	* @param[in] filter		The substring, has to be at least three characters long
+	* @param[out] out_nodes	Receives the candidates, existing content is kept
+	*
+	* @returns				Returns false if the filter is too short to use the index
+	* @exceptsafe basic
+	*/
+	bool trigram_index::candidates(std::string_view filter, std::vector<node*>& out_nodes) const
+	{
+		if (filter.size() < 3)
+			return false;
+
+		std::vector<uint32_t> trigrams;
+		collect_trigrams(filter, trigrams);
+
+		// A trigram without postings rules out every node
+		//
+		std::vector<const std::pmr::vector<uint32_t>*> lists;
+		for (uint32_t trigram : trigrams)
+		{
+			auto postings = this->m_postings.find(trigram);
+			if (postings == this->m_postings.end())
+				return true;
+
+			lists.push_back(&postings->second);
+		}
+
+		// Intersect starting with the rarest trigram, the candidate set only shrinks from there
+		//
+		std::sort(lists.begin(), lists.end(), [](auto lhs, auto rhs)
+		{
+			return lhs->size() < rhs->size();
+		});
+
+		std::vector<uint32_t> result(lists[0]->begin(), lists[0]->end());
+		for (size_t i = 1; i < lists.size() && !result.empty(); i++)
+		{
+			auto cursor = lists[i]->begin();
+			size_t kept = 0;
+
+			for (uint32_t id : result)
+			{
+				cursor = std::lower_bound(cursor, lists[i]->end(), id);
+				if (cursor == lists[i]->end())
+					break;
+
+				if (*cursor == id)
+					result[kept++] = id;
+			}
+
+			result.resize(kept);
+		}
+
+		for (uint32_t id : result)
+		{
+			if (node* entry = this->m_nodes[id])
+				out_nodes.push_back(entry);
+		}
+
+		return true;
+	}
+
+	/**
+	* Checks if enough nodes were removed that the index should be rebuilt
+	*
+	* @exceptsafe no-throw
+	*/
+	bool trigram_index::needs_compaction() const
+	{
+		return this->m_removed >= g_min_compaction_removals && this->m_removed * 2 > this->m_nodes.size();
+	}
+
+	/**
+	* Removes all nodes and posting lists
+	*
+	* @exceptsafe no-throw
+	*/
+	void trigram_index::clear()
+	{
+		// Clearing alone keeps the bucket array, swap it out so nothing points into the resource afterwards
+		//
+		decltype(this->m_postings)(this->m_postings.get_allocator()).swap(this->m_postings);
+		decltype(this->m_nodes)(this->m_nodes.get_allocator()).swap(this->m_nodes);
+		this->m_removed = 0;
+	}
+
+	void trigram_index::collect_trigrams(std::string_view text, std::vector<uint32_t>& out_trigrams)
+	{
+		out_trigrams.clear();
+		if (text.size() < 3)
+			return;
+
+		out_trigrams.reserve(text.size() - 2);
+		for (size_t i = 0; i + 3 <= text.size(); i++)
+			out_trigrams.push_back((fold(text[i]) << 16) | (fold(text[i + 1]) << 8) | fold(text[i + 2]));
+
+		std::sort(out_trigrams.begin(), out_trigrams.end());
+		out_trigrams.erase(std::unique(out_trigrams.begin(), out_trigrams.end()), out_trigrams.end());
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "node.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace zvfs
+{
+	/**
+	* Trigram posting lists over node paths
+	*
+	* Every node gets an increasing id and is appended to the posting list of each distinct
+	* case folded trigram of its path, so all lists stay sorted. A substring query intersects the
+	* lists of its trigrams and returns candidates that still have to be verified by the caller.
+	* Removed nodes only clear their id slot, their stale list entries are dropped by compaction
+	*/
+	class trigram_index
+	{
+	public:
+		/**
+		* Creates an empty index
+		*
+		* @param[in] resource	Memory resource used for the posting lists
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] trigram_index(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		trigram_index(const trigram_index&) = delete;
+		trigram_index& operator=(const trigram_index&) = delete;
+
+		/**
+		* Registers a node under all trigrams of its path
+		*
+		* @param[in] entry		The node to register
+		* @param[in] path		The full path of the node
+		*
+		* @returns				The id assigned to the node, required to erase it again
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if a posting list could not grow
+		*/
+		[[nodiscard]] uint32_t insert(node* entry, std::string_view path);
+
+		/**
+		* Unregisters a node
+		*
+		* @param[in] id			The id returned by insert
+		*
+		* @exceptsafe no-throw
+		*/
+		void erase(uint32_t id);
+
+		/**
+		* Collects the nodes whose path might contain a substring
+		*
+		* @param[in] filter		The substring, has to be at least three characters long
+		* @param[out] out_nodes	Receives the candidates, existing content is kept
+		*
+		* @returns				Returns false if the filter is too short to use the index
+		* @exceptsafe basic
+		*/
+		[[nodiscard]] bool candidates(std::string_view filter, std::vector<node*>& out_nodes) const;
+
+		/**
+		* Checks if enough nodes were removed that the index should be rebuilt
+		*
+		* @exceptsafe no-throw
+		*/
+		[[nodiscard]] bool needs_compaction() const;
+
+		/**
+		* Removes all nodes and posting lists
+		*
+		* @exceptsafe no-throw
+		*/
+		void clear();
+
+	private:
+		static void collect_trigrams(std::string_view text, std::vector<uint32_t>& out_trigrams);
+
+	private:
+		std::pmr::unordered_map<uint32_t, std::pmr::vector<uint32_t>> m_postings;
+		std::pmr::vector<node*> m_nodes;
+		size_t m_removed;
+	};
+}
@@ -1,35 +1,135 @@
 #include "vfs.hpp"
 #include "path.hpp"
+#include "hash.hpp"
+#include "tar.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 namespace zvfs
 {
+	namespace
+	{
+		// Concurrent adds spread over this many independently locked index shards
+		//
+		constexpr size_t g_index_shards = 64;
+
+		// Layout of files written by vfs::save: header, records in breadth first order, names, payload descriptors
+		// Multi byte values are stored in host byte order, the header checksum covers everything after the header
+		//
+		constexpr uint32_t g_saved_magic = 0x5346565A;
+		constexpr uint32_t g_saved_version = 2;
+		constexpr uint32_t g_saved_fold_case = 1;
+		constexpr uint32_t g_saved_ascii_only = 2;
+		constexpr uint32_t g_no_parent = 0xFFFFFFFFu;
+
+		struct saved_header
+		{
+			uint32_t m_magic;
+			uint32_t m_version;
+			uint32_t m_flags;
+			uint32_t m_reserved;
+			uint64_t m_node_count;
+			uint64_t m_names_size;
+			uint64_t m_payload_size;
+			uint64_t m_checksum;
+		};
+
+		struct saved_record
+		{
+			uint64_t m_hash;
+			uint32_t m_parent;
+			uint32_t m_name_offset;
+			uint32_t m_name_size;
+			uint32_t m_payload_size;
+			uint64_t m_payload_offset;
+		};
+
+		// Not a cryptographic digest, it catches truncated, torn or bit flipped files before anything is linked
+		//
+		uint64_t saved_checksum(const std::vector<saved_record>& records, const std::vector<char>& names, const std::vector<std::byte>& payload)
+		{
+			path_hasher hasher(false, false, g_saved_magic);
+			hasher.update(std::string_view(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(saved_record)));
+			hasher.update(std::string_view(names.data(), names.size()));
+			hasher.update(std::string_view(reinterpret_cast<const char*>(payload.data()), payload.size()));
+			return hasher.digest();
+		}
+	}
+
 	/**
 	* File reader implementation
 	*
 	* @param[in] settings	You can either create your own zvfs::vfs_settings object or pass
 	*						a default one from zvfs::settings
+	* @param[in] resource	Upstream memory resource for all internal allocations (nodes, directories, paths, index)
+	*						The vfs keeps its own pool on top of it, so memory is only returned on removal or destruction
 	* @exceptsafe no-throw
 	*/
-	vfs::vfs(vfs_settings& settings)
-		: m_hasher()
+	vfs::vfs(vfs_settings& settings, std::pmr::memory_resource* resource)
+		: m_pool(resource)
+		, m_shared_pool(resource)
+		, m_resource(settings.m_thread_safe ? static_cast<std::pmr::memory_resource*>(&m_shared_pool) : &m_pool)
+		, m_epochs()
+		, m_names(m_resource)
+		, m_nodes(settings.m_thread_safe ? g_index_shards : 1, settings.m_thread_safe, m_resource)
+		, m_prefix_index(settings.m_lowercase_filesystem, m_resource)
+		, m_substring_index(m_resource)
 		, m_settings(settings)
 	{
+		// Lock-free lookups may still probe replaced slot arrays
+		//
+		if (this->m_settings.m_thread_safe)
+			this->m_nodes.set_epoch_domain(&this->m_epochs);
+
 		std::string_view empty_view;
-		this->m_root_node = new node(false, true, m_hasher(""), empty_view);
-		this->m_nodes.insert({ m_hasher(""), this->m_root_node });
+		this->m_root_node = this->create_node(false, true, this->hash_entry(empty_view), empty_view);
+		this->m_nodes.insert(this->m_root_node);
+
+		if (this->m_settings.m_prefix_index)
+			this->m_prefix_index.insert(empty_view, this->m_root_node);
+
+		if (this->m_settings.m_substring_index)
+			this->m_root_node->m_search_id = this->m_substring_index.insert(this->m_root_node, empty_view);
 		this->m_initialized = true;
 	}
 
 	/**
 	* Performs a full cleanup on all linked nodes
 	* Will invoke destructors of user defined zvfs::file overloads
+	* Internal memory is released in bulk without visiting the hierarchy
 	*
 	* @exceptsafe no-throw
 	*/
 	vfs::~vfs()
 	{
-		this->remove_node(this->m_root_node, true);
+		// Removed nodes may still wait for readers, nobody can be reading anymore
+		//
+		this->m_epochs.flush();
+
+		// Only node data owned by the user needs to be destroyed one by one
+		// Nodes, directories created by the vfs and their containers all live in the pool
+		//
+		this->m_nodes.for_each([](node* it)
+		{
+			if (it->m_is_file)
+				delete it->m_file;
+			else if (!it->m_owns_dir)
+				delete it->m_dir;
+		});
+
+		this->m_nodes.clear();
+		this->m_prefix_index.abandon();
+		this->m_substring_index.clear();
+		this->m_names.clear();
+		this->m_pool.release();
+		this->m_shared_pool.release();
 		this->m_root_node = nullptr;
 
 		this->m_initialized = false;
@@ -37,6 +137,8 @@ namespace zvfs
 
 	/**
 	* Adds a new node to the vfs. Expects complete paths
+	* Threads may add to a thread safe vfs at the same time, they only wait for each other
+	* while creating children of the same directory
 	*
 	* @param[in] path		Complete path to the added node
 	*						Example: folder1/folder2/file.png
@@ -52,11 +154,17 @@ namespace zvfs
 		if (!this->m_initialized)
 			return nullptr;
 
+		// Adds only exclude removals, concurrent adds synchronize on the index shards and parent directories
+		//
+		std::shared_lock<std::shared_mutex> lock = this->lock_shared();
+
 		node* entry = add_node(path);
+		this->reclaim();
+
 		if (!entry)
 			return nullptr;
 
-		return entry->m_is_file ? reinterpret_cast<node_data**>(&entry->m_file) : reinterpret_cast<node_data**>(&entry->m_dir);
+		return this->data_slot(entry);
 	}
 
 	/**
@@ -65,134 +173,1020 @@ namespace zvfs
 	* @overload
 	*/
 	node_data** vfs::add(std::string& path)
+	{
+		return this->add(std::string_view(path));
+	}
+
+	/**
+	* Adds a batch of nodes to the vfs in one pass. Expects complete paths
+	* Reserves the index up front, sorts the batch and creates every intermediate directory exactly once
+	* Batches of different threads are added to a thread safe vfs in parallel, like add()
+	*
+	* @param[in] paths		Complete paths to the added nodes in any order, duplicates are allowed
+	*						Example: { "folder1/folder2/file.png", "folder1/file.txt" }
+	* @param[out] out_slots	Receives one entry per input path in input order, the same zvfs::node_data pointer
+	*						that add() would have returned for that path. Invalid paths receive a nullptr
+	*
+	* @returns				If the function succeeded it returns the number of valid input paths
+	*						Returns -1 if the vfs couldn't be modified
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the nodes could not be allocated. Nodes added up to this point remain valid
+	*/
+	size_t vfs::add_bulk(std::span<const std::string_view> paths, std::vector<node_data**>& out_slots)
 	{
 		if (!this->m_initialized)
-			return nullptr;
+			return static_cast<size_t>(-1);
 
-		node* entry = add_node(path);
+		out_slots.assign(paths.size(), nullptr);
+
+		std::shared_lock<std::shared_mutex> lock = this->lock_shared();
+
+		bool ignore_case = this->m_settings.m_lowercase_filesystem;
+		bool ascii_only = this->m_settings.m_ansi_paths;
+
+		// Drop invalid paths before sorting, they never get a slot
+		//
+		std::vector<uint32_t> order;
+		order.reserve(paths.size());
+		for (uint32_t i = 0; i < paths.size(); i++)
+		{
+			if (path_hasher(false, ascii_only).update(paths[i]).valid())
+				order.push_back(i);
+		}
+
+		// Sorting groups every directory with its contents and puts each directory right before its children
+		// Equal paths end up next to each other and are resolved once
+		//
+		std::sort(order.begin(), order.end(), [&paths, ignore_case](uint32_t lhs, uint32_t rhs)
+		{
+			return path::compare(paths[lhs], paths[rhs], ignore_case) < 0;
+		});
+
+		this->m_nodes.reserve(this->m_nodes.size() + order.size());
+
+		// The chain holds every directory of the previous path together with the hasher state at its end,
+		// so components shared with the previous path are neither looked up nor hashed again
+		//
+		struct chain_entry
+		{
+			node* m_node;
+			size_t m_length;
+			path_hasher m_hasher;
+		};
+
+		std::vector<chain_entry> chain;
+		chain.push_back({ this->m_root_node, 0, path_hasher(ignore_case, ascii_only) });
+
+		std::string_view previous_path;
+		node* previous_node = nullptr;
+
+		for (uint32_t index : order)
+		{
+			std::string_view current_path = paths[index];
+
+			if (previous_node && path::equals(previous_path, current_path, ignore_case))
+			{
+				out_slots[index] = this->data_slot(previous_node);
+				continue;
+			}
+
+			// Unwind to the deepest directory that is also a prefix of this path
+			//
+			while (chain.size() > 1)
+			{
+				size_t length = chain.back().m_length;
+				if (length <= current_path.size() && path::equals(previous_path.substr(0, length), current_path.substr(0, length), ignore_case))
+					break;
+
+				chain.pop_back();
+			}
+
+			node* entry = chain.back().m_node;
+			size_t offset = chain.back().m_length;
+
+			while (offset < current_path.size())
+			{
+				size_t separator = current_path.find('/', offset);
+				size_t end = separator == std::string_view::npos ? current_path.size() : separator + 1;
+				bool is_file = separator == std::string_view::npos;
+
+				std::string_view name = current_path.substr(offset, end - offset);
+				path_hasher hasher = chain.back().m_hasher;
+				size_t hash = hasher.update(name).digest();
+
+				node* parent = entry;
+				entry = this->get_node(hash, current_path.substr(0, end));
+				if (!entry)
+					entry = this->link_node(parent, current_path.substr(0, end), hash, is_file);
+
+				if (!is_file)
+					chain.push_back({ entry, end, hasher });
+
+				offset = end;
+			}
+
+			out_slots[index] = this->data_slot(entry);
+			previous_path = current_path;
+			previous_node = entry;
+		}
+
+		this->reclaim();
+		return order.size();
+	}
+
+	/**
+	* Mounts several archives in parallel and merges them into this vfs
+	* Every archive is indexed into a private staging tree by one worker, the staging trees are then merged
+	* in one vfs::add_bulk pass on the calling thread. The result does not depend on the thread count:
+	* when several archives contain the same file the one listed last wins, files that already had data keep it
+	*
+	* @param[in] sources		The archives in mount order, every mounted file holds a reference to its archive
+	* @param[in] thread_count	Number of workers, 0 uses the number of hardware threads
+	* @param[in] mounter		Invoked as mounter(staging, archive) to index one archive, zvfs::mount_tar if empty.
+	*						Has to return -1 if the archive could not be indexed
+	*
+	* @returns				If the function succeeded it returns the number of merged nodes, intermediate directories included.
+	*						Returns -1 if the vfs couldn't be modified or any archive failed to mount, nothing is added then
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the staging trees or the merged nodes could not be allocated
+	* @throws std::system_error	Thrown if a worker thread could not be started
+	* @throws ...			Rethrows the first exception thrown by mounter
+	*/
+	size_t vfs::mount_many(std::span<source* const> sources, size_t thread_count, const mount_function& mounter)
+	{
+		if (!this->m_initialized)
+			return static_cast<size_t>(-1);
+
+		if (sources.empty())
+			return 0;
+
+		// Staging trees are private to one worker and only need the hash index
+		//
+		vfs_settings staging_settings(this->m_settings.m_lowercase_filesystem, this->m_settings.m_ansi_paths, this->m_settings.m_max_path);
+
+		std::vector<std::unique_ptr<vfs>> staging(sources.size());
+		std::vector<size_t> results(sources.size(), static_cast<size_t>(-1));
+
+		size_t worker_count = thread_count ? thread_count : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		{
+			thread_pool pool(std::min(worker_count, sources.size()));
+			pool.parallel_for(sources.size(), [&](size_t, size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					staging[i] = std::make_unique<vfs>(staging_settings);
+					results[i] = mounter ? mounter(*staging[i], *sources[i]) : mount_tar(*staging[i], *sources[i]);
+				}
+			});
+		}
+
+		if (std::find(results.begin(), results.end(), static_cast<size_t>(-1)) != results.end())
+			return static_cast<size_t>(-1);
+
+		// Staged nodes are collected archive by archive, so equal paths appear in mount order
+		//
+		std::vector<node*> staged;
+		size_t paths_size = 0;
+		for (const std::unique_ptr<vfs>& it : staging)
+		{
+			it->m_nodes.for_each([&staged, &paths_size](node* entry)
+			{
+				if (entry->m_is_root)
+					return;
+
+				staged.push_back(entry);
+				paths_size += entry->m_path_size;
+			});
+		}
+
+		std::string paths(paths_size, '\0');
+		std::vector<std::string_view> views(staged.size());
+
+		size_t offset = 0;
+		for (size_t i = 0; i < staged.size(); i++)
+		{
+			staged[i]->write_path(paths.data() + offset);
+			views[i] = std::string_view(paths.data() + offset, staged[i]->m_path_size);
+			offset += staged[i]->m_path_size;
+		}
+
+		std::vector<node_data**> slots;
+		size_t added = this->add_bulk(views, slots);
+		if (added == static_cast<size_t>(-1))
+			return added;
+
+		// Walking backwards hands each path the data of its last archive, the staging trees free everything left over
+		//
+		for (size_t i = staged.size(); i-- > 0;)
+		{
+			node* entry = staged[i];
+			if (!entry->m_is_file || !entry->m_file || !slots[i] || *slots[i])
+				continue;
+
+			*slots[i] = entry->m_file;
+			entry->m_file = nullptr;
+		}
+
+		return added;
+	}
+
+	/**
+	* Removes a node from the vfs. Expects complete paths
+	*
+	* @param[in] path		Complete path to the node
+	*						Example: folder1/folder2/file.png
+	* 
+	* @param[in] recursive	Deletes multiple levels of sub-folders
+	*						including any file present in those
+	*
+	*						Warning: The function will fail if specified with a path to a file
+	* 
+	* @returns				Returns true on successfull deletion
+	*
+	* @exceptsafe basic
+	* @throws std::runtime_exception	Thrown if deletion corrupted the file hierachy or
+	*									was unable to delete all nodes comletely
+	*/
+	bool vfs::remove(std::string_view path, bool recursive)
+	{
+		if (!this->m_initialized)
+			return false;
+
+		std::unique_lock<std::shared_mutex> lock = this->lock_exclusive();
+
+		node* entry = this->find_node(path);
 		if (!entry)
+			return false;
+
+		bool removed = this->remove_node(entry, recursive);
+		this->reclaim();
+
+		return removed;
+	}
+
+	/**
+	* Removes a node from the vfs. Expects complete paths
+	*
+	* @overload
+	*/
+	bool vfs::remove(std::string& path, bool recursive)
+	{
+		return this->remove(std::string_view(path), recursive);
+	}
+
+	/**
+	* Retrieves a node from the vfs. Expects complete paths
+	* A thread safe vfs answers without taking a lock. Hold a guard from pin() to keep using
+	* the node while other threads may remove it
+	*
+	* @param[in] path		Complete path to the node
+	*						Example: folder1/folder2/file.png
+	* 
+	* @returns				If the function succeeded it returns a pointer to the requested zvfs::node
+	*						Returns a nullptr if node could not be found
+	* @exceptsafe no-throw
+	*/
+	node* vfs::get(std::string_view path)
+	{
+		if (!this->m_initialized)
 			return nullptr;
 
-		return entry->m_is_file ? reinterpret_cast<node_data**>(&entry->m_file) : reinterpret_cast<node_data**>(&entry->m_dir);
+		// Lookups of a thread safe vfs don't lock, the index lookup pins the epoch itself
+		//
+		return this->find_node(path);
+	}
+
+	/**
+	* Retrieves a node from the vfs. Expects complete paths
+	*
+	* @overload
+	*/
+	node* vfs::get(std::string& path)
+	{
+		return this->get(std::string_view(path));
+	}
+
+	/**
+	* Retrieves a list of nodes matching a query string on the path
+	* The query ignores case if the vfs runs in lowercase mode
+	* If zvfs::vfs_settings::m_substring_index is set, filters of three or more characters
+	* only verify the nodes that contain all trigrams of the filter instead of scanning every node
+	*
+	* @param[in] filter		Substring of the node path
+	*						Example: ".txt", "file.extension" or "folder1/file.png"
+	*
+	* @returns				If the function succeeded it returns the number of found nodes matching the query
+	*						Returns -1 if the vfs couldn't be searched
+	* @exceptsafe no-throw
+	*/
+	size_t vfs::find(std::string_view filter, std::vector<node*>& out_nodes)
+	{
+		if (!this->m_initialized)
+			return static_cast<size_t>(-1);
+
+		// We want to provide a clear indication if a file was found at all
+		//
+		out_nodes.clear();
+
+		for (node* it : this->matches(filter))
+			out_nodes.push_back(it);
+
+		return out_nodes.size();
+	}
+
+	/**
+	* Retrieves a list of nodes matching a query string on the path
+	*
+	* @overload
+	*/
+	size_t vfs::find(std::string& filter, std::vector<node*>& out_nodes)
+	{
+		// Implicitly convert std::string& to std::string_view via const char* argument
+		//
+		return this->find(filter.c_str(), out_nodes);
+	}
+
+	/**
+	* Retrieves a list of nodes matching a query string on the path, scanning on a thread pool
+	* Every worker checks the nodes of a contiguous range of index slots and the partial results
+	* are concatenated in slot order. Filters the trigram index can answer are not scanned at all
+	* A thread safe vfs is scanned shard by shard, nodes added meanwhile may or may not be reported
+	*
+	* @param[in] filter		Substring of the node path
+	*						Example: ".txt", "file.extension" or "folder1/file.png"
+	* @param[out] out_nodes	Receives the matching nodes
+	* @param[in] pool		The thread pool executing the scan, must not be busy with other work
+	* @param[in] sorted		Sort the results by path, otherwise their order is unspecified
+	*
+	* @returns				If the function succeeded it returns the number of found nodes matching the query
+	*						Returns -1 if the vfs couldn't be searched
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the results could not be collected
+	*/
+	size_t vfs::find(std::string_view filter, std::vector<node*>& out_nodes, thread_pool& pool, bool sorted)
+	{
+		if (!this->m_initialized)
+			return static_cast<size_t>(-1);
+
+		out_nodes.clear();
+
+		bool ignore_case = this->m_settings.m_lowercase_filesystem;
+
+		if (this->m_settings.m_substring_index && filter.size() >= 3)
+		{
+			// The range takes the read lock itself
+			//
+			for (node* it : this->matches(filter))
+				out_nodes.push_back(it);
+		}
+		else
+		{
+			std::shared_lock<std::shared_mutex> lock = this->lock_shared();
+
+			// Chunks only read the index and the parent chains, each one collects into its own vector
+			//
+			std::vector<std::vector<node*>> partial_results(pool.size() * 4);
+
+			size_t chunks = pool.parallel_for(this->m_nodes.partitions(), [&](size_t chunk, size_t first, size_t last)
+			{
+				std::vector<node*>& matches = partial_results[chunk];
+				std::string path_buffer;
+
+				this->m_nodes.visit(first, last, [&](node* it)
+				{
+					this->build_path(it, path_buffer);
+					if (path::contains(path_buffer, filter, ignore_case))
+						matches.push_back(it);
+				});
+			});
+
+			size_t count = 0;
+			for (size_t i = 0; i < chunks; i++)
+				count += partial_results[i].size();
+
+			out_nodes.reserve(count);
+			for (size_t i = 0; i < chunks; i++)
+				out_nodes.insert(out_nodes.end(), partial_results[i].begin(), partial_results[i].end());
+		}
+
+		if (sorted)
+		{
+			std::vector<std::pair<std::string, node*>> entries(out_nodes.size());
+			for (size_t i = 0; i < out_nodes.size(); i++)
+			{
+				this->build_path(out_nodes[i], entries[i].first);
+				entries[i].second = out_nodes[i];
+			}
+
+			std::sort(entries.begin(), entries.end(), [ignore_case](const auto& lhs, const auto& rhs)
+			{
+				return path::compare(lhs.first, rhs.first, ignore_case) < 0;
+			});
+
+			for (size_t i = 0; i < entries.size(); i++)
+				out_nodes[i] = entries[i].second;
+		}
+
+		return out_nodes.size();
+	}
+
+	/**
+	* Calls a function for every node matching a query string on the path, without collecting the results
+	* The query ignores case if the vfs runs in lowercase mode and uses the trigram index like find()
+	*
+	* @param[in] filter		Substring of the node path
+	*						Example: ".txt", "file.extension" or "folder1/file.png"
+	* @param[in] callback	Invoked with every matching node, returning false stops the search
+	*						A thread safe vfs is read locked meanwhile, the callback must not add or remove nodes.
+	*						Doing so on the calling thread deadlocks, collect the nodes and modify the vfs afterwards
+	*
+	* @returns				If the function succeeded it returns the number of nodes passed to callback
+	*						Returns -1 if the vfs couldn't be searched
+	* @exceptsafe basic
+	*/
+	size_t vfs::for_each_match(std::string_view filter, const std::function<bool(node*)>& callback)
+	{
+		if (!this->m_initialized)
+			return static_cast<size_t>(-1);
+
+		size_t count = 0;
+		for (node* it : this->matches(filter))
+		{
+			count++;
+			if (!callback(it))
+				break;
+		}
+
+		return count;
+	}
+
+	/**
+	* Creates a lazy search for nodes matching a query string on the path
+	* Nothing is searched until the range is iterated, each step only searches up to the next match
+	* The query ignores case if the vfs runs in lowercase mode and uses the trigram index like find()
+	*
+	* @param[in] filter		Substring of the node path, copied into the range
+	*						Example: ".txt", "file.extension" or "folder1/file.png"
+	*
+	* @returns				A single pass range over the matching nodes, empty if the vfs couldn't be searched.
+	*						A thread safe vfs stays read locked until the range is destroyed, adding or removing nodes
+	*						on the same thread meanwhile deadlocks
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the search state could not be allocated
+	*/
+	match_range vfs::matches(std::string_view filter)
+	{
+		match_range range(filter, this->m_settings.m_lowercase_filesystem);
+		if (!this->m_initialized)
+			return range;
+
+		range.m_lock = this->lock_shared();
+
+		if (this->m_settings.m_thread_safe)
+			range.m_dir_locks = &this->m_dir_locks;
+
+		bool indexed = false;
+		if (this->m_settings.m_substring_index)
+		{
+			std::shared_lock<std::shared_mutex> index_lock = this->lock_shared(this->m_search_index_mutex);
+			indexed = this->m_substring_index.candidates(filter, range.m_candidates);
+		}
+
+		if (indexed)
+			range.m_use_candidates = true;
+		else
+			range.m_pending.push_back(this->m_root_node);
+
+		return range;
+	}
+
+	/**
+	* Retrieves all nodes whose path starts with a prefix, in lexicographic path order
+	* Uses the radix tree if zvfs::vfs_settings::m_prefix_index is set, otherwise it only visits
+	* the directory containing the prefix and the matching subtrees
+	*
+	* @param[in] prefix		Start of the node path, does not have to end on a component boundary
+	*						Example: "textures/ui/" or "textures/ui/button_"
+	* @param[out] out_nodes	Receives the matching nodes
+	*
+	* @returns				If the function succeeded it returns the number of found nodes matching the prefix
+	*						Returns -1 if the vfs couldn't be searched
+	* @exceptsafe basic
+	*/
+	size_t vfs::list_prefix(std::string_view prefix, std::vector<node*>& out_nodes)
+	{
+		if (!this->m_initialized)
+			return static_cast<size_t>(-1);
+
+		out_nodes.clear();
+
+		std::shared_lock<std::shared_mutex> lock = this->lock_shared();
+
+		if (this->m_settings.m_prefix_index)
+		{
+			std::shared_lock<std::shared_mutex> index_lock = this->lock_shared(this->m_search_index_mutex);
+			return this->m_prefix_index.find_prefix(prefix, out_nodes);
+		}
+
+		// Without the radix tree, resolve the directory part of the prefix through the hash index
+		// and only walk the children that start with the remaining partial name
+		//
+		auto [directory_path, partial_name] = path::split_path(prefix);
+		if (!partial_name.empty() && partial_name.back() == '/')
+		{
+			directory_path = prefix;
+			partial_name = {};
+		}
+
+		node* directory = this->find_node(directory_path);
+		if (!directory || directory->m_is_file)
+			return 0;
+
+		bool ignore_case = this->m_settings.m_lowercase_filesystem;
+		auto name_less = [ignore_case](node* lhs, node* rhs)
+		{
+			return path::compare(lhs->name(), rhs->name(), ignore_case) < 0;
+		};
+
+		// Visiting children sorted by name in pre-order yields lexicographic path order,
+		// every directory name ends in a slash so its subtree sorts exactly where the name does
+		//
+		std::vector<node*> pending;
+		if (partial_name.empty())
+		{
+			pending.push_back(directory);
+		}
+		else
+		{
+			std::shared_lock<std::shared_mutex> dir_lock = this->lock_shared(this->m_dir_locks.get(directory));
+			if (directory->m_dir)
+			{
+				for (node* it : *directory->m_dir)
+				{
+					if (it->name().size() >= partial_name.size() && path::equals(it->name().substr(0, partial_name.size()), partial_name, ignore_case))
+						pending.push_back(it);
+				}
+
+				std::sort(pending.begin(), pending.end(), [&name_less](node* lhs, node* rhs) { return name_less(rhs, lhs); });
+			}
+		}
+
+		while (!pending.empty())
+		{
+			node* current = pending.back();
+			pending.pop_back();
+
+			out_nodes.push_back(current);
+
+			if (current->m_is_file)
+				continue;
+
+			// Concurrent adds may be creating children of this directory right now
+			//
+			std::shared_lock<std::shared_mutex> dir_lock = this->lock_shared(this->m_dir_locks.get(current));
+			if (!current->m_dir)
+				continue;
+
+			size_t children_begin = pending.size();
+			pending.insert(pending.end(), current->m_dir->begin(), current->m_dir->end());
+			std::sort(pending.begin() + children_begin, pending.end(), [&name_less](node* lhs, node* rhs) { return name_less(rhs, lhs); });
+		}
+
+		return out_nodes.size();
+	}
+
+	/**
+	* Retrieves all nodes whose path matches a glob pattern, see zvfs::glob_pattern for the syntax
+	* The pattern ignores case if the vfs runs in lowercase mode
+	*
+	* @param[in] pattern	The glob pattern
+	*						Example: "textures/lod?/rock_*.{png,dds}"
+	* @param[out] out_nodes	Receives the matching nodes in no particular order
+	*
+	* @returns				If the function succeeded it returns the number of found nodes matching the pattern
+	*						Returns -1 if the vfs couldn't be searched or the pattern is invalid
+	* @exceptsafe basic
+	*/
+	size_t vfs::glob(std::string_view pattern, std::vector<node*>& out_nodes)
+	{
+		return this->glob(glob_pattern(pattern, this->m_settings.m_lowercase_filesystem), out_nodes);
+	}
+
+	/**
+	* Retrieves all nodes whose path matches a precompiled glob pattern
+	* Only walks directories some part of the pattern can still match and resolves
+	* literal components through the child lookup of each directory instead of scanning it
+	*
+	* @overload
+	*/
+	size_t vfs::glob(const glob_pattern& pattern, std::vector<node*>& out_nodes)
+	{
+		if (!this->m_initialized || !pattern.valid())
+			return static_cast<size_t>(-1);
+
+		out_nodes.clear();
+
+		std::shared_lock<std::shared_mutex> lock = this->lock_shared();
+
+		using state = glob_pattern::state;
+
+		// Pending directories reference their match states in a shared stack, entries are
+		// popped in reverse push order so the states of a popped entry are always on top
+		//
+		struct pending_dir
+		{
+			node* m_node;
+			size_t m_first_state;
+		};
+
+		std::vector<pending_dir> pending = { { this->m_root_node, 0 } };
+		std::vector<state> state_stack;
+		std::vector<state> current_states;
+		std::vector<state> child_states;
+		std::vector<node*> candidates;
+
+		pattern.initial_states(state_stack);
+
+		// Directory lookups fold case the way the vfs does, so they can only stand in for the pattern if both agree
+		//
+		bool lookup_children = pattern.ignore_case() == this->m_settings.m_lowercase_filesystem;
+		std::string child_name;
+
+		while (!pending.empty())
+		{
+			pending_dir entry = pending.back();
+			pending.pop_back();
+
+			current_states.assign(state_stack.begin() + entry.m_first_state, state_stack.end());
+			state_stack.resize(entry.m_first_state);
+
+			std::shared_lock<std::shared_mutex> dir_lock = this->lock_shared(this->m_dir_locks.get(entry.m_node));
+			dir* directory = entry.m_node->m_dir;
+			if (!directory)
+				continue;
+
+			// Literal components are resolved directly, everything else has to look at every child
+			//
+			candidates.clear();
+			if (lookup_children && pattern.literal_only(current_states))
+			{
+				for (const state& it : current_states)
+				{
+					const glob_pattern::segment* segment = pattern.pending_segment(it);
+					if (!segment)
+						continue;
+
+					child_name.assign(segment->m_literal);
+					child_name.push_back('/');
+
+					node* child = directory->find_child(child_name);
+					if (child && std::find(candidates.begin(), candidates.end(), child) == candidates.end())
+						candidates.push_back(child);
+
+					child_name.pop_back();
+					child = directory->find_child(child_name);
+					if (child && std::find(candidates.begin(), candidates.end(), child) == candidates.end())
+						candidates.push_back(child);
+				}
+			}
+			else
+			{
+				candidates.assign(directory->begin(), directory->end());
+			}
+
+			for (node* child : candidates)
+			{
+				std::string_view name = child->name();
+				if (!child->m_is_file && !name.empty() && name.back() == '/')
+					name.remove_suffix(1);
+
+				pattern.step(current_states, name, !child->m_is_file, child_states);
+				if (child_states.empty())
+					continue;
+
+				if (pattern.accepts(child_states, !child->m_is_file))
+					out_nodes.push_back(child);
+
+				if (child->m_is_file || !pattern.can_continue(child_states))
+					continue;
+
+				pending.push_back({ child, state_stack.size() });
+				state_stack.insert(state_stack.end(), child_states.begin(), child_states.end());
+			}
+		}
+
+		return out_nodes.size();
+	}
+
+	/**
+	* Creates an immutable snapshot of all nodes, see zvfs::frozen_vfs
+	* The snapshot keeps pointers to the file data of this vfs but is otherwise independent of it.
+	* Nodes that a thread safe vfs adds while the snapshot is taken may or may not be part of it
+	*
+	* @param[in] writer		Invoked for every file node to store a descriptor of its data in the snapshot, may be empty
+	*						Descriptors survive frozen_vfs::save and frozen_vfs::map, file pointers don't.
+	*						A thread safe vfs is read locked meanwhile, the writer must not add or remove nodes
+	*
+	* @returns				The snapshot, an empty one if the vfs couldn't be read
+	* @exceptsafe strong
+	* @throws std::bad_alloc		Thrown if the snapshot could not be allocated
+	* @throws std::runtime_error	Thrown if the vfs holds more nodes or path data than a snapshot can address
+	* @throws ...			Rethrows exceptions thrown by writer
+	*/
+	frozen_vfs vfs::freeze(const payload_writer& writer)
+	{
+		if (!this->m_initialized)
+			return frozen_vfs();
+
+		std::shared_lock<std::shared_mutex> lock = this->lock_shared();
+
+		// The snapshot relies on the children of each directory following each other
+		//
+		std::vector<node*> order;
+		std::vector<uint32_t> child_counts;
+		this->breadth_first_order(order, child_counts);
+
+		return frozen_vfs::build(order, child_counts, this->m_settings.m_lowercase_filesystem, this->m_settings.m_ansi_paths, writer);
+	}
+
+	/**
+	* Writes all nodes into a file that vfs::load can restore without parsing the original sources again
+	* The file stores the hierarchy, every name once, the path hashes, one opaque descriptor per file and a checksum
+	*
+	* @param[in] path		Path of the written file, an existing file is replaced
+	* @param[in] writer		Invoked for every file node to serialize its data, may be empty
+	*						A thread safe vfs is read locked meanwhile, the writer must not add or remove nodes
+	*
+	* @returns				Returns true if the file was written completely
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the file contents could not be assembled
+	* @throws ...			Rethrows exceptions thrown by writer
+	*/
+	bool vfs::save(const std::filesystem::path& path, const payload_writer& writer)
+	{
+		if (!this->m_initialized)
+			return false;
+
+		std::shared_lock<std::shared_mutex> lock = this->lock_shared();
+
+		// Parents always precede their children, so loading can link every node right away
+		//
+		std::vector<node*> order;
+		std::vector<uint32_t> child_counts;
+		this->breadth_first_order(order, child_counts);
+
+		if (order.size() >= g_no_parent)
+			return false;
+
+		std::vector<saved_record> records(order.size());
+		std::vector<char> names;
+		std::vector<std::byte> payload;
+		std::vector<std::byte> descriptor;
+
+		// Names are interned, equal names share one pointer and are written once
+		//
+		std::unordered_map<const char*, uint32_t> name_offsets;
+
+		uint32_t next_child = 1;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			node* current = order[i];
+			saved_record& target = records[i];
+
+			target.m_hash = current->m_hash;
+			target.m_name_size = current->m_name_size;
+
+			if (i == 0)
+				target.m_parent = g_no_parent;
+
+			for (uint32_t child = next_child; child < next_child + child_counts[i]; child++)
+				records[child].m_parent = static_cast<uint32_t>(i);
+
+			next_child += child_counts[i];
+
+			if (current->m_name_size)
+			{
+				auto [name, inserted] = name_offsets.try_emplace(current->m_name, static_cast<uint32_t>(names.size()));
+				if (inserted)
+				{
+					if (names.size() + current->m_name_size > UINT32_MAX)
+						return false;
+
+					names.insert(names.end(), current->m_name, current->m_name + current->m_name_size);
+				}
+
+				target.m_name_offset = name->second;
+			}
+
+			if (current->m_is_file && writer)
+			{
+				descriptor.clear();
+				writer(current, descriptor);
+
+				if (descriptor.size() > UINT32_MAX)
+					return false;
+
+				target.m_payload_offset = payload.size();
+				target.m_payload_size = static_cast<uint32_t>(descriptor.size());
+				payload.insert(payload.end(), descriptor.begin(), descriptor.end());
+			}
+		}
+
+		saved_header header = {};
+		header.m_magic = g_saved_magic;
+		header.m_version = g_saved_version;
+		header.m_flags = (this->m_settings.m_lowercase_filesystem ? g_saved_fold_case : 0) | (this->m_settings.m_ansi_paths ? g_saved_ascii_only : 0);
+		header.m_node_count = records.size();
+		header.m_names_size = names.size();
+		header.m_payload_size = payload.size();
+		header.m_checksum = saved_checksum(records, names, payload);
+
+		std::ofstream stream(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		if (!stream.is_open())
+			return false;
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(saved_record)));
+		stream.write(names.data(), static_cast<std::streamsize>(names.size()));
+		stream.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+		stream.close();
+
+		return !stream.fail();
 	}
 
 	/**
-	* Removes a node from the vfs. Expects complete paths
-	*
-	* @param[in] path		Complete path to the node
-	*						Example: folder1/folder2/file.png
-	* 
-	* @param[in] recursive	Deletes multiple levels of sub-folders
-	*						including any file present in those
+	* Restores the nodes of a file written by vfs::save
+	* The file is read in one pass of a few large reads, stored hashes are used as they are and nothing is rehashed
 	*
-	*						Warning: The function will fail if specified with a path to a file
-	* 
-	* @returns				Returns true on successfull deletion
+	* @param[in] path		Path of the file
+	* @param[in] reader		Invoked for every restored file node with the descriptor its writer produced, may be empty
+	*						The returned zvfs::file becomes the data of the node, the vfs takes ownership
+	*						A thread safe vfs is write locked meanwhile, the reader must not access the vfs
 	*
+	* @returns				Returns true if all nodes were restored. Returns false if the vfs already contains nodes,
+	*						the file was saved with different case or character set settings, its checksum doesn't match,
+	*						its hierarchy is malformed or two records share a path.
+	*						Nothing is added in that case. The checksum is no protection against deliberately forged files
 	* @exceptsafe basic
-	* @throws std::runtime_exception	Thrown if deletion corrupted the file hierachy or
-	*									was unable to delete all nodes comletely
+	* @throws std::bad_alloc	Thrown if the nodes could not be allocated. Nodes restored up to this point remain valid
+	* @throws ...			Rethrows exceptions thrown by reader
 	*/
-	bool vfs::remove(std::string_view path, bool recursive)
+	bool vfs::load(const std::filesystem::path& path, const payload_reader& reader)
 	{
 		if (!this->m_initialized)
 			return false;
 
-		node* entry = this->get(path);
-		if (!entry)
+		std::ifstream stream(path, std::ios_base::in | std::ios_base::binary);
+		if (!stream.is_open())
 			return false;
 
-		return this->remove_node(entry, recursive);
-	}
+		stream.seekg(0, std::ios_base::end);
+		uint64_t file_size = static_cast<uint64_t>(stream.tellg());
+		stream.seekg(0, std::ios_base::beg);
 
-	/**
-	* Removes a node from the vfs. Expects complete paths
-	*
-	* @overload
-	*/
-	bool vfs::remove(std::string& path, bool recursive)
-	{
-		if (!this->m_initialized)
+		saved_header header;
+		if (file_size < sizeof(header) || !stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
 			return false;
 
-		node* entry = this->get(path);
-		if (!entry)
+		uint32_t flags = (this->m_settings.m_lowercase_filesystem ? g_saved_fold_case : 0) | (this->m_settings.m_ansi_paths ? g_saved_ascii_only : 0);
+		if (header.m_magic != g_saved_magic || header.m_version != g_saved_version || header.m_flags != flags)
 			return false;
 
-		return this->remove_node(entry, recursive);
-	}
+		// Sizes are checked against the file before anything is allocated for them
+		//
+		uint64_t remaining = file_size - sizeof(header);
+		if (!header.m_node_count || header.m_node_count >= g_no_parent || header.m_node_count > remaining / sizeof(saved_record))
+			return false;
 
-	/**
-	* Retrieves a node from the vfs. Expects complete paths
-	*
-	* @param[in] path		Complete path to the node
-	*						Example: folder1/folder2/file.png
-	* 
-	* @returns				If the function succeeded it returns a pointer to the requested zvfs::node
-	*						Returns a nullptr if node could not be found
-	* @exceptsafe no-throw
-	*/
-	node* vfs::get(std::string_view path)
-	{
-		if (!this->m_initialized)
-			return nullptr;
+		remaining -= header.m_node_count * sizeof(saved_record);
+		if (header.m_names_size > remaining || header.m_payload_size != remaining - header.m_names_size)
+			return false;
 
-		size_t hash = this->m_hasher(path);
-		return get_node(hash);
-	}
+		std::vector<saved_record> records(static_cast<size_t>(header.m_node_count));
+		std::vector<char> names(static_cast<size_t>(header.m_names_size));
+		std::vector<std::byte> payload(static_cast<size_t>(header.m_payload_size));
 
-	/**
-	* Retrieves a node from the vfs. Expects complete paths
-	*
-	* @overload
-	*/
-	node* vfs::get(std::string& path)
-	{
-		if (!this->m_initialized)
-			return nullptr;
+		stream.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(saved_record)));
+		stream.read(names.data(), static_cast<std::streamsize>(names.size()));
+		stream.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+		if (!stream || header.m_checksum != saved_checksum(records, names, payload))
+			return false;
 
-		size_t hash = this->m_hasher(path);
-		return get_node(hash);
-	}
+		// Validate the whole file before the first node is linked
+		//
+		const saved_record& root = records.front();
+		if (root.m_parent != g_no_parent || root.m_name_size || root.m_payload_size || root.m_hash != this->m_root_node->m_hash)
+			return false;
 
-	/**
-	* Retrieves a list of nodes matching a query string on the path
-	*
-	* @param[in] filter		Substring of the node path
-	*						Example: ".txt", "file.extension" or "folder1/file.png"
-	*
-	* @returns				If the function succeeded it returns the number of found nodes matching the query
-	*						Returns -1 if the vfs couldn't be searched
-	* @exceptsafe no-throw
-	*/
-	size_t vfs::find(std::string_view filter, std::vector<node*>& out_nodes)
-	{
-		if (!this->m_initialized)
-			return static_cast<size_t>(-1);
+		// Parents precede their children, every record is checked against an already validated parent
+		//
+		for (size_t i = 1; i < records.size(); i++)
+		{
+			const saved_record& current = records[i];
+			if (current.m_parent >= i || !current.m_name_size || current.m_name_offset > names.size() || current.m_name_size > names.size() - current.m_name_offset)
+				return false;
 
-		// We want to provide a clear indication if a file was found at all
+			if (current.m_payload_offset > payload.size() || current.m_payload_size > payload.size() - current.m_payload_offset)
+				return false;
+
+			// Only directory names may contain a slash, and only at their end
+			//
+			std::string_view name(names.data() + current.m_name_offset, current.m_name_size);
+			size_t separator = name.find('/');
+			if (separator != std::string_view::npos && separator != name.size() - 1)
+				return false;
+
+			const saved_record& parent = records[current.m_parent];
+			if (current.m_parent && names[parent.m_name_offset + parent.m_name_size - 1] != '/')
+				return false;
+		}
+
+		// Equal paths hash equally, only records sharing a hash have to be compared.
+		// With unique parents two paths are equal exactly if they have the same parent and name
 		//
-		out_nodes.clear();
+		std::vector<uint32_t> by_hash(records.size());
+		for (size_t i = 0; i < by_hash.size(); i++)
+			by_hash[i] = static_cast<uint32_t>(i);
+
+		std::sort(by_hash.begin(), by_hash.end(), [&records](uint32_t lhs, uint32_t rhs)
+		{
+			return records[lhs].m_hash < records[rhs].m_hash;
+		});
 
-		for (auto it : this->m_nodes)
+		bool ignore_case = this->m_settings.m_lowercase_filesystem;
+		for (size_t run = 0; run < by_hash.size(); )
 		{
-			if (it.second->path().find(filter) != std::string::npos)
-				out_nodes.push_back(it.second);
+			size_t run_end = run + 1;
+			while (run_end < by_hash.size() && records[by_hash[run_end]].m_hash == records[by_hash[run]].m_hash)
+				run_end++;
+
+			for (size_t i = run; i < run_end; i++)
+			{
+				const saved_record& lhs = records[by_hash[i]];
+				for (size_t j = i + 1; j < run_end; j++)
+				{
+					const saved_record& rhs = records[by_hash[j]];
+					if (lhs.m_parent == rhs.m_parent && path::equals(std::string_view(names.data() + lhs.m_name_offset, lhs.m_name_size), std::string_view(names.data() + rhs.m_name_offset, rhs.m_name_size), ignore_case))
+						return false;
+				}
+			}
+
+			run = run_end;
 		}
 
-		return out_nodes.size();
+		std::unique_lock<std::shared_mutex> lock = this->lock_exclusive();
+
+		if (this->m_nodes.size() != 1)
+			return false;
+
+		// Names were deduplicated when saving, they move into the string pool as one block
+		//
+		char* name_block = this->m_names.allocate(names.size());
+		std::memcpy(name_block, names.data(), names.size());
+
+		this->m_nodes.reserve(records.size());
+
+		std::vector<node*> nodes(records.size());
+		nodes[0] = this->m_root_node;
+
+		std::string path_buffer;
+		bool needs_path = this->m_settings.m_prefix_index || this->m_settings.m_substring_index;
+
+		for (size_t i = 1; i < records.size(); i++)
+		{
+			const saved_record& current = records[i];
+			std::string_view name(name_block + current.m_name_offset, current.m_name_size);
+			node* parent = nodes[current.m_parent];
+
+			if (needs_path)
+			{
+				path_buffer.resize(parent->m_path_size);
+				parent->write_path(path_buffer.data());
+				path_buffer.append(name);
+			}
+
+			node* entry = this->attach_node(parent, path_buffer, name, static_cast<size_t>(current.m_hash), name.back() != '/');
+			nodes[i] = entry;
+
+			if (entry->m_is_file && reader)
+				entry->m_file = reader(entry, std::span<const std::byte>(payload.data() + current.m_payload_offset, current.m_payload_size));
+		}
+
+		return true;
 	}
 
 	/**
-	* Retrieves a list of nodes matching a query string on the path
+	* Pins the calling thread for lock-free lookups
+	* Nodes retrieved while the guard lives stay valid even if another thread removes them meanwhile,
+	* they are only freed after every guard that could have seen them is gone. Guards may be nested
 	*
-	* @overload
+	* @returns				A guard that has to be destroyed on the thread that created it
+	* @exceptsafe strong
+	* @throws std::bad_alloc	Thrown if the reader slot of a new thread could not be allocated
 	*/
-	size_t vfs::find(std::string& filter, std::vector<node*>& out_nodes)
+	epoch_domain::guard vfs::pin()
 	{
-		// Implicitly convert std::string& to std::string_view via const char* argument
-		//
-		return this->find(filter.c_str(), out_nodes);
+		return this->m_epochs.pin();
 	}
 
 	/**
@@ -214,67 +1208,173 @@ namespace zvfs
 	*/
 	size_t vfs::size()
 	{
+		if (!this->m_initialized)
+			return 0;
+
+		std::shared_lock<std::shared_mutex> lock = this->lock_shared();
 		return this->m_nodes.size();
 	}
 
 	node* vfs::add_node(std::string_view path)
 	{
-		size_t hash = this->hash_entry(path);
-		if (hash == static_cast<size_t>(-1))
-			return nullptr;
-
 		// The root node for each VFS is created while constructing the VFS itself
 		//
-		bool isroot = !static_cast<bool>(path.size());
-		if (isroot)
+		if (path.empty())
 			return this->m_root_node;
 
-		// Check if the node already exists 
+		// Every prefix ending in a slash is a directory node, the last component may be a file
+		//
+		struct prefix
+		{
+			size_t m_end;
+			size_t m_hash;
+		};
+
+		size_t depth = static_cast<size_t>(std::count(path.begin(), path.end(), '/')) + (path.back() == '/' ? 0 : 1);
+
+		// Typical paths fit into the inline buffer, only unusually deep ones spill to the heap
+		//
+		std::array<prefix, 32> inline_prefixes;
+		std::vector<prefix> spilled_prefixes;
+		prefix* prefixes = inline_prefixes.data();
+		if (depth > inline_prefixes.size())
+		{
+			spilled_prefixes.resize(depth);
+			prefixes = spilled_prefixes.data();
+		}
+
+		// Tokenize once and feed the components into one streaming hasher,
+		// the digest after each component is the hash of that prefix
+		//
+		path_hasher hasher(this->m_settings.m_lowercase_filesystem, this->m_settings.m_ansi_paths);
+		size_t offset = 0;
+		for (size_t i = 0; i < depth; i++)
+		{
+			size_t separator = path.find('/', offset);
+			size_t end = separator == std::string_view::npos ? path.size() : separator + 1;
+
+			hasher.update(path.substr(offset, end - offset));
+			prefixes[i] = { end, hasher.digest() };
+			offset = end;
+		}
+
+		// Validation failures are sticky, the full path hash covers every prefix
+		//
+		if (prefixes[depth - 1].m_hash == static_cast<size_t>(-1))
+			return nullptr;
+
+		// Walk up from the full path until the first existing ancestor
+		// Usually that's the node itself or its direct parent
 		//
-		if (node* entry = get_node(hash))
+		size_t existing = depth;
+		node* entry = nullptr;
+		while (existing > 0)
+		{
+			const prefix& current = prefixes[existing - 1];
+			entry = this->get_node(current.m_hash, path.substr(0, current.m_end));
+			if (entry)
+				break;
+
+			existing--;
+		}
+
+		if (existing == depth)
 			return entry;
 
-		// Split the path into two seperate stringviews
-		// First contains the path including trailing slash, second contains the filename (possibly including extension)
+		if (!entry)
+			entry = this->m_root_node;
+
+		// Create the missing nodes top down, a concurrent add may have created some of them meanwhile
+		//
+		for (size_t i = existing; i < depth; i++)
+		{
+			std::string_view prefix_path = path.substr(0, prefixes[i].m_end);
+			bool is_file = prefix_path.back() != '/';
+
+			entry = this->link_node(entry, prefix_path, prefixes[i].m_hash, is_file);
+		}
+
+		return entry;
+	}
+
+	node* vfs::link_node(node* parent, std::string_view path, size_t hash, bool is_file)
+	{
+		// Threads adding the same path race for the parent lock, the loser finds the winners node
 		//
-		auto [split_path, split_file] = path::split_path(path);
+		std::unique_lock<std::shared_mutex> dir_lock = this->lock_exclusive(this->m_dir_locks.get(parent));
+		if (this->m_settings.m_thread_safe)
+		{
+			if (node* existing = this->get_node(hash, path))
+				return existing;
+		}
+
+		std::string_view name = path.substr(parent->m_path_size);
+		std::string_view interned_name;
+		{
+			std::unique_lock<std::shared_mutex> names_lock = this->lock_exclusive(this->m_names_mutex);
+			interned_name = this->m_names.intern(name);
+		}
 
-		node* parent = add_node(split_path);
+		return this->attach_node(parent, path, interned_name, hash, is_file);
+	}
 
-		bool isfile = !static_cast<bool>(path.back() == '/');
-		node* entry = new node(isfile, false, hash, path);
+	node* vfs::attach_node(node* parent, std::string_view path, std::string_view name, size_t hash, bool is_file)
+	{
+		node* entry = this->create_node(is_file, false, hash, name);
 
 		entry->set_parent(parent);
 
 		if (!parent->m_dir)
 		{
-			parent->m_dir = new dir();
+			this->create_dir(parent);
 		}
 
 		parent->m_dir->add_child(entry);
 
+		this->m_nodes.insert(entry);
+
+		if (this->m_settings.m_prefix_index || this->m_settings.m_substring_index)
+		{
+			std::unique_lock<std::shared_mutex> index_lock = this->lock_exclusive(this->m_search_index_mutex);
+
+			if (this->m_settings.m_prefix_index)
+				this->m_prefix_index.insert(path, entry);
 
-		this->m_nodes.insert({ hash, entry });
+			if (this->m_settings.m_substring_index)
+				entry->m_search_id = this->m_substring_index.insert(entry, path);
+		}
 
 		return entry;
 	}
 
+	node_data** vfs::data_slot(node* entry)
+	{
+		return entry->m_is_file ? reinterpret_cast<node_data**>(&entry->m_file) : reinterpret_cast<node_data**>(&entry->m_dir);
+	}
+
 	bool vfs::remove_node(node* entry, bool recursive)
 	{
-		auto delete_node = [this](node* entry) -> bool
+		std::string path_buffer;
+		auto delete_node = [this, &path_buffer](node* entry) -> bool
 		{
 			if (!entry)
 				return false;
 
-			// Find the node in the root container
+			// Remove the node from the root container
+			// The index compares by identity, so colliding paths can't remove each other
 			//
-			auto map_entry = this->m_nodes.find(entry->hash());
-			if (map_entry == this->m_nodes.end())
+			if (!this->m_nodes.erase(entry))
 				return false;
 
-			// Remove it from the root container
-			//
-			this->m_nodes.erase(map_entry);
+			if (this->m_settings.m_prefix_index)
+			{
+				this->build_path(entry, path_buffer);
+				if (!this->m_prefix_index.erase(path_buffer))
+					throw std::runtime_error("Node is missing from the prefix index");
+			}
+
+			if (this->m_settings.m_substring_index)
+				this->m_substring_index.erase(entry->m_search_id);
 
 			// Verify that the parent hierachy is not corrupted
 			// The root node is allowed to have no parent
@@ -291,8 +1391,12 @@ namespace zvfs
 			}
 
 			// Perform actual deletion on the node object
+			// Concurrent lookups may still hold the node, those only let go of it in a later epoch
 			//
-			delete entry;
+			if (this->m_settings.m_thread_safe)
+				this->retire_node(entry);
+			else
+				this->destroy_node(entry);
 
 			return true;
 		};
@@ -367,47 +1471,198 @@ namespace zvfs
 				return false;
 		}
 
-		return delete_node(entry);
+		bool removed = delete_node(entry);
+
+		// Dead ids only cost query time, but they pile up with every removal
+		//
+		if (this->m_settings.m_substring_index && this->m_substring_index.needs_compaction())
+			this->compact_substring_index();
+
+		return removed;
 	}
 
-	node* vfs::get_node(size_t hash)
+	node* vfs::find_node(std::string_view path)
 	{
-		auto entry = this->m_nodes.find(hash);
-		if (entry == this->m_nodes.end())
+		size_t hash = this->hash_entry(path);
+		if (hash == static_cast<size_t>(-1))
 			return nullptr;
 
-		return entry->second;
+		return this->get_node(hash, path);
 	}
 
-	size_t vfs::hash_entry(std::string_view path)
+	node* vfs::get_node(size_t hash, std::string_view path)
 	{
-		// If the vfs is running in ansi path mode we need to verify
-		// that all paths are legal. Only allow sensible inputs
+		// Concurrent adds may replace the slot array of a shard, the pin keeps the old one alive during the probe
+		// Keeping the returned node alive is up to the callers own lock or pin
+		//
+		std::optional<epoch_domain::guard> guard;
+		if (this->m_settings.m_thread_safe)
+			guard.emplace(this->m_epochs.pin());
+
+		// A hash match alone is not enough, two different paths may share the same hash
 		//
-		if (this->m_settings.m_ansi_paths)
+		bool ignore_case = this->m_settings.m_lowercase_filesystem;
+		return this->m_nodes.find(hash, [path, ignore_case](node* entry)
 		{
-			for (auto c : path)
-			{
-				if (c < 32 || c > 126)
-					return static_cast<size_t>(-1);
-			}
-		}
+			return entry->path_equals(path, ignore_case);
+		});
+	}
 
+	size_t vfs::hash_entry(std::string_view path)
+	{
+		// If the vfs is running in ansi path mode the hasher rejects every illegal path
 		// Lowecase mode instructs the vfs to treat all inputs as lowercase paths
 		// This will cause collisions if it doesn't match the source filesystems rules
 		//
-		if (this->m_settings.m_lowercase_filesystem)
+		return path_hasher::hash(path, this->m_settings.m_lowercase_filesystem, this->m_settings.m_ansi_paths);
+	}
+
+	node* vfs::create_node(bool is_file, bool is_root, size_t hash, std::string_view name)
+	{
+		std::pmr::polymorphic_allocator<node> allocator(this->m_resource);
+
+		node* entry = allocator.allocate(1);
+		try
+		{
+			new (entry) node(is_file, is_root, hash, name, this->m_resource);
+		}
+		catch (...)
+		{
+			allocator.deallocate(entry, 1);
+			throw;
+		}
+
+		return entry;
+	}
+
+	dir* vfs::create_dir(node* entry)
+	{
+		std::pmr::polymorphic_allocator<dir> allocator(this->m_resource);
+
+		entry->m_dir = allocator.new_object<dir>(this->m_resource, this->m_settings.m_lowercase_filesystem);
+		entry->m_owns_dir = true;
+
+		return entry->m_dir;
+	}
+
+	void vfs::release_data(node* entry)
+	{
+		if (entry->m_is_file)
+		{
+			delete entry->m_file;
+		}
+		else if (entry->m_owns_dir)
+		{
+			std::pmr::polymorphic_allocator<dir> allocator(this->m_resource);
+			allocator.delete_object(entry->m_dir);
+		}
+		else
+		{
+			delete entry->m_dir;
+		}
+
+		entry->m_file = nullptr;
+		entry->m_owns_dir = false;
+	}
+
+	void vfs::destroy_node(node* entry)
+	{
+		this->release_data(entry);
+
+		std::pmr::polymorphic_allocator<node> allocator(this->m_resource);
+		entry->~node();
+		allocator.deallocate(entry, 1);
+	}
+
+	void vfs::retire_node(node* entry)
+	{
+		this->m_epochs.retire(entry, [](void* context, void* pointer)
+		{
+			static_cast<vfs*>(context)->destroy_node(static_cast<node*>(pointer));
+		}, this);
+	}
+
+	void vfs::reclaim()
+	{
+		// Concurrent adds may reclaim at the same time, the domain serializes them
+		//
+		if (this->m_settings.m_thread_safe)
+			this->m_epochs.reclaim();
+	}
+
+	void vfs::build_path(node* entry, std::string& out)
+	{
+		out.resize(entry->m_path_size);
+		entry->write_path(out.data());
+	}
+
+	void vfs::breadth_first_order(std::vector<node*>& out_order, std::vector<uint32_t>& out_child_counts)
+	{
+		bool ignore_case = this->m_settings.m_lowercase_filesystem;
+
+		// Every child list is sorted by name and follows the lists of the directories visited before it
+		//
+		out_order.assign(1, this->m_root_node);
+		out_child_counts.clear();
+
+		for (size_t i = 0; i < out_order.size(); i++)
 		{
-			std::string lower_case_path;
-			lower_case_path.resize(path.size());
+			node* current = out_order[i];
+			size_t first = out_order.size();
+
+			if (!current->m_is_file)
+			{
+				std::shared_lock<std::shared_mutex> dir_lock = this->lock_shared(this->m_dir_locks.get(current));
+				if (current->m_dir)
+					out_order.insert(out_order.end(), current->m_dir->begin(), current->m_dir->end());
+			}
 
-			std::transform(path.begin(), path.end(), lower_case_path.begin(), [](unsigned char c)
+			std::sort(out_order.begin() + first, out_order.end(), [ignore_case](node* lhs, node* rhs)
 			{
-				return static_cast<char>(std::tolower(c));
+				return path::compare(lhs->name(), rhs->name(), ignore_case) < 0;
 			});
 
-			return this->m_hasher(lower_case_path.c_str());
+			out_child_counts.push_back(static_cast<uint32_t>(out_order.size() - first));
 		}
-		return this->m_hasher(path.data());
+	}
+
+	void vfs::compact_substring_index()
+	{
+		// Reassign dense ids and rebuild all posting lists from the live nodes
+		//
+		this->m_substring_index.clear();
+
+		std::string path_buffer;
+		this->m_nodes.for_each([this, &path_buffer](node* it)
+		{
+			this->build_path(it, path_buffer);
+			it->m_search_id = this->m_substring_index.insert(it, path_buffer);
+		});
+	}
+
+	std::shared_lock<std::shared_mutex> vfs::lock_shared()
+	{
+		return this->lock_shared(this->m_mutex);
+	}
+
+	std::unique_lock<std::shared_mutex> vfs::lock_exclusive()
+	{
+		return this->lock_exclusive(this->m_mutex);
+	}
+
+	std::shared_lock<std::shared_mutex> vfs::lock_shared(std::shared_mutex& mutex)
+	{
+		if (!this->m_settings.m_thread_safe)
+			return {};
+
+		return std::shared_lock<std::shared_mutex>(mutex);
+	}
+
+	std::unique_lock<std::shared_mutex> vfs::lock_exclusive(std::shared_mutex& mutex)
+	{
+		if (!this->m_settings.m_thread_safe)
+			return {};
+
+		return std::unique_lock<std::shared_mutex>(mutex);
 	}
 }
\ No newline at end of file
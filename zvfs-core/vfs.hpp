@@ -1,8 +1,24 @@
 #pragma once
 #include "settings.hpp"
 #include "node.hpp"
+#include "sharded_node_index.hpp"
+#include "string_pool.hpp"
+#include "radix_tree.hpp"
+#include "trigram_index.hpp"
+#include "glob.hpp"
+#include "thread_pool.hpp"
+#include "match_range.hpp"
+#include "epoch.hpp"
+#include "frozen.hpp"
+#include "source.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace zvfs
@@ -15,25 +31,51 @@ namespace zvfs
 	class vfs
 	{
 	public:
+		/**
+		* Serializes the data of a file node for vfs::save
+		* Invoked as writer(node, out_descriptor), the descriptor is appended to out_descriptor (passed in empty)
+		*/
+		using payload_writer = std::function<void(node* entry, std::vector<std::byte>& out_descriptor)>;
+
+		/**
+		* Recreates the data of a file node for vfs::load
+		* Invoked as reader(node, descriptor) and returns the new file data or a nullptr
+		*/
+		using payload_reader = std::function<file*(node* entry, std::span<const std::byte> descriptor)>;
+
+		/**
+		* Indexes one archive into a vfs for vfs::mount_many
+		* Invoked as mounter(target, archive) and returns the number of added entries or -1 on failure
+		*/
+		using mount_function = std::function<size_t(vfs& target, source& archive)>;
+
 		/**
 		* File reader implementation
 		*
 		* @param[in] settings	You can either create your own zvfs::vfs_settings object or pass
 		*						a default one from zvfs::settings
+		* @param[in] resource	Upstream memory resource for all internal allocations (nodes, directories, paths, index)
+		*						The vfs keeps its own pool on top of it, so memory is only returned on removal or destruction
 		* @exceptsafe no-throw
 		*/
-		[[nodiscard]] vfs(vfs_settings& settings = settings::g_default_settings);
+		[[nodiscard]] vfs(vfs_settings& settings = settings::g_default_settings, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 		/**
 		* Performs a full cleanup on all linked nodes
 		* Will invoke destructors of user defined zvfs::file overloads
+		* Internal memory is released in bulk without visiting the hierarchy
 		*
 		* @exceptsafe no-throw
 		*/
 		~vfs();
 
+		vfs(const vfs&) = delete;
+		vfs& operator=(const vfs&) = delete;
+
 		/**
 		* Adds a new node to the vfs. Expects complete paths
+		* Threads may add to a thread safe vfs at the same time, they only wait for each other
+		* while creating children of the same directory
 		*
 		* @param[in] path		Complete path to the added node
 		*						Example: folder1/folder2/file.png
@@ -53,6 +95,43 @@ namespace zvfs
 		*/
 		[[nodiscard]] node_data** add(std::string& path);
 
+		/**
+		* Adds a batch of nodes to the vfs in one pass. Expects complete paths
+		* Reserves the index up front, sorts the batch and creates every intermediate directory exactly once
+		* Batches of different threads are added to a thread safe vfs in parallel, like add()
+		*
+		* @param[in] paths		Complete paths to the added nodes in any order, duplicates are allowed
+		*						Example: { "folder1/folder2/file.png", "folder1/file.txt" }
+		* @param[out] out_slots	Receives one entry per input path in input order, the same zvfs::node_data pointer
+		*						that add() would have returned for that path. Invalid paths receive a nullptr
+		*
+		* @returns				If the function succeeded it returns the number of valid input paths
+		*						Returns -1 if the vfs couldn't be modified
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if the nodes could not be allocated. Nodes added up to this point remain valid
+		*/
+		[[nodiscard]] size_t add_bulk(std::span<const std::string_view> paths, std::vector<node_data**>& out_slots);
+
+		/**
+		* Mounts several archives in parallel and merges them into this vfs
+		* Every archive is indexed into a private staging tree by one worker, the staging trees are then merged
+		* in one vfs::add_bulk pass on the calling thread. The result does not depend on the thread count:
+		* when several archives contain the same file the one listed last wins, files that already had data keep it
+		*
+		* @param[in] sources		The archives in mount order, every mounted file holds a reference to its archive
+		* @param[in] thread_count	Number of workers, 0 uses the number of hardware threads
+		* @param[in] mounter		Invoked as mounter(staging, archive) to index one archive, zvfs::mount_tar if empty.
+		*						Has to return -1 if the archive could not be indexed
+		*
+		* @returns				If the function succeeded it returns the number of merged nodes, intermediate directories included.
+		*						Returns -1 if the vfs couldn't be modified or any archive failed to mount, nothing is added then
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if the staging trees or the merged nodes could not be allocated
+		* @throws std::system_error	Thrown if a worker thread could not be started
+		* @throws ...			Rethrows the first exception thrown by mounter
+		*/
+		[[nodiscard]] size_t mount_many(std::span<source* const> sources, size_t thread_count = 0, const mount_function& mounter = {});
+
 		/**
 		* Removes a node from the vfs. Expects complete paths
 		*
@@ -81,6 +160,8 @@ namespace zvfs
 
 		/**
 		* Retrieves a node from the vfs. Expects complete paths
+		* A thread safe vfs answers without taking a lock. Hold a guard from pin() to keep using
+		* the node while other threads may remove it
 		*
 		* @param[in] path		Complete path to the node
 		*						Example: folder1/folder2/file.png
@@ -100,6 +181,9 @@ namespace zvfs
 
 		/**
 		* Retrieves a list of nodes matching a query string on the path
+		* The query ignores case if the vfs runs in lowercase mode
+		* If zvfs::vfs_settings::m_substring_index is set, filters of three or more characters
+		* only verify the nodes that contain all trigrams of the filter instead of scanning every node
 		*
 		* @param[in] filter		Substring of the node path
 		*						Example: ".txt", "file.extension" or "folder1/file.png"
@@ -117,6 +201,157 @@ namespace zvfs
 		*/
 		[[nodiscard]] size_t find(std::string& filter, std::vector<node*>& out_nodes);
 
+		/**
+		* Retrieves a list of nodes matching a query string on the path, scanning on a thread pool
+		* Every worker checks the nodes of a contiguous range of index slots and the partial results
+		* are concatenated in slot order. Filters the trigram index can answer are not scanned at all
+		* A thread safe vfs is scanned shard by shard, nodes added meanwhile may or may not be reported
+		*
+		* @param[in] filter		Substring of the node path
+		*						Example: ".txt", "file.extension" or "folder1/file.png"
+		* @param[out] out_nodes	Receives the matching nodes
+		* @param[in] pool		The thread pool executing the scan, must not be busy with other work
+		* @param[in] sorted		Sort the results by path, otherwise their order is unspecified
+		*
+		* @returns				If the function succeeded it returns the number of found nodes matching the query
+		*						Returns -1 if the vfs couldn't be searched
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if the results could not be collected
+		*/
+		[[nodiscard]] size_t find(std::string_view filter, std::vector<node*>& out_nodes, thread_pool& pool, bool sorted = false);
+
+		/**
+		* Calls a function for every node matching a query string on the path, without collecting the results
+		* The query ignores case if the vfs runs in lowercase mode and uses the trigram index like find()
+		*
+		* @param[in] filter		Substring of the node path
+		*						Example: ".txt", "file.extension" or "folder1/file.png"
+		* @param[in] callback	Invoked with every matching node, returning false stops the search
+		*						A thread safe vfs is read locked meanwhile, the callback must not add or remove nodes.
+		*						Doing so on the calling thread deadlocks, collect the nodes and modify the vfs afterwards
+		*
+		* @returns				If the function succeeded it returns the number of nodes passed to callback
+		*						Returns -1 if the vfs couldn't be searched
+		* @exceptsafe basic
+		*/
+		size_t for_each_match(std::string_view filter, const std::function<bool(node*)>& callback);
+
+		/**
+		* Creates a lazy search for nodes matching a query string on the path
+		* Nothing is searched until the range is iterated, each step only searches up to the next match
+		* The query ignores case if the vfs runs in lowercase mode and uses the trigram index like find()
+		*
+		* @param[in] filter		Substring of the node path, copied into the range
+		*						Example: ".txt", "file.extension" or "folder1/file.png"
+		*
+		* @returns				A single pass range over the matching nodes, empty if the vfs couldn't be searched.
+		*						A thread safe vfs stays read locked until the range is destroyed, adding or removing nodes
+		*						on the same thread meanwhile deadlocks
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if the search state could not be allocated
+		*/
+		[[nodiscard]] match_range matches(std::string_view filter);
+
+		/**
+		* Retrieves all nodes whose path starts with a prefix, in lexicographic path order
+		* Uses the radix tree if zvfs::vfs_settings::m_prefix_index is set, otherwise it only visits
+		* the directory containing the prefix and the matching subtrees
+		*
+		* @param[in] prefix		Start of the node path, does not have to end on a component boundary
+		*						Example: "textures/ui/" or "textures/ui/button_"
+		* @param[out] out_nodes	Receives the matching nodes
+		*
+		* @returns				If the function succeeded it returns the number of found nodes matching the prefix
+		*						Returns -1 if the vfs couldn't be searched
+		* @exceptsafe basic
+		*/
+		[[nodiscard]] size_t list_prefix(std::string_view prefix, std::vector<node*>& out_nodes);
+
+		/**
+		* Retrieves all nodes whose path matches a glob pattern, see zvfs::glob_pattern for the syntax
+		* The pattern ignores case if the vfs runs in lowercase mode
+		*
+		* @param[in] pattern	The glob pattern
+		*						Example: "textures/lod?/rock_*.{png,dds}"
+		* @param[out] out_nodes	Receives the matching nodes in no particular order
+		*
+		* @returns				If the function succeeded it returns the number of found nodes matching the pattern
+		*						Returns -1 if the vfs couldn't be searched or the pattern is invalid
+		* @exceptsafe basic
+		*/
+		[[nodiscard]] size_t glob(std::string_view pattern, std::vector<node*>& out_nodes);
+
+		/**
+		* Retrieves all nodes whose path matches a precompiled glob pattern
+		* Only walks directories some part of the pattern can still match and resolves
+		* literal components through the child lookup of each directory instead of scanning it
+		*
+		* @overload
+		*/
+		[[nodiscard]] size_t glob(const glob_pattern& pattern, std::vector<node*>& out_nodes);
+
+		/**
+		* Creates an immutable snapshot of all nodes, see zvfs::frozen_vfs
+		* The snapshot keeps pointers to the file data of this vfs but is otherwise independent of it.
+		* Nodes that a thread safe vfs adds while the snapshot is taken may or may not be part of it
+		*
+		* @param[in] writer		Invoked for every file node to store a descriptor of its data in the snapshot, may be empty
+		*						Descriptors survive frozen_vfs::save and frozen_vfs::map, file pointers don't.
+		*						A thread safe vfs is read locked meanwhile, the writer must not add or remove nodes
+		*
+		* @returns				The snapshot, an empty one if the vfs couldn't be read
+		* @exceptsafe strong
+		* @throws std::bad_alloc		Thrown if the snapshot could not be allocated
+		* @throws std::runtime_error	Thrown if the vfs holds more nodes or path data than a snapshot can address
+		* @throws ...			Rethrows exceptions thrown by writer
+		*/
+		[[nodiscard]] frozen_vfs freeze(const payload_writer& writer = {});
+
+		/**
+		* Writes all nodes into a file that vfs::load can restore without parsing the original sources again
+		* The file stores the hierarchy, every name once, the path hashes, one opaque descriptor per file and a checksum
+		*
+		* @param[in] path		Path of the written file, an existing file is replaced
+		* @param[in] writer		Invoked for every file node to serialize its data, may be empty
+		*						A thread safe vfs is read locked meanwhile, the writer must not add or remove nodes
+		*
+		* @returns				Returns true if the file was written completely
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if the file contents could not be assembled
+		* @throws ...			Rethrows exceptions thrown by writer
+		*/
+		[[nodiscard]] bool save(const std::filesystem::path& path, const payload_writer& writer = {});
+
+		/**
+		* Restores the nodes of a file written by vfs::save
+		* The file is read in one pass of a few large reads, stored hashes are used as they are and nothing is rehashed
+		*
+		* @param[in] path		Path of the file
+		* @param[in] reader		Invoked for every restored file node with the descriptor its writer produced, may be empty
+		*						The returned zvfs::file becomes the data of the node, the vfs takes ownership
+		*						A thread safe vfs is write locked meanwhile, the reader must not access the vfs
+		*
+		* @returns				Returns true if all nodes were restored. Returns false if the vfs already contains nodes,
+		*						the file was saved with different case or character set settings, its checksum doesn't match,
+		*						its hierarchy is malformed or two records share a path.
+		*						Nothing is added in that case. The checksum is no protection against deliberately forged files
+		* @exceptsafe basic
+		* @throws std::bad_alloc	Thrown if the nodes could not be allocated. Nodes restored up to this point remain valid
+		* @throws ...			Rethrows exceptions thrown by reader
+		*/
+		[[nodiscard]] bool load(const std::filesystem::path& path, const payload_reader& reader = {});
+
+		/**
+		* Pins the calling thread for lock-free lookups
+		* Nodes retrieved while the guard lives stay valid even if another thread removes them meanwhile,
+		* they are only freed after every guard that could have seen them is gone. Guards may be nested
+		*
+		* @returns				A guard that has to be destroyed on the thread that created it
+		* @exceptsafe strong
+		* @throws std::bad_alloc	Thrown if the reader slot of a new thread could not be allocated
+		*/
+		[[nodiscard]] epoch_domain::guard pin();
+
 		/**
 		* Retrieves the current settings of this instance
 		* 
@@ -135,15 +370,44 @@ namespace zvfs
 
 	private:
 		node* add_node(std::string_view path);
+		node* link_node(node* parent, std::string_view path, size_t hash, bool is_file);
+		node* attach_node(node* parent, std::string_view path, std::string_view name, size_t hash, bool is_file);
+		node_data** data_slot(node* entry);
 		bool remove_node(node* entry, bool recursive);
-		node* get_node(size_t hash);
+		node* find_node(std::string_view path);
+		node* get_node(size_t hash, std::string_view path);
 		size_t hash_entry(std::string_view path);
 
+		node* create_node(bool is_file, bool is_root, size_t hash, std::string_view name);
+		dir* create_dir(node* entry);
+		void release_data(node* entry);
+		void destroy_node(node* entry);
+		void retire_node(node* entry);
+		void reclaim();
+		void build_path(node* entry, std::string& out);
+		void breadth_first_order(std::vector<node*>& out_order, std::vector<uint32_t>& out_child_counts);
+		void compact_substring_index();
+
+		std::shared_lock<std::shared_mutex> lock_shared();
+		std::unique_lock<std::shared_mutex> lock_exclusive();
+		std::shared_lock<std::shared_mutex> lock_shared(std::shared_mutex& mutex);
+		std::unique_lock<std::shared_mutex> lock_exclusive(std::shared_mutex& mutex);
+
 	private:
-		std::hash<std::string_view> m_hasher;
-		std::unordered_map<size_t, node*> m_nodes;
+		std::pmr::unsynchronized_pool_resource m_pool;
+		std::pmr::synchronized_pool_resource m_shared_pool;
+		std::pmr::memory_resource* m_resource;
+		epoch_domain m_epochs;
+		string_pool m_names;
+		sharded_node_index m_nodes;
+		radix_tree m_prefix_index;
+		trigram_index m_substring_index;
 		vfs_settings m_settings;
 		node* m_root_node;
 		bool m_initialized;
+		std::shared_mutex m_mutex;
+		std::shared_mutex m_names_mutex;
+		std::shared_mutex m_search_index_mutex;
+		dir_locks m_dir_locks;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,546 @@
+#include "zip.hpp"
+#include "archive.hpp"
+#include "inflate.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zvfs
+{
+	namespace
+	{
+		constexpr uint32_t g_end_signature = 0x06054b50;
+		constexpr uint32_t g_zip64_end_signature = 0x06064b50;
+		constexpr uint32_t g_zip64_locator_signature = 0x07064b50;
+		constexpr uint32_t g_central_signature = 0x02014b50;
+		constexpr uint32_t g_local_signature = 0x04034b50;
+
+		constexpr uint64_t g_end_size = 22;
+		constexpr uint64_t g_max_comment_size = 0xFFFF;
+		constexpr uint64_t g_zip64_locator_size = 20;
+		constexpr uint64_t g_zip64_end_size = 56;
+		constexpr uint64_t g_central_size = 46;
+		constexpr uint64_t g_local_size = 30;
+
+		constexpr uint16_t g_zip64_extra = 0x0001;
+		constexpr uint64_t g_zip64_marker = 0xFFFFFFFF;
+
+		constexpr uint16_t g_method_stored = 0;
+		constexpr uint16_t g_method_deflated = 8;
+
+		// A DEFLATE stream can't expand beyond this, one 258 byte match per two bits at best. Larger claimed sizes
+		// would only make readers allocate memory the data can never fill
+		//
+		constexpr uint64_t g_max_deflate_ratio = 1032;
+		constexpr uint16_t g_flag_encrypted = 1;
+
+		struct zip_entry
+		{
+			uint64_t m_header_offset;
+			uint64_t m_compressed_size;
+			uint64_t m_uncompressed_size;
+			uint32_t m_crc;
+			uint16_t m_method;
+			uint16_t m_flags;
+			uint32_t m_path_offset;
+			uint32_t m_path_size;
+			bool m_is_file;
+		};
+
+		uint16_t read_u16(const std::byte* data)
+		{
+			return static_cast<uint16_t>(static_cast<uint16_t>(data[0]) | static_cast<uint16_t>(data[1]) << 8);
+		}
+
+		uint32_t read_u32(const std::byte* data)
+		{
+			return static_cast<uint32_t>(read_u16(data)) | static_cast<uint32_t>(read_u16(data + 2)) << 16;
+		}
+
+		uint64_t read_u64(const std::byte* data)
+		{
+			return static_cast<uint64_t>(read_u32(data)) | static_cast<uint64_t>(read_u32(data + 4)) << 32;
+		}
+
+		constexpr std::array<uint32_t, 256> g_crc_table = []
+		{
+			std::array<uint32_t, 256> table = {};
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t value = i;
+				for (uint32_t bit = 0; bit < 8; bit++)
+					value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+
+				table[i] = value;
+			}
+
+			return table;
+		}();
+
+		uint32_t crc32(std::span<const std::byte> data)
+		{
+			uint32_t value = ~uint32_t(0);
+			for (std::byte it : data)
+				value = g_crc_table[(value ^ static_cast<uint8_t>(it)) & 0xFF] ^ (value >> 8);
+
+			return ~value;
+		}
+
+		// Fetches a range of the archive, straight from the view or with one read into a buffer
+		//
+		const std::byte* fetch(source& archive, std::span<const std::byte> view, uint64_t offset, uint64_t size, std::vector<std::byte>& buffer)
+		{
+			if (!view.empty())
+			{
+				if (offset > view.size() || size > view.size() - offset)
+					return nullptr;
+
+				return view.data() + offset;
+			}
+
+			buffer.resize(static_cast<size_t>(size));
+			if (archive.read_at(offset, buffer) != size)
+				return nullptr;
+
+			return buffer.data();
+		}
+
+		// The ZIP64 extra field holds 64 bit values for exactly those fields that are saturated in the fixed part,
+		// always in the order uncompressed size, compressed size, local header offset
+		//
+		bool apply_zip64(const std::byte* extra, size_t size, zip_entry& entry)
+		{
+			while (size >= 4)
+			{
+				uint16_t id = read_u16(extra);
+				size_t field_size = read_u16(extra + 2);
+				if (field_size > size - 4)
+					return false;
+
+				if (id == g_zip64_extra)
+				{
+					const std::byte* field = extra + 4;
+					size_t left = field_size;
+					for (uint64_t* value : { &entry.m_uncompressed_size, &entry.m_compressed_size, &entry.m_header_offset })
+					{
+						if (*value != g_zip64_marker)
+							continue;
+
+						if (left < 8)
+							return false;
+
+						*value = read_u64(field);
+						field += 8;
+						left -= 8;
+					}
+				}
+
+				extra += 4 + field_size;
+				size -= 4 + field_size;
+			}
+
+			return true;
+		}
+
+		// File data of one archive member. The central directory doesn't know where the data starts, the local
+		// header in front of it has its own name and extra field lengths, so it is read on first access only
+		//
+		class zip_file : public file
+		{
+		public:
+			zip_file(source* origin, const zip_entry& entry)
+				: m_origin(origin)
+				, m_header_offset(entry.m_header_offset)
+				, m_compressed_size(entry.m_compressed_size)
+				, m_uncompressed_size(entry.m_uncompressed_size)
+				, m_crc(entry.m_crc)
+				, m_method(entry.m_method)
+				, m_flags(entry.m_flags)
+				, m_data_offset(0)
+				, m_failed(false)
+			{
+				this->m_origin->reference();
+			}
+
+			~zip_file() override
+			{
+				this->m_origin->release();
+			}
+
+			zip_file(const zip_file&) = delete;
+			zip_file& operator=(const zip_file&) = delete;
+
+			uint64_t size() const override
+			{
+				return this->m_uncompressed_size;
+			}
+
+			size_t read_at(uint64_t offset, std::span<std::byte> out_buffer) const override
+			{
+				if (!this->readable())
+					return static_cast<size_t>(-1);
+
+				if (offset >= this->m_uncompressed_size)
+					return 0;
+
+				size_t count = static_cast<size_t>(std::min<uint64_t>(out_buffer.size(), this->m_uncompressed_size - offset));
+				if (this->m_method == g_method_stored)
+				{
+					uint64_t data_offset = this->data_offset();
+					if (!data_offset)
+						return static_cast<size_t>(-1);
+
+					return this->m_origin->read_at(data_offset + offset, out_buffer.first(count));
+				}
+
+				std::shared_lock<std::shared_mutex> lock = this->lock_contents();
+				if (!this->m_contents)
+					return static_cast<size_t>(-1);
+
+				std::memcpy(out_buffer.data(), this->m_contents.get() + offset, count);
+				return count;
+			}
+
+			std::span<const std::byte> view() const override
+			{
+				if (!this->readable() || !this->m_uncompressed_size)
+					return {};
+
+				if (this->m_method == g_method_stored)
+				{
+					uint64_t data_offset = this->data_offset();
+					std::span<const std::byte> contents = this->m_origin->view();
+					if (!data_offset || data_offset > contents.size() || this->m_uncompressed_size > contents.size() - data_offset)
+						return {};
+
+					return contents.subspan(static_cast<size_t>(data_offset), static_cast<size_t>(this->m_uncompressed_size));
+				}
+
+				std::shared_lock<std::shared_mutex> lock = this->lock_contents();
+				if (!this->m_contents)
+					return {};
+
+				return std::span<const std::byte>(this->m_contents.get(), static_cast<size_t>(this->m_uncompressed_size));
+			}
+
+			// Waits for readers that are still copying, a failed entry stays failed
+			//
+			void drop_cache() const override
+			{
+				std::unique_lock<std::shared_mutex> lock(this->m_mutex);
+				this->m_contents.reset();
+			}
+
+		private:
+			bool readable() const
+			{
+				return !(this->m_flags & g_flag_encrypted) && (this->m_method == g_method_stored || this->m_method == g_method_deflated);
+			}
+
+			// Returns 0 if the local header is damaged, data never starts at 0. Racing threads compute the same
+			// value, the atomic only keeps the store from tearing
+			//
+			uint64_t data_offset() const
+			{
+				uint64_t data_offset = this->m_data_offset.load(std::memory_order_relaxed);
+				if (data_offset)
+					return data_offset;
+
+				std::byte header[g_local_size];
+				if (this->m_origin->read_at(this->m_header_offset, header) != g_local_size || read_u32(header) != g_local_signature)
+					return 0;
+
+				data_offset = this->m_header_offset + g_local_size + read_u16(header + 26) + read_u16(header + 28);
+
+				uint64_t archive_size = this->m_origin->size();
+				if (data_offset > archive_size || this->m_compressed_size > archive_size - data_offset)
+					return 0;
+
+				this->m_data_offset.store(data_offset, std::memory_order_relaxed);
+				return data_offset;
+			}
+
+			// Returns a shared lock under which m_contents holds the decompressed contents, or is empty if they
+			// can't be produced. Contents are decompressed under the exclusive lock, again after drop_cache
+			//
+			std::shared_lock<std::shared_mutex> lock_contents() const
+			{
+				while (true)
+				{
+					std::shared_lock<std::shared_mutex> lock(this->m_mutex);
+					if (this->m_contents || this->m_failed)
+						return lock;
+
+					lock.unlock();
+
+					std::unique_lock<std::shared_mutex> exclusive(this->m_mutex);
+					if (!this->m_contents && !this->m_failed)
+						this->m_failed = !this->decompress_locked();
+				}
+			}
+
+			bool decompress_locked() const
+			{
+				uint64_t data_offset = this->data_offset();
+				if (!data_offset || this->m_compressed_size > SIZE_MAX || this->m_uncompressed_size > SIZE_MAX)
+					return false;
+
+				size_t compressed_size = static_cast<size_t>(this->m_compressed_size);
+				size_t uncompressed_size = static_cast<size_t>(this->m_uncompressed_size);
+
+				std::unique_ptr<std::byte[]> contents(new (std::nothrow) std::byte[uncompressed_size]);
+				if (!contents)
+					return false;
+
+				// Mapped archives are decompressed in place, others are read into a temporary buffer first
+				//
+				std::span<const std::byte> input = this->m_origin->view();
+				std::unique_ptr<std::byte[]> buffer;
+				if (data_offset <= input.size() && compressed_size <= input.size() - data_offset)
+				{
+					input = input.subspan(static_cast<size_t>(data_offset), compressed_size);
+				}
+				else
+				{
+					buffer.reset(new (std::nothrow) std::byte[compressed_size]);
+					if (!buffer)
+						return false;
+
+					std::span<std::byte> compressed(buffer.get(), compressed_size);
+					if (this->m_origin->read_at(data_offset, compressed) != compressed_size)
+						return false;
+
+					input = compressed;
+				}
+
+				std::span<std::byte> output(contents.get(), uncompressed_size);
+				if (!inflate(input, output) || crc32(output) != this->m_crc)
+					return false;
+
+				this->m_contents = std::move(contents);
+				return true;
+			}
+
+		private:
+			source* m_origin;
+			uint64_t m_header_offset;
+			uint64_t m_compressed_size;
+			uint64_t m_uncompressed_size;
+			uint32_t m_crc;
+			uint16_t m_method;
+			uint16_t m_flags;
+			mutable std::atomic<uint64_t> m_data_offset;
+
+			// Decompressed contents of deflated entries, readers copy under the shared lock, decompressing
+			// and dropping take the exclusive one
+			//
+			mutable std::shared_mutex m_mutex;
+			mutable std::unique_ptr<std::byte[]> m_contents;
+			mutable bool m_failed;
+		};
+	}
+
+	/**
+	* Adds every entry of a ZIP archive to a vfs
+	* The end of central directory record and the central directory are each fetched with one read, ZIP64 records
+	* are understood and data prepended to the archive (self extracting archives) is skipped. No local header is
+	* touched while mounting, each file resolves its own on first access. Stored entries are read straight from
+	* the source and expose a view into it if the source has one, deflated entries are decompressed on first access
+	* into a buffer owned by the file and checked against their CRC-32. That buffer is as large as the uncompressed
+	* entry and stays allocated until file::drop_cache is called or the file is destroyed, reading many large entries
+	* once should drop each after use. Entries using other methods or encryption are mounted but fail to read.
+	* The nodes are registered through vfs::add_bulk
+	*
+	* @param[in] target		The vfs receiving the entries
+	* @param[in] archive	The archive, every mounted file holds a reference to it
+	*
+	* @returns				If the function succeeded it returns the number of mounted entries.
+	*						Later entries replace earlier ones with the same path, paths that already had data keep it.
+	*						Returns -1 if the central directory is damaged, truncated, spans multiple disks or could not be
+	*						read, nothing is added then. Deflated entries claiming more than 1032 times their compressed
+	*						size, more than DEFLATE can produce, count as damage
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the entries could not be allocated. Nodes added up to this point remain valid
+	*/
+	size_t mount_zip(vfs& target, source& archive)
+	{
+		uint64_t archive_size = archive.size();
+		std::span<const std::byte> view = archive.view();
+		if (archive_size < g_end_size)
+			return static_cast<size_t>(-1);
+
+		// The end record is only followed by its comment, one read covering the largest comment also covers
+		// the ZIP64 locator in front of the record
+		//
+		uint64_t tail_size = std::min(archive_size, g_end_size + g_max_comment_size + g_zip64_locator_size);
+		uint64_t tail_offset = archive_size - tail_size;
+
+		std::vector<std::byte> tail_buffer;
+		const std::byte* tail = fetch(archive, view, tail_offset, tail_size, tail_buffer);
+		if (!tail)
+			return static_cast<size_t>(-1);
+
+		// Comments may contain the signature too, the last candidate whose comment fits is the record
+		//
+		const std::byte* record = nullptr;
+		for (uint64_t i = tail_size - g_end_size + 1; i-- > 0;)
+		{
+			if (read_u32(tail + i) == g_end_signature && read_u16(tail + i + 20) <= tail_size - i - g_end_size)
+			{
+				record = tail + i;
+				break;
+			}
+		}
+
+		if (!record)
+			return static_cast<size_t>(-1);
+
+		uint64_t record_position = static_cast<uint64_t>(record - tail);
+		uint64_t record_offset = tail_offset + record_position;
+
+		uint64_t disk = read_u16(record + 4);
+		uint64_t directory_disk = read_u16(record + 6);
+		uint64_t disk_entry_count = read_u16(record + 8);
+		uint64_t entry_count = read_u16(record + 10);
+		uint64_t directory_size = read_u32(record + 12);
+		uint64_t directory_offset = read_u32(record + 16);
+		uint64_t directory_end = record_offset;
+
+		// ZIP64 archives put a locator right in front of the record, it points at a second record with 64 bit fields
+		//
+		if (record_position >= g_zip64_locator_size && read_u32(record - g_zip64_locator_size) == g_zip64_locator_signature)
+		{
+			const std::byte* locator = record - g_zip64_locator_size;
+			uint64_t zip64_offset = read_u64(locator + 8);
+			uint64_t locator_offset = record_offset - g_zip64_locator_size;
+			if (read_u32(locator + 4) || read_u32(locator + 16) > 1 || zip64_offset > locator_offset || g_zip64_end_size > locator_offset - zip64_offset)
+				return static_cast<size_t>(-1);
+
+			std::vector<std::byte> zip64_buffer;
+			auto fetch_zip64 = [&](uint64_t offset) -> const std::byte*
+			{
+				const std::byte* data = offset >= tail_offset ? tail + (offset - tail_offset) : fetch(archive, view, offset, g_zip64_end_size, zip64_buffer);
+				return data && read_u32(data) == g_zip64_end_signature ? data : nullptr;
+			};
+
+			// The locator doesn't count data prepended to the archive. Writers put the record right in front of
+			// the locator, only records with extensible data have to be taken at the stored offset
+			//
+			uint64_t zip64_position = locator_offset - g_zip64_end_size;
+			const std::byte* zip64 = fetch_zip64(zip64_position);
+			if (!zip64 || read_u64(zip64 + 4) != g_zip64_end_size - 12)
+			{
+				zip64_position = zip64_offset;
+				zip64 = fetch_zip64(zip64_position);
+			}
+
+			if (!zip64)
+				return static_cast<size_t>(-1);
+
+			disk = read_u32(zip64 + 16);
+			directory_disk = read_u32(zip64 + 20);
+			disk_entry_count = read_u64(zip64 + 24);
+			entry_count = read_u64(zip64 + 32);
+			directory_size = read_u64(zip64 + 40);
+			directory_offset = read_u64(zip64 + 48);
+			directory_end = zip64_position;
+		}
+
+		if (disk || directory_disk || disk_entry_count != entry_count)
+			return static_cast<size_t>(-1);
+
+		if (directory_offset > directory_end || directory_size > directory_end - directory_offset || entry_count > directory_size / g_central_size)
+			return static_cast<size_t>(-1);
+
+		if (!entry_count)
+			return 0;
+
+		// Offsets are relative to the start of the archive proper, data prepended to it shows as a gap between
+		// where the directory claims to end and where the end record, or the ZIP64 end record, actually is
+		//
+		uint64_t base = directory_end - (directory_offset + directory_size);
+
+		std::vector<std::byte> directory_buffer;
+		const std::byte* directory = fetch(archive, view, base + directory_offset, directory_size, directory_buffer);
+		if (!directory)
+			return static_cast<size_t>(-1);
+
+		std::vector<zip_entry> entries;
+		entries.reserve(static_cast<size_t>(entry_count));
+		std::string paths;
+
+		uint64_t position = 0;
+		for (uint64_t i = 0; i < entry_count; i++)
+		{
+			if (g_central_size > directory_size - position)
+				return static_cast<size_t>(-1);
+
+			const std::byte* header = directory + position;
+			if (read_u32(header) != g_central_signature)
+				return static_cast<size_t>(-1);
+
+			uint16_t name_size = read_u16(header + 28);
+			uint16_t extra_size = read_u16(header + 30);
+			uint16_t comment_size = read_u16(header + 32);
+
+			uint64_t record_size = g_central_size + name_size + extra_size + comment_size;
+			if (record_size > directory_size - position)
+				return static_cast<size_t>(-1);
+
+			position += record_size;
+
+			zip_entry entry = {};
+			entry.m_flags = read_u16(header + 8);
+			entry.m_method = read_u16(header + 10);
+			entry.m_crc = read_u32(header + 16);
+			entry.m_compressed_size = read_u32(header + 20);
+			entry.m_uncompressed_size = read_u32(header + 24);
+			entry.m_header_offset = read_u32(header + 42);
+
+			if (!apply_zip64(header + g_central_size + name_size, extra_size, entry))
+				return static_cast<size_t>(-1);
+
+			if (entry.m_header_offset > archive_size - base || g_local_size > archive_size - base - entry.m_header_offset || entry.m_compressed_size > archive_size)
+				return static_cast<size_t>(-1);
+
+			entry.m_header_offset += base;
+
+			// Encrypted entries carry a header in front of their data, only plain stored entries have equal sizes
+			//
+			if (entry.m_method == g_method_stored && !(entry.m_flags & g_flag_encrypted) && entry.m_compressed_size != entry.m_uncompressed_size)
+				return static_cast<size_t>(-1);
+
+			if (entry.m_method == g_method_deflated && entry.m_uncompressed_size / g_max_deflate_ratio > entry.m_compressed_size)
+				return static_cast<size_t>(-1);
+
+			std::string_view path = strip_leading(std::string_view(reinterpret_cast<const char*>(header + g_central_size), name_size));
+			if (path.empty())
+				continue;
+
+			if (paths.size() + path.size() > UINT32_MAX)
+				return static_cast<size_t>(-1);
+
+			entry.m_path_offset = static_cast<uint32_t>(paths.size());
+			entry.m_path_size = static_cast<uint32_t>(path.size());
+			entry.m_is_file = !path.ends_with('/');
+
+			paths += path;
+			entries.push_back(entry);
+		}
+
+		return add_entries(target, std::span<const zip_entry>(entries), paths, [&archive](const zip_entry& entry) -> file*
+		{
+			return new zip_file(&archive, entry);
+		});
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "vfs.hpp"
+#include "source.hpp"
+#include <cstddef>
+
+namespace zvfs
+{
+	/**
+	* Adds every entry of a ZIP archive to a vfs
+	* The end of central directory record and the central directory are each fetched with one read, ZIP64 records
+	* are understood and data prepended to the archive (self extracting archives) is skipped. No local header is
+	* touched while mounting, each file resolves its own on first access. Stored entries are read straight from
+	* the source and expose a view into it if the source has one, deflated entries are decompressed on first access
+	* into a buffer owned by the file and checked against their CRC-32. That buffer is as large as the uncompressed
+	* entry and stays allocated until file::drop_cache is called or the file is destroyed, reading many large entries
+	* once should drop each after use. Entries using other methods or encryption are mounted but fail to read.
+	* The nodes are registered through vfs::add_bulk
+	*
+	* @param[in] target		The vfs receiving the entries
+	* @param[in] archive	The archive, every mounted file holds a reference to it
+	*
+	* @returns				If the function succeeded it returns the number of mounted entries.
+	*						Later entries replace earlier ones with the same path, paths that already had data keep it.
+	*						Returns -1 if the central directory is damaged, truncated, spans multiple disks or could not be
+	*						read, nothing is added then. Deflated entries claiming more than 1032 times their compressed
+	*						size, more than DEFLATE can produce, count as damage
+	* @exceptsafe basic
+	* @throws std::bad_alloc	Thrown if the entries could not be allocated. Nodes added up to this point remain valid
+	*/
+	[[nodiscard]] extern size_t mount_zip(vfs& target, source& archive);
+}
@@ -1,5 +1,12 @@
 #include "doctest.h"
 #include <zvfs>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
 
 DOCTEST_TEST_CASE("vfs creation")
 {
@@ -315,4 +322,2158 @@ DOCTEST_TEST_CASE("vfs recursive find")
 	CHECK(nodes.size() == 3);
 
 	delete vfs;
-}
\ No newline at end of file
+}
+
+DOCTEST_TEST_CASE("vfs index growth and removal")
+{
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	// Enough entries to force several rehashes of the node index
+	//
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < 64; i++)
+	{
+		for (size_t j = 0; j < 64; j++)
+			paths.push_back("folder" + std::to_string(i) + "/file" + std::to_string(j) + ".png");
+	}
+
+	for (auto& it : paths)
+		CHECK(vfs->add(it) != nullptr);
+
+	// Every file, every folder and the root node
+	//
+	CHECK(vfs->size() == paths.size() + 64 + 1);
+
+	for (auto& it : paths)
+	{
+		auto node = vfs->get(it);
+		CHECK(node != nullptr);
+		CHECK(bool(node->path() == it));
+	}
+
+	// Remove every second folder, the remaining lookups must still resolve
+	// after the index shifted its slots around
+	//
+	for (size_t i = 0; i < 64; i += 2)
+		CHECK(vfs->remove("folder" + std::to_string(i) + "/", true) == true);
+
+	CHECK(vfs->size() == (paths.size() / 2) + 32 + 1);
+
+	for (size_t i = 0; i < 64; i++)
+	{
+		bool removed = (i % 2) == 0;
+		CHECK((vfs->get("folder" + std::to_string(i) + "/file7.png") == nullptr) == removed);
+	}
+
+	// Iterating the index has to visit every node exactly once
+	//
+	std::vector<zvfs::node*> nodes;
+	CHECK(vfs->find("", nodes) == vfs->size());
+
+	delete vfs;
+}
+
+
+DOCTEST_TEST_CASE("vfs index probe chains")
+{
+	zvfs::vfs vfs;
+
+	// Home slot of a hash in a table of 16 slots, mirrors the Fibonacci hashing of node_index
+	//
+	auto home = [](size_t hash)
+	{
+		return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> 60);
+	};
+
+	// Pick real nodes whose hashes share a home slot, plus a few homed right behind it that the chain displaces
+	//
+	std::vector<zvfs::node*> chain;
+	std::vector<zvfs::node*> neighbours;
+	for (size_t i = 0; chain.size() < 6 || neighbours.size() < 3; i++)
+	{
+		std::string path = "asset" + std::to_string(i) + ".bin";
+		CHECK(vfs.add(path) != nullptr);
+
+		zvfs::node* entry = vfs.get(path);
+
+		size_t slot = home(entry->hash());
+		if (slot == 7 && chain.size() < 6)
+			chain.push_back(entry);
+		else if (slot == 8 && neighbours.size() < 3)
+			neighbours.push_back(entry);
+	}
+
+	zvfs::node_index index;
+	index.reserve(9);
+	CHECK(index.capacity() == 16);
+
+	// Interleaving the inserts makes robin hood placement move earlier entries out of the way
+	//
+	std::vector<zvfs::node*> stored;
+	for (size_t i = 0; i < 6; i++)
+	{
+		stored.push_back(chain[i]);
+		if (i < 3)
+			stored.push_back(neighbours[i]);
+	}
+
+	for (zvfs::node* it : stored)
+		index.insert(it);
+
+	auto contains = [&index](zvfs::node* entry)
+	{
+		return index.find(entry->hash(), [entry](zvfs::node* candidate) { return candidate == entry; }) == entry;
+	};
+
+	CHECK(index.size() == stored.size());
+	for (zvfs::node* it : stored)
+		CHECK(contains(it));
+
+	// Removing from the middle of the chain shifts the rest back, nothing may get lost behind the gap
+	//
+	CHECK(index.erase(chain[2]));
+	CHECK(!contains(chain[2]));
+	CHECK(!index.erase(chain[2]));
+
+	CHECK(index.erase(neighbours[0]));
+	CHECK(index.erase(chain[0]));
+
+	std::erase_if(stored, [&](zvfs::node* it) { return it == chain[2] || it == chain[0] || it == neighbours[0]; });
+
+	CHECK(index.size() == stored.size());
+	for (zvfs::node* it : stored)
+		CHECK(contains(it));
+
+	// Every remaining node is visited exactly once
+	//
+	std::vector<zvfs::node*> visited(index.begin(), index.end());
+	std::sort(visited.begin(), visited.end());
+	std::sort(stored.begin(), stored.end());
+	CHECK(visited == stored);
+
+	// Reinserted nodes find their place in the shifted chain again
+	//
+	index.insert(chain[2]);
+	index.insert(chain[0]);
+	CHECK(contains(chain[2]));
+	CHECK(contains(chain[0]));
+	for (zvfs::node* it : stored)
+		CHECK(contains(it));
+}
+
+
+DOCTEST_TEST_CASE("vfs case folding and path hashing")
+{
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	CHECK(vfs->add("Folder1/SubFolder/File.PNG") != nullptr);
+
+	// Lowercase mode has to resolve any casing to the same node, including the parents
+	//
+	auto node = vfs->get("folder1/subfolder/file.png");
+	CHECK(node != nullptr);
+	CHECK(node == vfs->get("FOLDER1/SUBFOLDER/FILE.PNG"));
+	CHECK(node->parent() == vfs->get("fOlDeR1/subFOLDER/"));
+
+	// Registering the same path in a different casing must not create a new node
+	//
+	auto size_before = vfs->size();
+	CHECK(vfs->add("folder1/subfolder/file.png") != nullptr);
+	CHECK(vfs->size() == size_before);
+
+	std::vector<zvfs::node*> nodes;
+	CHECK(vfs->find(".png", nodes) == 1);
+
+	CHECK(vfs->remove("FOLDER1/subfolder/FILE.png") == true);
+	CHECK(vfs->get("folder1/subfolder/file.png") == nullptr);
+
+	delete vfs;
+
+	// Feeding a path in pieces must produce the same digest as hashing it at once
+	// The lengths cover the scalar tail, the 8 byte words and the 16 byte vector path
+	//
+	std::string long_path = "Some/Deeply/Nested/Folder/Structure/With/A/File_Name-0123456789.Extension";
+	for (size_t length = 0; length <= long_path.size(); length++)
+	{
+		std::string_view input = std::string_view(long_path).substr(0, length);
+		size_t expected = zvfs::path_hasher::hash(input, true, true);
+
+		for (size_t split = 0; split <= length; split++)
+		{
+			zvfs::path_hasher hasher(true, true);
+			hasher.update(input.substr(0, split));
+			hasher.update(input.substr(split));
+			CHECK(hasher.digest() == expected);
+		}
+
+		CHECK(expected != static_cast<size_t>(-1));
+	}
+
+	// Folding must match between the different code paths
+	//
+	CHECK(zvfs::path_hasher::hash(long_path, true, true) == zvfs::path_hasher::hash("some/deeply/nested/folder/structure/with/a/file_name-0123456789.extension", true, true));
+	CHECK(zvfs::path_hasher::hash(long_path, false, true) != zvfs::path_hasher::hash("some/deeply/nested/folder/structure/with/a/file_name-0123456789.extension", false, true));
+
+	// Illegal characters have to be detected at any position
+	//
+	for (size_t position = 0; position < long_path.size(); position++)
+	{
+		std::string illegal = long_path;
+		illegal[position] = '\x80';
+		CHECK(zvfs::path_hasher::hash(illegal, true, true) == static_cast<size_t>(-1));
+		CHECK(zvfs::path_hasher::hash(illegal, true, false) != static_cast<size_t>(-1));
+
+		illegal[position] = '\n';
+		CHECK(zvfs::path_hasher::hash(illegal, true, true) == static_cast<size_t>(-1));
+	}
+}
+
+
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+	size_t m_allocated = 0;
+	size_t m_allocations = 0;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		this->m_allocated += bytes;
+		this->m_allocations++;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override
+	{
+		this->m_allocated -= bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+DOCTEST_TEST_CASE("vfs memory resource")
+{
+	counting_resource resource;
+
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings, &resource);
+
+	for (size_t i = 0; i < 32; i++)
+	{
+		for (size_t j = 0; j < 32; j++)
+		{
+			auto entry = vfs->add("folder" + std::to_string(i) + "/a_rather_long_file_name_that_does_not_fit_sso_" + std::to_string(j) + ".png");
+			CHECK(entry != nullptr);
+			*entry = new test_file();
+		}
+	}
+
+	// Internal allocations have to be served by the supplied resource,
+	// the pool requests large blocks so there are far less upstream calls than entries
+	//
+	CHECK(resource.m_allocated > 0);
+	CHECK(resource.m_allocations < vfs->size());
+
+	CHECK(vfs->remove("folder0/", true) == true);
+
+	g_has_destructor_been_called_at_least_once = false;
+	delete vfs;
+
+	// Teardown still has to destroy user data, and return every byte to the upstream resource
+	//
+	CHECK(g_has_destructor_been_called_at_least_once == true);
+	CHECK(resource.m_allocated == 0);
+}
+
+
+DOCTEST_TEST_CASE("vfs compact node paths")
+{
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	CHECK(vfs->add("Assets/Textures/UI/button.png") != nullptr);
+	CHECK(vfs->add("Assets/Models/UI/button.png") != nullptr);
+
+	auto node = vfs->get("assets/models/ui/button.png");
+	CHECK(node != nullptr);
+
+	// Nodes keep only their own component, the full path keeps the original spelling
+	//
+	CHECK(bool(node->name() == "button.png"));
+	CHECK(bool(node->parent()->name() == "UI/"));
+	CHECK(bool(node->parent()->parent()->path() == "Assets/Models/"));
+	CHECK(bool(node->path() == "Assets/Models/UI/button.png"));
+
+	// Repeated components share their storage
+	//
+	auto other = vfs->get("assets/textures/ui/button.png");
+	CHECK(other != nullptr);
+	CHECK(node->name().data() == other->name().data());
+	CHECK(node->parent()->name().data() == other->parent()->name().data());
+
+	CHECK(other->path_equals("assets/textures/ui/button.png", true));
+	CHECK(!other->path_equals("assets/textures/ui/button.png", false));
+	CHECK(!other->path_equals("Assets/Models/UI/button.png", true));
+
+	delete vfs;
+}
+
+
+DOCTEST_TEST_CASE("vfs directory child lookup")
+{
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	// Large enough to switch the directory over to its hashed name index
+	//
+	constexpr size_t file_count = 2000;
+	for (size_t i = 0; i < file_count; i++)
+		CHECK(vfs->add("cache/Entry" + std::to_string(i) + ".bin") != nullptr);
+
+	CHECK(vfs->add("cache/nested/") != nullptr);
+
+	auto folder = vfs->get("cache/");
+	CHECK(folder != nullptr);
+	CHECK(folder->m_dir->size() == file_count + 1);
+
+	CHECK(folder->m_dir->find_child("entry17.bin") == vfs->get("cache/entry17.bin"));
+	CHECK(folder->m_dir->find_child("nested/") == vfs->get("cache/nested/"));
+	CHECK(folder->m_dir->find_child("nested") == nullptr);
+	CHECK(folder->m_dir->find_child("entry2000.bin") == nullptr);
+
+	// Remove every odd entry, swap and pop reorders the children but lookups have to stay intact
+	//
+	for (size_t i = 1; i < file_count; i += 2)
+		CHECK(vfs->remove("cache/entry" + std::to_string(i) + ".bin") == true);
+
+	CHECK(folder->m_dir->size() == (file_count / 2) + 1);
+
+	for (size_t i = 0; i < file_count; i++)
+	{
+		auto child = folder->m_dir->find_child("entry" + std::to_string(i) + ".bin");
+		CHECK((child != nullptr) == ((i % 2) == 0));
+	}
+
+	// Children have to be linked back to this directory
+	//
+	for (auto it : *folder->m_dir)
+		CHECK(it->parent() == folder);
+
+	// Shrinking the directory drops the name index, lookups fall back to scanning
+	//
+	for (size_t i = 2; i < file_count; i += 2)
+		CHECK(vfs->remove("cache/entry" + std::to_string(i) + ".bin") == true);
+
+	CHECK(folder->m_dir->size() == 2);
+	CHECK(folder->m_dir->find_child("entry0.bin") != nullptr);
+	CHECK(folder->m_dir->find_child("NESTED/") != nullptr);
+
+	CHECK(vfs->remove("cache/", true) == true);
+	CHECK(vfs->size() == 1);
+
+	delete vfs;
+}
+
+
+DOCTEST_TEST_CASE("vfs bulk insertion")
+{
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	// Pre-existing nodes have to be picked up by the bulk insertion
+	//
+	CHECK(vfs->add("textures/ui/") != nullptr);
+
+	std::vector<std::string> storage = {
+		"textures/ui/button.png",
+		"models/hero/lod0.mesh",
+		"textures/ui/Button.png",
+		"textures/world/grass.png",
+		"",
+		"models/hero/",
+		"models/hero/lod1.mesh",
+		"textures-old/ui/button.png",
+		"readme.txt",
+		"models/hero/lod0.mesh",
+		"models/villain/lod0.mesh"
+	};
+
+	// Add an illegal path into the middle of the batch
+	//
+	storage.push_back(std::string("textures/\x80.png"));
+
+	std::vector<std::string_view> paths(storage.begin(), storage.end());
+	std::vector<zvfs::node_data**> slots;
+
+	CHECK(vfs->add_bulk(paths, slots) == paths.size() - 1);
+	CHECK(slots.size() == paths.size());
+	CHECK(slots.back() == nullptr);
+
+	// root, textures/, textures/ui/, button.png, textures/world/, grass.png, models/, models/hero/,
+	// lod0.mesh, lod1.mesh, textures-old/, textures-old/ui/, button.png, readme.txt, models/villain/, lod0.mesh
+	//
+	CHECK(vfs->size() == 16);
+
+	// Duplicates, including the ones that only differ in case, share their slot
+	//
+	CHECK(slots[0] == slots[2]);
+	CHECK(slots[1] == slots[9]);
+
+	// The slots are the same add() hands out, and the hierarchy is linked up
+	//
+	for (size_t i = 0; i + 1 < paths.size(); i++)
+	{
+		CHECK(slots[i] != nullptr);
+		CHECK(slots[i] == vfs->add(paths[i]));
+
+		auto node = vfs->get(paths[i]);
+		CHECK(node != nullptr);
+		CHECK(node->path_equals(paths[i], true));
+
+		if (!node->m_is_root)
+			CHECK(node->parent()->m_dir->find_child(node->name()) == node);
+	}
+
+	CHECK(vfs->size() == 16);
+	CHECK(vfs->get("textures/")->m_dir->size() == 2);
+	CHECK(vfs->get("models/hero/")->m_dir->size() == 2);
+
+	*slots[0] = new test_file();
+
+	g_has_destructor_been_called_at_least_once = false;
+	delete vfs;
+	CHECK(g_has_destructor_been_called_at_least_once == true);
+}
+
+
+DOCTEST_TEST_CASE("vfs deep path insertion")
+{
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	// Deeper than the inline prefix buffer of add()
+	//
+	std::string deep_path;
+	for (size_t i = 0; i < 40; i++)
+		deep_path += "Level" + std::to_string(i) + "/";
+
+	std::string deep_file = deep_path + "file.txt";
+	CHECK(vfs->add(deep_file) != nullptr);
+	CHECK(vfs->size() == 42);
+
+	// Every prefix has been registered with the same hash get() computes
+	//
+	auto node = vfs->get(deep_file);
+	CHECK(node != nullptr);
+	CHECK(node->m_is_file);
+
+	size_t depth = 0;
+	for (auto it = node->parent(); !it->m_is_root; it = it->parent())
+	{
+		CHECK(vfs->get(it->path()) == it);
+		CHECK(!it->m_is_file);
+		depth++;
+	}
+
+	CHECK(depth == 40);
+
+	// Only the missing tail below the deepest existing ancestor gets created
+	//
+	CHECK(vfs->add("level0/level1/other/file.txt") != nullptr);
+	CHECK(vfs->size() == 44);
+	CHECK(vfs->get("level0/level1/other/")->parent() == vfs->get("level0/level1/"));
+
+	CHECK(vfs->add(deep_path + "\x01") == nullptr);
+	CHECK(vfs->size() == 44);
+
+	delete vfs;
+}
+
+
+DOCTEST_TEST_CASE("vfs prefix listing")
+{
+	std::vector<std::string> simulated_fs = {
+		"textures/ui/button_ok.png",
+		"textures/ui/Button_cancel.png",
+		"textures/ui/icons/save.png",
+		"textures/ui.cfg",
+		"textures/ui-old/button_ok.png",
+		"textures/world/grass.png",
+		"models/hero.mesh",
+		"readme.txt"
+	};
+
+	zvfs::vfs_settings indexed_settings(true, true, 255, true);
+	zvfs::vfs* indexed = new zvfs::vfs(indexed_settings);
+	zvfs::vfs* scanned = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	for (auto& it : simulated_fs)
+	{
+		CHECK(indexed->add(it) != nullptr);
+		CHECK(scanned->add(it) != nullptr);
+	}
+
+	auto check_listing = [&](std::string_view prefix, std::vector<std::string_view> expected)
+	{
+		std::vector<zvfs::node*> indexed_nodes;
+		std::vector<zvfs::node*> scanned_nodes;
+
+		CHECK(indexed->list_prefix(prefix, indexed_nodes) == expected.size());
+		CHECK(scanned->list_prefix(prefix, scanned_nodes) == expected.size());
+
+		// Both strategies have to agree on content and order
+		//
+		for (size_t i = 0; i < expected.size() && i < indexed_nodes.size() && i < scanned_nodes.size(); i++)
+		{
+			CHECK(indexed_nodes[i]->path_equals(expected[i], true));
+			CHECK(scanned_nodes[i]->path_equals(expected[i], true));
+		}
+	};
+
+	check_listing("textures/ui/", { "textures/ui/", "textures/ui/button_cancel.png", "textures/ui/button_ok.png", "textures/ui/icons/", "textures/ui/icons/save.png" });
+	check_listing("Textures/UI/Button", { "textures/ui/button_cancel.png", "textures/ui/button_ok.png" });
+	check_listing("textures/ui", { "textures/ui-old/", "textures/ui-old/button_ok.png", "textures/ui.cfg", "textures/ui/", "textures/ui/button_cancel.png", "textures/ui/button_ok.png", "textures/ui/icons/", "textures/ui/icons/save.png" });
+	check_listing("textures/missing", {});
+	check_listing("missing/", {});
+	check_listing("readme.txt", { "readme.txt" });
+
+	// An empty prefix lists every node in order, starting with the root
+	//
+	std::vector<zvfs::node*> all_nodes;
+	CHECK(indexed->list_prefix("", all_nodes) == indexed->size());
+	CHECK(all_nodes[0]->m_is_root);
+	for (size_t i = 2; i < all_nodes.size(); i++)
+		CHECK(zvfs::path::compare(all_nodes[i - 1]->path(), all_nodes[i]->path(), true) < 0);
+
+	// Removal has to keep the radix tree in sync
+	//
+	CHECK(indexed->remove("textures/ui/", true) == true);
+	CHECK(scanned->remove("textures/ui/", true) == true);
+	check_listing("textures/ui", { "textures/ui-old/", "textures/ui-old/button_ok.png", "textures/ui.cfg" });
+
+	CHECK(indexed->add("textures/ui/button_ok.png") != nullptr);
+	CHECK(scanned->add("textures/ui/button_ok.png") != nullptr);
+	check_listing("textures/ui/", { "textures/ui/", "textures/ui/button_ok.png" });
+
+	delete indexed;
+	delete scanned;
+}
+
+
+DOCTEST_TEST_CASE("vfs trigram accelerated find")
+{
+	zvfs::vfs_settings indexed_settings(true, true, 255, false, true);
+	zvfs::vfs* indexed = new zvfs::vfs(indexed_settings);
+	zvfs::vfs* scanned = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	for (size_t i = 0; i < 300; i++)
+	{
+		std::string path = "Assets/Chunk" + std::to_string(i % 17) + "/Entity_" + std::to_string(i) + (i % 3 ? ".Mesh" : ".texture");
+		CHECK(indexed->add(path) != nullptr);
+		CHECK(scanned->add(path) != nullptr);
+	}
+
+	auto check_query = [&](std::string_view filter)
+	{
+		std::vector<zvfs::node*> indexed_nodes;
+		std::vector<zvfs::node*> scanned_nodes;
+
+		CHECK(indexed->find(filter, indexed_nodes) == scanned->find(filter, scanned_nodes));
+
+		// The candidate lists have to be verified, order is unspecified
+		//
+		std::vector<std::string> indexed_paths;
+		std::vector<std::string> scanned_paths;
+		for (auto it : indexed_nodes)
+			indexed_paths.emplace_back(it->path());
+		for (auto it : scanned_nodes)
+			scanned_paths.emplace_back(it->path());
+
+		std::sort(indexed_paths.begin(), indexed_paths.end());
+		std::sort(scanned_paths.begin(), scanned_paths.end());
+		CHECK(indexed_paths == scanned_paths);
+
+		return indexed_nodes.size();
+	};
+
+	CHECK(check_query(".texture") == 100);
+	CHECK(check_query("ENTITY_1") == 111);
+	CHECK(check_query("chunk1/") == 18 + 1);
+	CHECK(check_query("k16/entity_288") == 1);
+	CHECK(check_query("mesh/") == 0);
+	CHECK(check_query("zzz") == 0);
+
+	// Short filters fall back to the scan
+	//
+	CHECK(check_query("/") == indexed->size() - 1);
+	CHECK(check_query("") == indexed->size());
+
+	// Removed nodes must disappear from the results
+	//
+	CHECK(indexed->remove("assets/chunk16/", true) == true);
+	CHECK(scanned->remove("assets/chunk16/", true) == true);
+	CHECK(check_query("k16/entity_288") == 0);
+	CHECK(check_query(".texture") == 94);
+
+	// Enough removals trigger a rebuild of the posting lists
+	//
+	for (size_t i = 0; i < 5000; i++)
+	{
+		std::string path = "temp/file_" + std::to_string(i) + ".tmp";
+		CHECK(indexed->add(path) != nullptr);
+		CHECK(scanned->add(path) != nullptr);
+	}
+
+	CHECK(check_query("file_4999.tmp") == 1);
+	CHECK(indexed->remove("temp/", true) == true);
+	CHECK(scanned->remove("temp/", true) == true);
+	CHECK(check_query(".tmp") == 0);
+	CHECK(check_query("ENTITY_1") == 104);
+
+	delete indexed;
+	delete scanned;
+}
+
+
+DOCTEST_TEST_CASE("vfs glob matching")
+{
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < 40; i++)
+	{
+		paths.push_back("Assets/Props/Lod" + std::to_string(i % 4) + "/Rock_" + std::to_string(i) + ".png");
+		paths.push_back("assets/props/lod" + std::to_string(i % 4) + "/rock_" + std::to_string(i) + ".dds");
+		paths.push_back("assets/chars/hero/lod" + std::to_string(i % 3) + "/body_" + std::to_string(i) + ".png");
+	}
+
+	paths.push_back("assets/readme.txt");
+	paths.push_back("assets/lod9/top.png");
+	paths.push_back("shaders/common/lighting.hlsl");
+	paths.push_back("shaders/empty/");
+
+	for (const std::string& it : paths)
+		CHECK(vfs->add(it) != nullptr);
+
+	std::vector<zvfs::node*> all_nodes;
+	CHECK(vfs->list_prefix("", all_nodes) == vfs->size());
+
+	// Every traversal result has to agree with matching each path on its own
+	//
+	auto check_glob = [&](std::string_view pattern)
+	{
+		zvfs::glob_pattern compiled(pattern, true);
+		CHECK(compiled.valid());
+
+		std::vector<std::string> expected;
+		for (zvfs::node* it : all_nodes)
+		{
+			if (it != vfs->get(""))
+			{
+				if (compiled.match(it->path()))
+					expected.emplace_back(it->path());
+			}
+		}
+
+		std::vector<zvfs::node*> found_nodes;
+		CHECK(vfs->glob(pattern, found_nodes) == expected.size());
+
+		std::vector<std::string> found;
+		for (zvfs::node* it : found_nodes)
+			found.emplace_back(it->path());
+
+		std::sort(expected.begin(), expected.end());
+		std::sort(found.begin(), found.end());
+		CHECK(found == expected);
+
+		return found.size();
+	};
+
+	CHECK(check_glob("assets/props/lod1/rock_5.png") == 1);
+	CHECK(check_glob("assets/props/lod?/*.png") == 40);
+	CHECK(check_glob("ASSETS/**/lod?/*.png") == 81);
+	CHECK(check_glob("assets/**/*.png") == 81);
+	CHECK(check_glob("assets/props/lod[02]/*.{png,dds}") == 40);
+	CHECK(check_glob("assets/props/lod[!02]/rock_1?.*") == 10);
+	CHECK(check_glob("{assets/props,assets/chars/hero}/lod0/") == 2);
+	CHECK(check_glob("{assets/props,assets/props/lod0}/**/rock_0.*") == 2);
+	CHECK(check_glob("assets/*/") == 3);
+	CHECK(check_glob("assets/*") == 4);
+	CHECK(check_glob("shaders/**") == 4);
+	CHECK(check_glob("**/lighting.hlsl") == 1);
+	CHECK(check_glob("**/") == 15);
+	CHECK(check_glob("assets/props/lod1/rock_5") == 0);
+	CHECK(check_glob("textures/**") == 0);
+
+	// Full path matching on its own
+	//
+	zvfs::glob_pattern exact("a/[b-d]*/{x,y{1,2}}.txt", false);
+	CHECK(exact.valid());
+	CHECK(exact.match("a/banana/x.txt"));
+	CHECK(exact.match("a/c/y2.txt"));
+	CHECK(!exact.match("a/C/y2.txt"));
+	CHECK(!exact.match("a/e/x.txt"));
+	CHECK(!exact.match("a/b/y.txt"));
+	CHECK(!exact.match("a/b/sub/x.txt"));
+
+	zvfs::glob_pattern directories("a/**/", false);
+	CHECK(directories.match("a/b/c/"));
+	CHECK(!directories.match("a/b/c"));
+
+	std::vector<zvfs::node*> found_nodes;
+	CHECK(vfs->glob("", found_nodes) == static_cast<size_t>(-1));
+	CHECK(vfs->glob("assets/{props", found_nodes) == static_cast<size_t>(-1));
+	CHECK(vfs->glob("assets/[ab", found_nodes) == static_cast<size_t>(-1));
+	CHECK(vfs->glob("{a,b}{c,d}{e,f}{g,h}{i,j}{k,l}{m,n}{o,p}{q,r}{s,t}{u,v}", found_nodes) == static_cast<size_t>(-1));
+
+	delete vfs;
+}
+
+
+DOCTEST_TEST_CASE("vfs parallel find")
+{
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	for (size_t i = 0; i < 2000; i++)
+		CHECK(vfs->add("Data/Set" + std::to_string(i % 13) + "/Item_" + std::to_string(i) + (i % 5 ? ".bin" : ".json")) != nullptr);
+
+	for (size_t threads : { 1, 3, 8 })
+	{
+		zvfs::thread_pool pool(threads);
+		CHECK(pool.size() == threads);
+
+		for (std::string_view filter : { "", ".JSON", "set7/", "item_1", "/", "missing" })
+		{
+			std::vector<zvfs::node*> sequential_nodes;
+			std::vector<zvfs::node*> parallel_nodes;
+
+			CHECK(vfs->find(filter, parallel_nodes, pool) == vfs->find(filter, sequential_nodes));
+
+			std::sort(sequential_nodes.begin(), sequential_nodes.end());
+			std::sort(parallel_nodes.begin(), parallel_nodes.end());
+			CHECK(parallel_nodes == sequential_nodes);
+		}
+
+		// Sorted results come out in the same order as a prefix listing
+		//
+		std::vector<zvfs::node*> sorted_nodes;
+		std::vector<zvfs::node*> listed_nodes;
+		CHECK(vfs->find("", sorted_nodes, pool, true) == vfs->size());
+		CHECK(vfs->list_prefix("", listed_nodes) == vfs->size());
+		CHECK(sorted_nodes == listed_nodes);
+	}
+
+	// Tasks may spawn further tasks, the first exception reaches wait()
+	//
+	zvfs::thread_pool pool(4);
+	std::atomic<size_t> counter = 0;
+
+	for (size_t i = 0; i < 16; i++)
+	{
+		pool.submit([&pool, &counter]()
+		{
+			for (size_t j = 0; j < 16; j++)
+				pool.submit([&counter]() { counter++; });
+		});
+	}
+
+	pool.wait();
+	CHECK(counter == 256);
+
+	pool.submit([]() { throw std::runtime_error("task failed"); });
+	CHECK_THROWS_AS(pool.wait(), std::runtime_error);
+	CHECK_NOTHROW(pool.wait());
+
+	delete vfs;
+}
+
+
+DOCTEST_TEST_CASE("vfs streaming matches")
+{
+	for (bool substring_index : { false, true })
+	{
+		zvfs::vfs_settings settings(true, true, 255, false, substring_index);
+		zvfs::vfs* vfs = new zvfs::vfs(settings);
+
+		for (size_t i = 0; i < 500; i++)
+			CHECK(vfs->add("Levels/Zone" + std::to_string(i % 7) + "/Tile_" + std::to_string(i) + ".map") != nullptr);
+
+		// The lazy range yields the same nodes in the same order as find
+		//
+		for (std::string_view filter : { "", "zone3/", "TILE_4", ".map", "nothing" })
+		{
+			std::vector<zvfs::node*> found_nodes;
+			CHECK(vfs->find(filter, found_nodes) != static_cast<size_t>(-1));
+
+			std::vector<zvfs::node*> streamed_nodes;
+			for (zvfs::node* it : vfs->matches(filter))
+				streamed_nodes.push_back(it);
+
+			CHECK(streamed_nodes == found_nodes);
+
+			std::vector<zvfs::node*> visited_nodes;
+			CHECK(vfs->for_each_match(filter, [&visited_nodes](zvfs::node* entry)
+			{
+				visited_nodes.push_back(entry);
+				return true;
+			}) == found_nodes.size());
+
+			CHECK(visited_nodes == found_nodes);
+		}
+
+		// Stopping early only reports the nodes seen so far
+		//
+		size_t calls = 0;
+		CHECK(vfs->for_each_match(".map", [&calls](zvfs::node*)
+		{
+			return ++calls < 3;
+		}) == 3);
+		CHECK(calls == 3);
+
+		auto range = vfs->matches("tile_42");
+		auto it = range.begin();
+		CHECK(it != range.end());
+		CHECK(zvfs::path::contains((*it)->path(), "tile_42", true));
+		++it;
+		CHECK(it != range.end());
+
+		auto empty_range = vfs->matches("missing");
+		CHECK(empty_range.begin() == empty_range.end());
+
+		delete vfs;
+	}
+}
+
+
+DOCTEST_TEST_CASE("vfs thread safe mode")
+{
+	zvfs::vfs_settings settings(true, true, 255, true, true, true);
+	zvfs::vfs* vfs = new zvfs::vfs(settings);
+
+	for (size_t i = 0; i < 1000; i++)
+		CHECK(vfs->add("stable/dir" + std::to_string(i % 10) + "/file_" + std::to_string(i)) != nullptr);
+
+	// Readers only touch the stable part of the tree while a writer keeps adding and removing next to it
+	//
+	std::atomic<bool> failed = false;
+	std::vector<std::thread> readers;
+
+	for (size_t thread = 0; thread < 4; thread++)
+	{
+		readers.emplace_back([vfs, thread, &failed]()
+		{
+			std::vector<zvfs::node*> found_nodes;
+
+			for (size_t i = 0; i < 2000; i++)
+			{
+				size_t index = (i * 7 + thread) % 1000;
+				std::string path = "stable/dir" + std::to_string(index % 10) + "/file_" + std::to_string(index);
+
+				zvfs::node* entry = vfs->get(path);
+				if (!entry || entry->path() != path)
+					failed = true;
+
+				if (i % 200 == 0)
+				{
+					if (vfs->find("dir3/file_", found_nodes) != 100)
+						failed = true;
+
+					if (vfs->list_prefix("stable/dir4/", found_nodes) != 101)
+						failed = true;
+				}
+			}
+		});
+	}
+
+	for (size_t i = 0; i < 500; i++)
+	{
+		std::string path = "volatile/batch" + std::to_string(i % 5) + "/item_" + std::to_string(i);
+		CHECK(vfs->add(path) != nullptr);
+
+		if (i % 50 == 49)
+			CHECK(vfs->remove("volatile/", true));
+	}
+
+	for (std::thread& it : readers)
+		it.join();
+
+	CHECK(!failed);
+	CHECK(vfs->size() == 1000 + 10 + 1 + 1);
+
+	delete vfs;
+}
+
+
+DOCTEST_TEST_CASE("vfs lock-free lookups")
+{
+	// Retired objects wait for every reader that pinned an older epoch
+	//
+	{
+		zvfs::epoch_domain domain;
+		size_t freed = 0;
+		auto count_free = [](void* context, void*)
+		{
+			(*static_cast<size_t*>(context))++;
+		};
+
+		{
+			auto outer = domain.pin();
+			auto inner = domain.pin();
+
+			domain.retire(nullptr, count_free, &freed);
+			CHECK(domain.reclaim() == 0);
+			CHECK(domain.pending() == 1);
+		}
+
+		CHECK(domain.reclaim() == 1);
+		CHECK(freed == 1);
+
+		domain.retire(nullptr, count_free, &freed);
+		domain.flush();
+		CHECK(freed == 2);
+	}
+
+	zvfs::vfs_settings settings(true, true, 255, false, false, true);
+	zvfs::vfs* vfs = new zvfs::vfs(settings);
+
+	for (size_t i = 0; i < 64; i++)
+		CHECK(vfs->add("shared/entry_" + std::to_string(i)) != nullptr);
+
+	// Readers race against a writer that removes and re-adds the very nodes they look up
+	// and grows the index far enough to replace the slot array several times
+	//
+	std::atomic<bool> done = false;
+	std::atomic<bool> failed = false;
+	std::vector<std::thread> readers;
+
+	for (size_t thread = 0; thread < 3; thread++)
+	{
+		readers.emplace_back([vfs, thread, &done, &failed]()
+		{
+			for (size_t i = thread; !done; i++)
+			{
+				std::string path = "shared/entry_" + std::to_string(i % 64);
+
+				auto guard = vfs->pin();
+				zvfs::node* entry = vfs->get(path);
+				if (entry && (entry->path() != path || !entry->m_is_file))
+					failed = true;
+			}
+		});
+	}
+
+	for (size_t round = 0; round < 20; round++)
+	{
+		for (size_t i = 0; i < 64; i += 2)
+			CHECK(vfs->remove("shared/entry_" + std::to_string(i)));
+
+		for (size_t i = 0; i < 200; i++)
+			CHECK(vfs->add("growth/round_" + std::to_string(round) + "/item_" + std::to_string(i)) != nullptr);
+
+		for (size_t i = 0; i < 64; i += 2)
+			CHECK(vfs->add("shared/entry_" + std::to_string(i)) != nullptr);
+	}
+
+	done = true;
+	for (std::thread& it : readers)
+		it.join();
+
+	CHECK(!failed);
+	CHECK(vfs->size() == 1 + 1 + 64 + 1 + 20 + 20 * 200);
+
+	delete vfs;
+}
+
+DOCTEST_TEST_CASE("vfs concurrent adds")
+{
+	zvfs::vfs_settings settings(true, true, 255, true, true, true);
+	zvfs::vfs* vfs = new zvfs::vfs(settings);
+
+	// Every writer adds the same shared files plus a directory of its own, half of them in batches
+	// A searcher walks the hierarchy meanwhile
+	//
+	constexpr size_t writer_count = 4;
+	std::atomic<bool> done = false;
+	std::atomic<bool> failed = false;
+	std::vector<std::thread> threads;
+
+	for (size_t thread = 0; thread < writer_count; thread++)
+	{
+		threads.emplace_back([vfs, thread, &failed]()
+		{
+			std::vector<std::string> paths;
+			for (size_t i = 0; i < 400; i++)
+			{
+				size_t shuffled = (i * 7 + thread * 100) % 400;
+				paths.push_back("mount/dir_" + std::to_string(shuffled % 16) + "/shared_" + std::to_string(shuffled % 50) + ".bin");
+			}
+
+			for (size_t i = 0; i < 100; i++)
+				paths.push_back("mount/thread_" + std::to_string(thread) + "/file_" + std::to_string(i));
+
+			if (thread % 2)
+			{
+				std::vector<std::string_view> views(paths.begin(), paths.end());
+				std::vector<zvfs::node_data**> slots;
+				if (vfs->add_bulk(views, slots) != paths.size())
+					failed = true;
+			}
+			else
+			{
+				for (const std::string& it : paths)
+				{
+					if (!vfs->add(std::string_view(it)))
+						failed = true;
+				}
+			}
+		});
+	}
+
+	threads.emplace_back([vfs, &done, &failed]()
+	{
+		std::vector<zvfs::node*> nodes;
+		while (!done)
+		{
+			if (vfs->find("shared_", nodes) == static_cast<size_t>(-1) || vfs->glob("mount/dir_*/*.bin", nodes) == static_cast<size_t>(-1))
+				failed = true;
+		}
+	});
+
+	for (size_t i = 0; i < writer_count; i++)
+		threads[i].join();
+
+	done = true;
+	threads.back().join();
+
+	CHECK(!failed);
+	CHECK(vfs->size() == 1 + 1 + 16 + 400 + writer_count * 101);
+
+	// Racing adds of the same path must end up with one node that is linked exactly once
+	//
+	std::vector<zvfs::node*> nodes;
+	CHECK(vfs->find("", nodes) == vfs->size());
+
+	std::sort(nodes.begin(), nodes.end());
+	CHECK(std::adjacent_find(nodes.begin(), nodes.end()) == nodes.end());
+
+	CHECK(vfs->list_prefix("mount/dir_3/", nodes) == 1 + 25);
+	CHECK(vfs->find("shared_7.bin", nodes) == 8);
+	CHECK(vfs->glob("mount/thread_*/file_9?", nodes) == writer_count * 10);
+
+	for (size_t i = 0; i < 400; i++)
+	{
+		zvfs::node* entry = vfs->get("mount/dir_" + std::to_string(i % 16) + "/shared_" + std::to_string(i % 50) + ".bin");
+		CHECK((entry && entry->m_is_file));
+	}
+
+	delete vfs;
+}
+
+DOCTEST_TEST_CASE("vfs frozen snapshot")
+{
+	// Every key of the set gets its own slot, duplicates can't be placed
+	//
+	{
+		std::vector<uint64_t> keys;
+		for (uint64_t i = 0; i < 10000; i++)
+			keys.push_back(zvfs::path_hasher::hash("key_" + std::to_string(i), false, true));
+
+		std::vector<uint32_t> displacements;
+		std::vector<uint32_t> slots;
+		CHECK(zvfs::perfect_hash::build(keys, displacements, slots));
+		CHECK(displacements.size() == zvfs::perfect_hash::bucket_count(keys.size()));
+
+		std::vector<bool> used(keys.size(), false);
+		bool distinct = true;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			size_t slot = zvfs::perfect_hash::slot(keys[i], displacements[zvfs::perfect_hash::bucket(keys[i], displacements.size())], keys.size());
+			distinct = distinct && slot == slots[i] && !used[slot];
+			used[slot] = true;
+		}
+
+		CHECK(distinct);
+
+		keys.push_back(keys.front());
+		CHECK(!zvfs::perfect_hash::build(keys, displacements, slots));
+	}
+
+	zvfs::vfs* vfs = new zvfs::vfs(zvfs::settings::g_default_settings);
+
+	for (size_t i = 0; i < 3000; i++)
+	{
+		auto slot = vfs->add("data/pack_" + std::to_string(i % 7) + "/group_" + std::to_string(i % 31) + "/asset_" + std::to_string(i) + ".bin");
+		CHECK(slot != nullptr);
+		if (i == 42)
+			*slot = new test_file();
+	}
+
+	CHECK(vfs->add("data/empty/") != nullptr);
+
+	zvfs::frozen_vfs frozen = vfs->freeze();
+	CHECK(frozen.size() == vfs->size());
+	CHECK(frozen.root().path().empty());
+	CHECK(!frozen.root().parent());
+
+	// Every node is found with its own path, children are sorted and point back to their parent
+	//
+	std::vector<zvfs::node*> nodes;
+	CHECK(vfs->find("", nodes) == vfs->size());
+
+	bool consistent = true;
+	for (zvfs::node* it : nodes)
+	{
+		zvfs::frozen_entry entry = frozen.get(it->path());
+		consistent = consistent && entry && entry.path() == it->path() && entry.name() == it->name() && entry.is_file() == it->m_is_file;
+		if (!entry)
+			continue;
+
+		if (entry.parent())
+			consistent = consistent && entry.parent().path() == it->parent()->path();
+
+		if (!it->m_is_file)
+		{
+			consistent = consistent && entry.child_count() == (it->m_dir ? it->m_dir->size() : 0);
+			for (size_t i = 0; i < entry.child_count(); i++)
+			{
+				consistent = consistent && entry.child(i).parent().index() == entry.index();
+				if (i)
+					consistent = consistent && entry.child(i - 1).name() < entry.child(i).name();
+			}
+		}
+	}
+
+	CHECK(consistent);
+
+	CHECK(frozen.get("DATA/Pack_0/group_0/asset_0.bin"));
+	CHECK(frozen.get("data/empty/").child_count() == 0);
+	CHECK(!frozen.get("data/pack_1/group_0/asset_0.bin"));
+	CHECK(!frozen.get("data/pack_0"));
+	CHECK(!frozen.get("data/missing.bin"));
+	CHECK(frozen.get("data/pack_0/group_11/asset_42.bin").data() == vfs->get("data/pack_0/group_11/asset_42.bin")->m_file);
+	CHECK(!frozen.get("data/").data());
+
+	// A snapshot is independent of the vfs tree, it survives the vfs
+	//
+	zvfs::frozen_vfs moved = std::move(frozen);
+	delete vfs;
+
+	CHECK(moved.get("data/pack_3/group_3/asset_3.bin").is_file());
+	CHECK(moved.image_size() > 0);
+	CHECK(!frozen.get("data/"));
+	CHECK(frozen.size() == 0);
+}
+
+class offset_file : public zvfs::file
+{
+public:
+	offset_file(uint64_t offset, uint64_t size)
+		: m_offset(offset)
+		, m_size(size)
+	{
+	}
+
+	uint64_t m_offset;
+	uint64_t m_size;
+};
+
+DOCTEST_TEST_CASE("vfs save and load")
+{
+	std::filesystem::path file_path = std::filesystem::temp_directory_path() / "zvfs_save_test.bin";
+
+	zvfs::vfs* source = new zvfs::vfs(zvfs::settings::g_default_settings);
+	for (size_t i = 0; i < 2000; i++)
+	{
+		auto slot = source->add("Content/Pack_" + std::to_string(i % 5) + "/group_" + std::to_string(i % 17) + "/asset_" + std::to_string(i) + ".bin");
+		CHECK(slot != nullptr);
+		*slot = new offset_file(i * 512, i);
+	}
+
+	CHECK(source->add("content/empty/") != nullptr);
+	CHECK(source->add("content/no_data.txt") != nullptr);
+
+	// Descriptors are opaque to the vfs, these store where the file data would live in an archive
+	//
+	auto writer = [](zvfs::node* entry, std::vector<std::byte>& out_descriptor)
+	{
+		offset_file* data = static_cast<offset_file*>(entry->m_file);
+		if (!data)
+			return;
+
+		out_descriptor.resize(sizeof(uint64_t) * 2);
+		std::memcpy(out_descriptor.data(), &data->m_offset, sizeof(uint64_t));
+		std::memcpy(out_descriptor.data() + sizeof(uint64_t), &data->m_size, sizeof(uint64_t));
+	};
+
+	auto reader = [](zvfs::node*, std::span<const std::byte> descriptor) -> zvfs::file*
+	{
+		if (descriptor.size() != sizeof(uint64_t) * 2)
+			return nullptr;
+
+		uint64_t values[2];
+		std::memcpy(values, descriptor.data(), sizeof(values));
+		return new offset_file(values[0], values[1]);
+	};
+
+	CHECK(source->save(file_path, writer));
+
+	zvfs::vfs_settings indexed_settings(true, true, 255, true, true, false);
+	zvfs::vfs* restored = new zvfs::vfs(indexed_settings);
+	CHECK(restored->load(file_path, reader));
+	CHECK(restored->size() == source->size());
+
+	// Restored nodes are found through the stored hashes and keep their data and spelling
+	//
+	std::vector<zvfs::node*> nodes;
+	CHECK(source->find("", nodes) == source->size());
+
+	bool consistent = true;
+	for (zvfs::node* it : nodes)
+	{
+		zvfs::node* entry = restored->get(it->path());
+		consistent = consistent && entry && entry->path() == it->path() && entry->m_is_file == it->m_is_file;
+		if (!entry || !it->m_is_file)
+			continue;
+
+		offset_file* expected = static_cast<offset_file*>(it->m_file);
+		offset_file* actual = static_cast<offset_file*>(entry->m_file);
+		if (expected)
+			consistent = consistent && actual && actual->m_offset == expected->m_offset && actual->m_size == expected->m_size;
+		else
+			consistent = consistent && !actual;
+	}
+
+	CHECK(consistent);
+	CHECK(restored->get("content/pack_3/group_3/asset_3.bin") != nullptr);
+
+	std::vector<zvfs::node*> expected_nodes;
+	CHECK(restored->list_prefix("content/pack_2/", nodes) == source->list_prefix("content/pack_2/", expected_nodes));
+	CHECK(restored->find("asset_19", nodes) == source->find("asset_19", expected_nodes));
+
+	// The restored tree is a regular vfs
+	//
+	CHECK(restored->add("content/pack_0/new.bin") != nullptr);
+	CHECK(restored->remove("content/pack_1/", true));
+
+	// Loading needs an empty vfs with matching settings and an intact file
+	//
+	CHECK(!restored->load(file_path, reader));
+
+	zvfs::vfs_settings case_settings(false, true, 255, false, false, false);
+	zvfs::vfs case_sensitive(case_settings);
+	CHECK(!case_sensitive.load(file_path, reader));
+	CHECK(case_sensitive.size() == 1);
+
+	// Paths longer than m_max_path are accepted by add and survive a round trip
+	//
+	std::string long_path = "dir/" + std::string(300, 'a');
+	zvfs::vfs long_source;
+	CHECK(long_source.add(long_path) != nullptr);
+	CHECK(long_source.save(file_path));
+
+	zvfs::vfs long_paths;
+	CHECK(long_paths.load(file_path));
+	CHECK(long_paths.size() == long_source.size());
+	CHECK(long_paths.get(long_path) != nullptr);
+
+	CHECK(source->save(file_path, writer));
+
+	// Damaged bytes fail the checksum, a consistent checksum doesn't get duplicate siblings past the structural checks
+	// The header is 48 bytes, records are 32 bytes each, records 2 and 3 are both children of "content/"
+	//
+	std::vector<char> image(std::filesystem::file_size(file_path));
+	std::ifstream(file_path, std::ios_base::binary).read(image.data(), static_cast<std::streamsize>(image.size()));
+
+	auto store = [&file_path](const std::vector<char>& bytes)
+	{
+		std::ofstream(file_path, std::ios_base::binary | std::ios_base::trunc).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	};
+
+	std::vector<char> damaged = image;
+	damaged[damaged.size() / 2] ^= 0x10;
+	store(damaged);
+
+	zvfs::vfs flipped;
+	CHECK(!flipped.load(file_path, reader));
+	CHECK(flipped.size() == 1);
+
+	std::vector<char> duplicated = image;
+	std::memcpy(duplicated.data() + 48 + 3 * 32, duplicated.data() + 48 + 2 * 32, 32);
+
+	uint64_t checksum = zvfs::path_hasher(false, false, 0x5346565A).update(std::string_view(duplicated.data() + 48, duplicated.size() - 48)).digest();
+	std::memcpy(duplicated.data() + 40, &checksum, sizeof(checksum));
+	store(duplicated);
+
+	zvfs::vfs duplicates;
+	CHECK(!duplicates.load(file_path, reader));
+	CHECK(duplicates.size() == 1);
+
+	store(image);
+	zvfs::vfs intact;
+	CHECK(intact.load(file_path, reader));
+
+	std::filesystem::resize_file(file_path, std::filesystem::file_size(file_path) - 1);
+	zvfs::vfs truncated;
+	CHECK(!truncated.load(file_path, reader));
+	CHECK(truncated.size() == 1);
+
+	CHECK(!truncated.load(file_path.string() + ".missing"));
+
+	std::filesystem::remove(file_path);
+	delete restored;
+	delete source;
+}
+
+DOCTEST_TEST_CASE("vfs mapped snapshot")
+{
+	std::filesystem::path file_path = std::filesystem::temp_directory_path() / "zvfs_mapped_test.bin";
+
+	zvfs::vfs* source = new zvfs::vfs(zvfs::settings::g_default_settings);
+	for (size_t i = 0; i < 2000; i++)
+	{
+		auto slot = source->add("Content/Pack_" + std::to_string(i % 5) + "/asset_" + std::to_string(i) + ".bin");
+		CHECK(slot != nullptr);
+		if (i % 2)
+			*slot = new offset_file(i * 512, i);
+	}
+
+	auto writer = [](zvfs::node* entry, std::vector<std::byte>& out_descriptor)
+	{
+		offset_file* data = static_cast<offset_file*>(entry->m_file);
+		if (!data)
+			return;
+
+		out_descriptor.resize(sizeof(uint64_t));
+		std::memcpy(out_descriptor.data(), &data->m_offset, sizeof(uint64_t));
+	};
+
+	zvfs::frozen_vfs frozen = source->freeze(writer);
+	CHECK(frozen.save(file_path));
+	CHECK(std::filesystem::file_size(file_path) == frozen.image_size());
+
+	// The mapped image answers like the snapshot it was saved from, paths point into the mapping
+	//
+	zvfs::frozen_vfs mapped;
+	CHECK(mapped.map(file_path));
+	CHECK(mapped.size() == frozen.size());
+	CHECK(mapped.image_size() == frozen.image_size());
+
+	bool consistent = true;
+	for (size_t i = 0; i < frozen.size(); i++)
+	{
+		zvfs::frozen_entry expected = frozen.at(i);
+		zvfs::frozen_entry entry = mapped.get(expected.path());
+		consistent = consistent && entry && entry.index() == i && entry.path() == expected.path() && entry.child_count() == expected.child_count();
+		consistent = consistent && !entry.data() && entry.descriptor().size() == expected.descriptor().size();
+	}
+
+	CHECK(consistent);
+
+	zvfs::frozen_entry entry = mapped.get("content/pack_3/asset_3.bin");
+	CHECK(entry.is_file());
+	CHECK(entry.parent().path() == "Content/Pack_3/");
+	CHECK(entry.descriptor().size() == sizeof(uint64_t));
+
+	uint64_t offset = 0;
+	std::memcpy(&offset, entry.descriptor().data(), sizeof(offset));
+	CHECK(offset == 3 * 512);
+
+	CHECK(mapped.get("content/pack_3/asset_8.bin").descriptor().empty());
+	CHECK(mapped.get("content/").descriptor().empty());
+	CHECK(!mapped.get("content/pack_3/asset_9.bin"));
+	CHECK(frozen.get("content/pack_1/asset_1.bin").data() == source->get("content/pack_1/asset_1.bin")->m_file);
+
+	// Mappings don't depend on the vfs, only on the file
+	//
+	delete source;
+	zvfs::frozen_vfs moved = std::move(mapped);
+	CHECK(moved.get("content/pack_0/asset_0.bin"));
+	CHECK(mapped.size() == 0);
+
+	// Damaged or foreign files are rejected and leave the snapshot empty
+	//
+	CHECK(!mapped.map(file_path.string() + ".missing"));
+
+	std::filesystem::path truncated_path = std::filesystem::temp_directory_path() / "zvfs_mapped_truncated.bin";
+	std::filesystem::copy_file(file_path, truncated_path, std::filesystem::copy_options::overwrite_existing);
+	std::filesystem::resize_file(truncated_path, frozen.image_size() - 8);
+	CHECK(!mapped.map(truncated_path));
+	CHECK(mapped.size() == 0);
+	CHECK(!mapped.root());
+
+	zvfs::vfs empty;
+	CHECK(empty.save(truncated_path));
+	CHECK(!mapped.map(truncated_path));
+
+	// Records are only checked when they are used, damaged ones read as empty instead of leaving the image
+	// Records start at the offset stored after magic, version, flags, node count, seed, bucket count and image size
+	//
+	std::vector<char> image(frozen.image_size());
+	std::ifstream(file_path, std::ios_base::binary).read(image.data(), static_cast<std::streamsize>(image.size()));
+
+	uint64_t records_offset = 0;
+	std::memcpy(&records_offset, image.data() + 40, sizeof(records_offset));
+
+	auto patch = [&image, records_offset](size_t index, size_t field, uint32_t value)
+	{
+		std::memcpy(image.data() + records_offset + index * 32 + field, &value, sizeof(value));
+	};
+
+	// Child range of the root, path size, name size, parent and first child of "content/", path offset of the next record
+	//
+	patch(0, 24, 0x7FFFFFFFu);
+	patch(0, 28, 0x7FFFFFFFu);
+	patch(1, 12, 7);
+	patch(1, 16, 0xFFFFFFF0u);
+	patch(1, 20, 0xFFFFFFF0u);
+	patch(1, 24, 0xFFFFFFF0u);
+	patch(2, 8, 0xFFFFFFF0u);
+
+	std::ofstream(truncated_path, std::ios_base::binary | std::ios_base::trunc).write(image.data(), static_cast<std::streamsize>(image.size()));
+	CHECK(mapped.map(truncated_path));
+	CHECK(mapped.root().child_count() == 0);
+	CHECK(!mapped.root().child(0));
+	CHECK(mapped.at(1).name().empty());
+	CHECK(!mapped.at(1).parent());
+	CHECK(mapped.at(1).child_count() == 0);
+	CHECK(mapped.at(2).path().empty());
+	CHECK(!mapped.at(2).is_file());
+
+	moved = zvfs::frozen_vfs();
+	std::filesystem::remove(truncated_path);
+	std::filesystem::remove(file_path);
+}
+
+class memory_file : public zvfs::file
+{
+public:
+	explicit memory_file(std::string_view contents)
+		: m_contents(reinterpret_cast<const std::byte*>(contents.data()), reinterpret_cast<const std::byte*>(contents.data()) + contents.size())
+	{
+	}
+
+	std::span<const std::byte> view() const override
+	{
+		return this->m_contents;
+	}
+
+private:
+	std::vector<std::byte> m_contents;
+};
+
+DOCTEST_TEST_CASE("vfs file read interface")
+{
+	zvfs::vfs vfs;
+
+	auto slot = vfs.add("texts/hello.txt");
+	CHECK(slot != nullptr);
+	*slot = new memory_file("hello world");
+
+	// Consumers read through the base class, a view is enough to get size and positional reads
+	//
+	zvfs::file* data = vfs.get("texts/hello.txt")->m_file;
+	CHECK(data->size() == 11);
+	CHECK(data->view().size() == 11);
+
+	std::byte buffer[8];
+	CHECK(data->read_at(0, buffer) == 8);
+	CHECK(std::memcmp(buffer, "hello wo", 8) == 0);
+
+	CHECK(data->read_at(6, buffer) == 5);
+	CHECK(std::memcmp(buffer, "world", 5) == 0);
+
+	CHECK(data->read_at(11, buffer) == 0);
+	CHECK(data->read_at(100, buffer) == 0);
+	CHECK(data->read_at(3, std::span<std::byte>()) == 0);
+
+	// Backends that implement nothing are empty files
+	//
+	test_file empty;
+	CHECK(empty.size() == 0);
+	CHECK(empty.view().empty());
+	CHECK(empty.read_at(0, buffer) == 0);
+}
+
+DOCTEST_TEST_CASE("vfs descriptor source")
+{
+	std::filesystem::path file_path = std::filesystem::temp_directory_path() / "zvfs_source_test.bin";
+	{
+		std::ofstream stream(file_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		for (uint32_t i = 0; i < 64 * 1024; i++)
+			stream.put(static_cast<char>(i * 7));
+	}
+
+	CHECK(zvfs::fd_source::open(file_path.string() + ".missing") == nullptr);
+
+	zvfs::fd_source* source = zvfs::fd_source::open(file_path);
+	CHECK(source != nullptr);
+	CHECK(source->size() == 64 * 1024);
+
+	// Every entry keeps the source alive, the creator can drop its reference right away
+	//
+	zvfs::vfs vfs;
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		auto slot = vfs.add("archive/entry_" + std::to_string(i) + ".bin");
+		CHECK(slot != nullptr);
+		*slot = new zvfs::source_file(source, i * 1024, 1024);
+	}
+
+	CHECK(source->release() == 64);
+
+	zvfs::file* last = vfs.get("archive/entry_63.bin")->m_file;
+	std::byte tail[16];
+	CHECK(last->read_at(1020, tail) == 4);
+	CHECK(last->read_at(1024, tail) == 0);
+	CHECK(last->view().empty());
+
+	// Entries of one source are read from several threads at once without any locking
+	//
+	std::atomic<bool> consistent = true;
+	std::vector<std::thread> readers;
+	for (uint32_t t = 0; t < 4; t++)
+	{
+		readers.emplace_back([&vfs, &consistent, t]()
+		{
+			std::byte buffer[1024];
+			for (uint32_t round = 0; round < 50; round++)
+			{
+				uint32_t i = (t * 16 + round) % 64;
+				zvfs::file* entry = vfs.get("archive/entry_" + std::to_string(i) + ".bin")->m_file;
+				if (entry->read_at(0, buffer) != sizeof(buffer))
+					consistent = false;
+
+				for (uint32_t j = 0; j < sizeof(buffer); j++)
+				{
+					if (buffer[j] != static_cast<std::byte>((i * 1024 + j) * 7))
+						consistent = false;
+				}
+			}
+		});
+	}
+
+	for (std::thread& it : readers)
+		it.join();
+
+	CHECK(consistent);
+
+	CHECK(vfs.remove("archive/", true));
+	std::filesystem::remove(file_path);
+}
+
+DOCTEST_TEST_CASE("vfs mapped source")
+{
+	std::filesystem::path file_path = std::filesystem::temp_directory_path() / "zvfs_mapped_source_test.bin";
+	{
+		std::ofstream stream(file_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		for (uint32_t i = 0; i < 16 * 1024; i++)
+			stream.put(static_cast<char>(i * 13));
+	}
+
+	CHECK(zvfs::mapped_source::open(file_path.string() + ".missing") == nullptr);
+
+	zvfs::mapped_source* source = zvfs::mapped_source::open(file_path, zvfs::mapped_file::g_sequential | zvfs::mapped_file::g_willneed);
+	CHECK(source != nullptr);
+	CHECK(source->size() == 16 * 1024);
+	CHECK(source->view().size() == 16 * 1024);
+
+	source->advise(zvfs::mapped_file::g_willneed | zvfs::mapped_file::g_hugepage, 4000, 100000);
+	source->advise(zvfs::mapped_file::g_willneed, 1u << 30, 1);
+
+	zvfs::vfs vfs;
+	auto slot = vfs.add("archive/entry.bin");
+	CHECK(slot != nullptr);
+	*slot = new zvfs::source_file(source, 1000, 3000);
+
+	auto past_end = vfs.add("archive/past_end.bin");
+	CHECK(past_end != nullptr);
+	*past_end = new zvfs::source_file(source, 16 * 1024 - 10, 20);
+
+	source->release();
+
+	// Entries hand out views into the mapping, reads copy the same bytes
+	//
+	zvfs::file* entry = vfs.get("archive/entry.bin")->m_file;
+	std::span<const std::byte> contents = entry->view();
+	CHECK(contents.size() == 3000);
+	CHECK(contents.data() == static_cast<zvfs::source_file*>(entry)->origin()->view().data() + 1000);
+
+	bool consistent = true;
+	for (uint32_t i = 0; i < contents.size(); i++)
+		consistent = consistent && contents[i] == static_cast<std::byte>((1000 + i) * 13);
+
+	CHECK(consistent);
+
+	std::byte buffer[64];
+	CHECK(entry->read_at(2990, buffer) == 10);
+	CHECK(std::memcmp(buffer, contents.data() + 2990, 10) == 0);
+
+	// Ranges the mapping can't cover have no view
+	//
+	CHECK(vfs.get("archive/past_end.bin")->m_file->view().empty());
+	CHECK(vfs.get("archive/past_end.bin")->m_file->read_at(0, buffer) == 10);
+
+	CHECK(vfs.remove("archive/", true));
+	std::filesystem::remove(file_path);
+}
+
+namespace
+{
+	void seal_tar_header(char* header)
+	{
+		std::memset(header + 148, ' ', 8);
+		unsigned sum = 0;
+		for (size_t i = 0; i < 512; i++)
+			sum += static_cast<unsigned char>(header[i]);
+
+		std::snprintf(header + 148, 8, "%06o", sum);
+	}
+
+	void append_tar_header(std::string& archive, std::string_view name, char type, uint64_t size, std::string_view prefix = {}, bool gnu = false, std::string_view link = {})
+	{
+		char header[512] = {};
+		name.copy(header, 100);
+		std::snprintf(header + 100, 8, "%07o", 0644);
+		std::snprintf(header + 124, 12, "%011llo", static_cast<unsigned long long>(size));
+		header[156] = type;
+		link.copy(header + 157, 100);
+		std::memcpy(header + 257, gnu ? "ustar  " : "ustar\0" "00", 8);
+		prefix.copy(header + 345, 155);
+
+		seal_tar_header(header);
+		archive.append(header, sizeof(header));
+	}
+
+	void append_tar_entry(std::string& archive, std::string_view name, char type, std::string_view contents, std::string_view prefix = {}, bool gnu = false, std::string_view link = {})
+	{
+		append_tar_header(archive, name, type, contents.size(), prefix, gnu, link);
+		archive.append(contents);
+		archive.append((512 - contents.size() % 512) % 512, '\0');
+	}
+
+	std::string pax_record(std::string_view key, std::string_view value)
+	{
+		// The length prefix counts itself
+		//
+		std::string body = " " + std::string(key) + "=" + std::string(value) + "\n";
+		size_t length = body.size() + std::to_string(body.size()).size();
+		if (std::to_string(length).size() + body.size() != length)
+			length++;
+
+		return std::to_string(length) + body;
+	}
+
+	void write_file(const std::filesystem::path& path, std::string_view contents)
+	{
+		std::ofstream stream(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+	}
+
+	std::string read_all(zvfs::file* data)
+	{
+		std::string result(static_cast<size_t>(data->size()), '\0');
+		if (data->read_at(0, std::as_writable_bytes(std::span(result))) != result.size())
+			return {};
+
+		return result;
+	}
+}
+
+DOCTEST_TEST_CASE("vfs tar mount")
+{
+	std::string long_name = "deep/" + std::string(150, 'n') + ".txt";
+
+	std::string archive;
+	append_tar_entry(archive, "./assets/", '5', "");
+	append_tar_entry(archive, "./assets/one.txt", '0', "first");
+	append_tar_entry(archive, "two.txt", '0', "second", "assets/nested");
+	append_tar_entry(archive, "././@LongLink", 'L', long_name + '\0', {}, true);
+	append_tar_entry(archive, "truncated_name", '0', "long", {}, true);
+	append_tar_entry(archive, "PaxHeaders/pax", 'x', pax_record("path", "pax/renamed.bin") + pax_record("mtime", "1.5"));
+	append_tar_entry(archive, "pax_original.bin", '0', "pax data");
+	append_tar_entry(archive, "assets/link.txt", '2', "");
+	append_tar_entry(archive, "old_style_dir/", '0', "");
+
+	// Hard links resolve to the entry stored under their target before them, through the header, a GNU long link or pax
+	//
+	append_tar_entry(archive, "links/hard.txt", '1', "", {}, false, "./assets/one.txt");
+	append_tar_entry(archive, "././@LongLink", 'K', long_name + '\0', {}, true);
+	append_tar_entry(archive, "links/long.txt", '1', "", {}, true, "truncated_link");
+	append_tar_entry(archive, "PaxHeaders/link", 'x', pax_record("linkpath", "pax/renamed.bin"));
+	append_tar_entry(archive, "links/pax.bin", '1', "", {}, false, "pax_original.bin");
+	append_tar_entry(archive, "links/missing.txt", '1', "", {}, false, "not/in/archive.txt");
+	append_tar_entry(archive, "links/directory", '1', "", {}, false, "assets");
+
+	// A GNU sparse file whose map continues in one extension block, a volume label and a multivolume continuation
+	//
+	size_t sparse_header = archive.size();
+	append_tar_header(archive, "sparse.bin", 'S', 5, {}, true);
+	archive[sparse_header + 482] = 1;
+	seal_tar_header(archive.data() + sparse_header);
+	archive.append(512, '\0');
+	archive.append("holes");
+	archive.append(507, '\0');
+
+	append_tar_entry(archive, "backup volume 1", 'V', "", {}, true);
+	append_tar_entry(archive, "continued.bin", 'M', "rest of a file", {}, true);
+
+	append_tar_entry(archive, "/assets/one.txt", '0', "replaced");
+	append_tar_entry(archive, "empty.txt", '\0', "");
+	archive.append(1024, '\0');
+
+	std::filesystem::path file_path = std::filesystem::temp_directory_path() / "zvfs_tar_test.tar";
+	write_file(file_path, archive);
+
+	// The mapped source is parsed in place, the descriptor source through buffered reads, both agree
+	//
+	zvfs::source* sources[] = { zvfs::mapped_source::open(file_path), zvfs::fd_source::open(file_path) };
+	for (zvfs::source* it : sources)
+	{
+		CHECK(it != nullptr);
+
+		zvfs::vfs vfs;
+		CHECK(zvfs::mount_tar(vfs, *it) == 11);
+		it->release();
+
+		CHECK(vfs.get("assets/") != nullptr);
+		CHECK(read_all(vfs.get("assets/one.txt")->m_file) == "replaced");
+		CHECK(read_all(vfs.get("assets/nested/two.txt")->m_file) == "second");
+		CHECK(read_all(vfs.get(long_name)->m_file) == "long");
+		CHECK(read_all(vfs.get("pax/renamed.bin")->m_file) == "pax data");
+		CHECK(vfs.get("old_style_dir/") != nullptr);
+		CHECK(vfs.get("empty.txt")->m_file->size() == 0);
+
+		CHECK(vfs.get("truncated_name") == nullptr);
+		CHECK(vfs.get("pax_original.bin") == nullptr);
+		CHECK(vfs.get("assets/link.txt") == nullptr);
+		CHECK(vfs.get("././@LongLink") == nullptr);
+
+		CHECK(read_all(vfs.get("links/hard.txt")->m_file) == "first");
+		CHECK(read_all(vfs.get("links/long.txt")->m_file) == "long");
+		CHECK(read_all(vfs.get("links/pax.bin")->m_file) == "pax data");
+		CHECK(vfs.get("links/missing.txt") == nullptr);
+		CHECK(vfs.get("links/directory") == nullptr);
+
+		CHECK(vfs.get("sparse.bin") == nullptr);
+		CHECK(vfs.get("backup volume 1") == nullptr);
+		CHECK(vfs.get("continued.bin") == nullptr);
+	}
+
+	// Damaged archives are rejected before anything is added
+	//
+	std::string damaged = archive;
+	damaged[512 + 10] ^= 1;
+	write_file(file_path, damaged);
+
+	zvfs::fd_source* source = zvfs::fd_source::open(file_path);
+	zvfs::vfs damaged_vfs;
+	CHECK(zvfs::mount_tar(damaged_vfs, *source) == static_cast<size_t>(-1));
+	CHECK(damaged_vfs.size() == 1);
+	source->release();
+
+	write_file(file_path, std::string_view(archive).substr(0, 512 * 3 + 100));
+	source = zvfs::fd_source::open(file_path);
+	CHECK(zvfs::mount_tar(damaged_vfs, *source) == static_cast<size_t>(-1));
+	CHECK(damaged_vfs.size() == 1);
+	source->release();
+
+	std::filesystem::remove(file_path);
+}
+
+DOCTEST_TEST_CASE("vfs parallel mount")
+{
+	// Every archive has its own files plus one shared path, later archives have to win it
+	//
+	std::vector<std::filesystem::path> archive_paths;
+	for (size_t i = 0; i < 6; i++)
+	{
+		std::string archive;
+		for (size_t j = 0; j < 50; j++)
+			append_tar_entry(archive, "pack_" + std::to_string(i) + "/asset_" + std::to_string(j) + ".bin", '0', "data " + std::to_string(i * 100 + j));
+
+		append_tar_entry(archive, "shared/config.ini", '0', "archive " + std::to_string(i));
+		archive.append(1024, '\0');
+
+		archive_paths.push_back(std::filesystem::temp_directory_path() / ("zvfs_mount_many_" + std::to_string(i) + ".tar"));
+		write_file(archive_paths.back(), archive);
+	}
+
+	std::vector<zvfs::source*> sources;
+	for (const std::filesystem::path& it : archive_paths)
+		sources.push_back(zvfs::mapped_source::open(it));
+
+	for (size_t thread_count : { 1, 3, 0 })
+	{
+		zvfs::vfs_settings settings(true, true, 255, true, false, thread_count == 3);
+		zvfs::vfs vfs(settings);
+
+		auto existing = vfs.add("pack_0/asset_0.bin");
+		CHECK(existing != nullptr);
+		*existing = new memory_file("kept");
+
+		CHECK(vfs.mount_many(sources, thread_count) == 6 * (50 + 3));
+		CHECK(vfs.size() == 1 + 6 * 51 + 2);
+
+		CHECK(read_all(vfs.get("shared/config.ini")->m_file) == "archive 5");
+		CHECK(read_all(vfs.get("pack_3/asset_7.bin")->m_file) == "data 307");
+		CHECK(read_all(vfs.get("pack_0/asset_0.bin")->m_file) == "kept");
+
+		std::vector<zvfs::node*> nodes;
+		CHECK(vfs.list_prefix("pack_4/", nodes) == 51);
+	}
+
+	// Custom mounters index other formats, one failing archive fails the whole mount
+	//
+	zvfs::vfs failing;
+	size_t calls = 0;
+	std::mutex calls_mutex;
+	CHECK(failing.mount_many(sources, 2, [&](zvfs::vfs& target, zvfs::source& archive) -> size_t
+	{
+		std::lock_guard<std::mutex> lock(calls_mutex);
+		calls++;
+		return &archive == sources[4] ? static_cast<size_t>(-1) : zvfs::mount_tar(target, archive);
+	}) == static_cast<size_t>(-1));
+
+	CHECK(calls == sources.size());
+	CHECK(failing.size() == 1);
+	CHECK(failing.mount_many(std::span<zvfs::source* const>()) == 0);
+
+	for (zvfs::source* it : sources)
+		CHECK(it->release() == 0);
+
+	for (const std::filesystem::path& it : archive_paths)
+		std::filesystem::remove(it);
+}
+
+namespace
+{
+	void append_le(std::string& out, uint64_t value, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+			out += static_cast<char>(i < 8 ? (value >> (i * 8)) & 0xFF : 0);
+	}
+
+	uint32_t zip_crc(std::string_view data)
+	{
+		uint32_t crc = 0xFFFFFFFF;
+		for (char it : data)
+		{
+			crc ^= static_cast<uint8_t>(it);
+			for (size_t bit = 0; bit < 8; bit++)
+				crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+		}
+
+		return ~crc;
+	}
+
+	// Writes the local header and data to the archive and the matching record to the central directory.
+	// ZIP64 entries saturate all sizes and the offset and carry the real values in extra fields
+	//
+	void append_zip_entry(std::string& archive, std::string& directory, std::string_view name, uint16_t method, std::string_view data, uint64_t size, uint32_t crc, bool zip64)
+	{
+		uint64_t offset = archive.size();
+
+		archive += "PK\x03\x04";
+		append_le(archive, 20, 2);
+		append_le(archive, 0, 2);
+		append_le(archive, method, 2);
+		append_le(archive, 0, 4);
+		append_le(archive, crc, 4);
+		append_le(archive, zip64 ? 0xFFFFFFFF : data.size(), 4);
+		append_le(archive, zip64 ? 0xFFFFFFFF : size, 4);
+		append_le(archive, name.size(), 2);
+		append_le(archive, zip64 ? 20 : 0, 2);
+		archive += name;
+		if (zip64)
+		{
+			append_le(archive, 1, 2);
+			append_le(archive, 16, 2);
+			append_le(archive, size, 8);
+			append_le(archive, data.size(), 8);
+		}
+
+		archive += data;
+
+		directory += "PK\x01\x02";
+		append_le(directory, zip64 ? 45 : 20, 2);
+		append_le(directory, zip64 ? 45 : 20, 2);
+		append_le(directory, 0, 2);
+		append_le(directory, method, 2);
+		append_le(directory, 0, 4);
+		append_le(directory, crc, 4);
+		append_le(directory, zip64 ? 0xFFFFFFFF : data.size(), 4);
+		append_le(directory, zip64 ? 0xFFFFFFFF : size, 4);
+		append_le(directory, name.size(), 2);
+		append_le(directory, zip64 ? 28 : 0, 2);
+		append_le(directory, 0, 10);
+		append_le(directory, zip64 ? 0xFFFFFFFF : offset, 4);
+		directory += name;
+		if (zip64)
+		{
+			append_le(directory, 1, 2);
+			append_le(directory, 24, 2);
+			append_le(directory, size, 8);
+			append_le(directory, data.size(), 8);
+			append_le(directory, offset, 8);
+		}
+	}
+
+	void finish_zip(std::string& archive, std::string_view directory, uint64_t entry_count, bool zip64)
+	{
+		uint64_t directory_offset = archive.size();
+		archive += directory;
+
+		if (zip64)
+		{
+			uint64_t record_offset = archive.size();
+			archive += "PK\x06\x06";
+			append_le(archive, 44, 8);
+			append_le(archive, 45, 2);
+			append_le(archive, 45, 2);
+			append_le(archive, 0, 8);
+			append_le(archive, entry_count, 8);
+			append_le(archive, entry_count, 8);
+			append_le(archive, directory.size(), 8);
+			append_le(archive, directory_offset, 8);
+
+			archive += "PK\x06\x07";
+			append_le(archive, 0, 4);
+			append_le(archive, record_offset, 8);
+			append_le(archive, 1, 4);
+		}
+
+		// The comment contains a record signature, the reader has to find the real one in front of it
+		//
+		std::string_view comment("comment PK\x05\x06 inside", 20);
+
+		archive += "PK\x05\x06";
+		append_le(archive, 0, 4);
+		append_le(archive, zip64 ? 0xFFFF : entry_count, 2);
+		append_le(archive, zip64 ? 0xFFFF : entry_count, 2);
+		append_le(archive, zip64 ? 0xFFFFFFFF : directory.size(), 4);
+		append_le(archive, zip64 ? 0xFFFFFFFF : directory_offset, 4);
+		append_le(archive, comment.size(), 2);
+		archive += comment;
+	}
+}
+
+DOCTEST_TEST_CASE("vfs zip mount")
+{
+	// Raw DEFLATE streams, one with fixed and one with dynamic Huffman codes
+	//
+	const uint8_t fixed_stream[] = { 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0xc8, 0x40, 0x27, 0x01 };
+	const uint8_t dynamic_stream[] = {
+		0x85, 0xd3, 0xc1, 0x0d, 0xc2, 0x40, 0x14, 0x03, 0xd1, 0x3b, 0x55, 0xfc, 0x12, 0xb0, 0x0d, 0x04, 0xfa, 0x61, 0x11, 0x91, 0xc2, 0x26,
+		0x42, 0xcb, 0x01, 0xaa, 0x47, 0x34, 0xc0, 0x9c, 0xe7, 0xf6, 0x64, 0x2f, 0x73, 0x6f, 0xb5, 0xaf, 0xf5, 0x56, 0xe3, 0xde, 0xea, 0xb1,
+		0xbe, 0xfa, 0x68, 0xd7, 0xfa, 0xcc, 0x5b, 0xb5, 0x3e, 0x9e, 0xef, 0xdd, 0xf2, 0xeb, 0x82, 0x6e, 0xe8, 0x81, 0x7e, 0x80, 0x7e, 0x84,
+		0x7e, 0x82, 0x3e, 0x41, 0x3f, 0x43, 0xbf, 0x90, 0x0f, 0x02, 0x92, 0xa0, 0x88, 0x50, 0x64, 0x28, 0x42, 0x14, 0x29, 0x8a, 0x18, 0x45,
+		0x8e, 0x22, 0x48, 0x91, 0xa4, 0x49, 0xd2, 0xb8, 0x45, 0x92, 0x34, 0x49, 0x9a, 0x24, 0x4d, 0x92, 0x26, 0x49, 0x93, 0xa4, 0x49, 0xd2,
+		0x24, 0x19, 0x92, 0x0c, 0x49, 0x06, 0x6f, 0x4d, 0x92, 0x21, 0xc9, 0x90, 0x64, 0x48, 0x32, 0x24, 0x19, 0x92, 0xcc, 0x1f, 0xc9, 0x2f
+	};
+
+	std::string_view fixed(reinterpret_cast<const char*>(fixed_stream), sizeof(fixed_stream));
+	std::string_view dynamic(reinterpret_cast<const char*>(dynamic_stream), sizeof(dynamic_stream));
+
+	std::string fixed_text = "hello hello hello hello";
+	std::string dynamic_text;
+	for (size_t i = 0; i < 40; i++)
+		dynamic_text += "line " + std::to_string(i) + " of the mounted zip entry\n";
+
+	std::filesystem::path file_path = std::filesystem::temp_directory_path() / "zvfs_zip_test.zip";
+
+	for (size_t variant = 0; variant < 4; variant++)
+	{
+		// Every other archive gets a stub prepended like self extracting archives, their offsets stay relative
+		//
+		bool zip64 = variant & 1;
+		std::string archive = variant & 2 ? "#!/bin/sh\nexit 0\n" : "";
+		std::string directory;
+
+		std::string archive_body;
+		append_zip_entry(archive_body, directory, "docs/", 0, "", 0, 0, zip64);
+		append_zip_entry(archive_body, directory, "docs/readme.txt", 0, "stored contents", 15, zip_crc("stored contents"), zip64);
+		append_zip_entry(archive_body, directory, "fixed.txt", 8, fixed, fixed_text.size(), zip_crc(fixed_text), zip64);
+		append_zip_entry(archive_body, directory, "./dynamic.txt", 8, dynamic, dynamic_text.size(), zip_crc(dynamic_text), zip64);
+		append_zip_entry(archive_body, directory, "/docs/readme.txt", 0, "replaced", 8, zip_crc("replaced"), zip64);
+		append_zip_entry(archive_body, directory, "bad_crc.txt", 8, fixed, fixed_text.size(), zip_crc(fixed_text) ^ 1, zip64);
+		append_zip_entry(archive_body, directory, "unknown.bin", 14, "??", 2, 0, zip64);
+		finish_zip(archive_body, directory, 7, zip64);
+
+		archive += archive_body;
+		write_file(file_path, archive);
+
+		// Stored entries are views into the mapping, the descriptor source has none to offer
+		//
+		zvfs::source* sources[] = { zvfs::mapped_source::open(file_path), zvfs::fd_source::open(file_path) };
+		for (zvfs::source* it : sources)
+		{
+			CHECK(it != nullptr);
+
+			zvfs::vfs vfs;
+			CHECK(zvfs::mount_zip(vfs, *it) == 7);
+			bool mapped = !it->view().empty();
+			it->release();
+
+			CHECK(vfs.get("docs/") != nullptr);
+			CHECK(read_all(vfs.get("docs/readme.txt")->m_file) == "replaced");
+			CHECK(read_all(vfs.get("fixed.txt")->m_file) == fixed_text);
+			CHECK(read_all(vfs.get("dynamic.txt")->m_file) == dynamic_text);
+			CHECK(vfs.get("docs/readme.txt")->m_file->view().size() == (mapped ? 8 : 0));
+
+			std::span<const std::byte> inflated = vfs.get("dynamic.txt")->m_file->view();
+			CHECK(std::string_view(reinterpret_cast<const char*>(inflated.data()), inflated.size()) == dynamic_text);
+
+			std::string tail(4, '\0');
+			CHECK(vfs.get("dynamic.txt")->m_file->read_at(dynamic_text.size() - 2, std::as_writable_bytes(std::span(tail))) == 2);
+			CHECK(tail.substr(0, 2) == "y\n");
+
+			// Dropped contents are decompressed again by the next read
+			//
+			vfs.get("dynamic.txt")->m_file->drop_cache();
+			CHECK(read_all(vfs.get("dynamic.txt")->m_file) == dynamic_text);
+			vfs.get("dynamic.txt")->m_file->drop_cache();
+			CHECK(vfs.get("dynamic.txt")->m_file->view().size() == dynamic_text.size());
+
+			std::byte buffer[4];
+			CHECK(vfs.get("bad_crc.txt")->m_file->read_at(0, buffer) == static_cast<size_t>(-1));
+			vfs.get("bad_crc.txt")->m_file->drop_cache();
+			CHECK(vfs.get("bad_crc.txt")->m_file->view().empty());
+			CHECK(vfs.get("unknown.bin")->m_file->read_at(0, buffer) == static_cast<size_t>(-1));
+		}
+
+		// Damaged directories and end records are rejected before anything is added
+		//
+		std::string damaged = archive;
+		damaged[archive.size() - archive_body.size() + archive_body.find("PK\x01\x02") + 1] = 'X';
+		write_file(file_path, damaged);
+
+		zvfs::fd_source* source = zvfs::fd_source::open(file_path);
+		zvfs::vfs damaged_vfs;
+		CHECK(zvfs::mount_zip(damaged_vfs, *source) == static_cast<size_t>(-1));
+		CHECK(damaged_vfs.size() == 1);
+		source->release();
+
+		write_file(file_path, std::string_view(archive).substr(0, archive.size() - 1));
+		source = zvfs::fd_source::open(file_path);
+		CHECK(zvfs::mount_zip(damaged_vfs, *source) == static_cast<size_t>(-1));
+		CHECK(damaged_vfs.size() == 1);
+		source->release();
+
+		// Sizes no DEFLATE stream of that length can produce would only allocate memory
+		//
+		std::string inflated_body;
+		std::string inflated_directory;
+		append_zip_entry(inflated_body, inflated_directory, "inflated.txt", 8, fixed, 1032 * fixed.size() + 1032, zip_crc(fixed_text), zip64);
+		finish_zip(inflated_body, inflated_directory, 1, zip64);
+		write_file(file_path, inflated_body);
+
+		source = zvfs::fd_source::open(file_path);
+		CHECK(zvfs::mount_zip(damaged_vfs, *source) == static_cast<size_t>(-1));
+		CHECK(damaged_vfs.size() == 1);
+		source->release();
+	}
+
+	std::filesystem::remove(file_path);
+}
+
+DOCTEST_TEST_CASE("vfs directory mount")
+{
+	std::filesystem::path root = std::filesystem::temp_directory_path() / "zvfs_directory_test";
+	std::filesystem::remove_all(root);
+
+	// Enough directories for several workers to steal from each other
+	//
+	for (size_t i = 0; i < 8; i++)
+	{
+		for (size_t j = 0; j < 4; j++)
+		{
+			std::filesystem::path directory = root / ("module_" + std::to_string(i)) / ("part_" + std::to_string(j));
+			std::filesystem::create_directories(directory);
+
+			for (size_t k = 0; k < 5; k++)
+				write_file(directory / ("file_" + std::to_string(k) + ".txt"), "contents " + std::to_string(i * 100 + j * 10 + k));
+		}
+	}
+
+	std::filesystem::create_directories(root / "empty");
+	write_file(root / "top.txt", "top level");
+
+	// Links are skipped, the link target is still mounted on its own
+	//
+	std::error_code error;
+	std::filesystem::create_directory_symlink(root / "module_0", root / "linked_module", error);
+
+	for (size_t thread_count : { 1, 3, 0 })
+	{
+		zvfs::vfs_settings settings(true, true, 255, true, false, thread_count == 3);
+		zvfs::vfs vfs(settings);
+
+		auto existing = vfs.add("top.txt");
+		CHECK(existing != nullptr);
+		*existing = new memory_file("kept");
+
+		// 8 modules with 4 parts and 5 files each, the empty directory and the top level file
+		//
+		CHECK(zvfs::mount_directory(vfs, root, thread_count) == 8 * (1 + 4 * (1 + 5)) + 2);
+		CHECK(vfs.size() == 1 + 8 * (1 + 4 * (1 + 5)) + 2);
+
+		CHECK(read_all(vfs.get("module_3/part_2/file_4.txt")->m_file) == "contents 324");
+		CHECK(read_all(vfs.get("top.txt")->m_file) == "kept");
+		CHECK(vfs.get("empty/") != nullptr);
+		CHECK(vfs.get("linked_module/") == nullptr);
+
+		zvfs::host_file* data = static_cast<zvfs::host_file*>(vfs.get("module_7/part_0/file_1.txt")->m_file);
+		CHECK(data->path() == root / "module_7/part_0/file_1.txt");
+		CHECK(data->size() == std::string("contents 701").size());
+
+		std::string middle(4, '\0');
+		CHECK(data->read_at(9, std::as_writable_bytes(std::span(middle))) == 3);
+		CHECK(middle.substr(0, 3) == "701");
+
+		std::vector<zvfs::node*> nodes;
+		CHECK(vfs.list_prefix("module_5/", nodes) == 1 + 4 * (1 + 5));
+	}
+
+	zvfs::vfs missing;
+	CHECK(zvfs::mount_directory(missing, root / "does_not_exist") == static_cast<size_t>(-1));
+	CHECK(missing.size() == 1);
+
+	// Directories that can't be opened are left out together with their contents.
+	// Privileged users may still open them, the expected result follows what the host allows
+	//
+	std::filesystem::create_directories(root / "module_2/locked/inner");
+	write_file(root / "module_2/locked/inner/hidden.txt", "hidden");
+	std::filesystem::permissions(root / "module_2/locked", std::filesystem::perms::none);
+
+	std::filesystem::directory_iterator probe(root / "module_2/locked", error);
+	bool locked = static_cast<bool>(error);
+
+	zvfs::vfs partial;
+	CHECK(zvfs::mount_directory(partial, root / "module_2", 2) == 4 * (1 + 5) + (locked ? 0 : 3));
+	CHECK((partial.get("locked/") == nullptr) == locked);
+	CHECK((partial.get("locked/inner/hidden.txt") == nullptr) == locked);
+
+	std::filesystem::permissions(root / "module_2/locked", std::filesystem::perms::owner_all);
+
+	// The first read opens a file and keeps it open, dropped files are opened again by the next read
+	//
+	zvfs::vfs removed;
+	CHECK(zvfs::mount_directory(removed, root / "module_1", 2) == 4 * (1 + 5));
+
+	zvfs::file* opened = removed.get("part_0/file_1.txt")->m_file;
+	CHECK(read_all(opened) == "contents 101");
+	CHECK(read_all(opened) == "contents 101");
+	opened->drop_cache();
+	CHECK(read_all(opened) == "contents 101");
+	opened->drop_cache();
+
+	// Files removed after the scan fail to read instead of returning stale contents
+	//
+	std::filesystem::remove(root / "module_1/part_0/file_0.txt");
+	std::filesystem::remove(root / "module_1/part_0/file_1.txt");
+
+	std::byte buffer[4];
+	CHECK(removed.get("part_0/file_0.txt")->m_file->read_at(0, buffer) == static_cast<size_t>(-1));
+	CHECK(opened->read_at(0, buffer) == static_cast<size_t>(-1));
+
+	std::filesystem::remove_all(root);
+}